@@ -55,6 +55,87 @@
  * for calibrating the temperature readings.
  */
 #include "sensesp/transforms/linear.h"
+/**
+ * If extrapolating attitude to compensate for output latency, or
+ * resampling it to evenly-spaced instants, then include the attitude
+ * predictor and/or resampler.
+ */
+#include "attitude_predictor.h"
+#include "attitude_resampler.h"
+/**
+ * If holding back values while the Signal K connection is stalled,
+ * then include the coalescing buffer.
+ */
+#include "coalescing_buffer.h"
+/**
+ * If keeping a downloadable history of recent attitude, then include
+ * the orientation history.
+ */
+#include "orientation_history.h"
+/*
+ * If logging compressed attitude to flash over long passages, then
+ * include the motion log recorder.
+ */
+#include "motion_log_recorder.h"
+/*
+ * If providing several orientation values from one shared object, then
+ * include orientation outputs.
+ */
+#include "orientation_outputs.h"
+/*
+ * If reporting heap fragmentation and allocation rates, then include
+ * heap telemetry. See platformio.ini for the build flags that enable
+ * per-output allocation counts.
+ */
+#include "heap_telemetry.h"
+/*
+ * If keeping the settings of many orientation outputs in one document,
+ * loaded and saved as a whole, then include orientation config.
+ */
+#include "orientation_config.h"
+/*
+ * If profiling startup, or sending heading as NMEA 0183 on a serial
+ * port, then include the boot profiler and/or the NMEA 0183 output.
+ */
+#include "boot_profiler.h"
+#include "heading_nmea0183.h"
+/*
+ * If restoring the attitude after a reboot (e.g. a brownout) until
+ * fusion is valid again, then include the fusion state store.
+ */
+#include "fusion_state_store.h"
+/*
+ * If smoothing heading, then include the circular heading filter. The
+ * SensESP moving averages fail at the 0/2Pi wrap.
+ */
+#include "circular_heading_filter.h"
+/*
+ * If reporting true heading, then include true heading. It needs a
+ * variation grid made by tools/wmm_grid.cpp and uploaded to SPIFFS as
+ * /variation.bin, or else a configured variation.
+ */
+#include "true_heading.h"
+/*
+ * If carrying heading through magnetic interference (engine start,
+ * windlass) on the gyro, then include the magnetic disturbance detector.
+ */
+#include "magnetic_disturbance_detector.h"
+/*
+ * If watching engine or shaft vibration with bursts of fast accelerometer
+ * samples, then include the vibration monitor. Fusion pauses during
+ * each burst.
+ */
+#include "vibration_monitor.h"
+/*
+ * If watching how the boat swings at anchor, then include the anchor
+ * swing analyzer.
+ */
+#include "anchor_swing_analyzer.h"
+/*
+ * If one value feeds several consumers, then include the fan-out, which
+ * passes each fusion result on once to all of them.
+ */
+#include "fan_out.h"
 
 // Sensor hardware details: I2C addresses and pins       
 #define BOARD_ACCEL_MAG_I2C_ADDR    (0x1F) ///< I2C address on Adafruit breakout board
@@ -63,6 +144,7 @@
 #define PIN_I2C_SCL (25)          //   will use default Arduino pins.
 #define PIN_SWITCH_CAL_SAVE (36)  // When brought LOW, will save magnetic calibration
 #define SWITCH_ACTIVE_STATE (0)   // Input is LOW when Switch is pushed
+#define PIN_NMEA0183_TX (17)      // Serial output of NMEA 0183 heading
 
 // How often orientation parameters are published via Signal K message
 // If a report interval is saved for a particular sensor path (via the web
@@ -80,6 +162,40 @@ void setup() {
   #ifndef SERIAL_DEBUG_DISABLED
     SetupSerialDebug(115200);
   #endif
+  BootProfiler::Mark(kBootSetupStart);
+
+  /**
+   * Create and initialize the Orientation data source.
+   * This uses a 9 Degrees-of-freedom combination sensor that provides multiple
+   * orientation parameters. Selection of which particular parameters are
+   * output is performed later when the value producers are created.
+   * 
+   * Magnetic Calibration occurs during regular runtime. After power-on, move
+   * the sensor through a series of rolls, pitches and yaws. After enough
+   * readings have been collected (takes 15-30 seconds when rotating the sensor
+   * by hand) then the sensor should be calibrated.
+   * A Magnetic Calibration can be saved in non-volatile memory so it will be
+   * loaded at the next power-up. To save a calibration, use the
+   * orientation->heading->Save_Mag_Cal entry in the sensor web interface, AND/OR
+   * enable and use the optional hardware switch mentioned later in this code.
+   * A calibration will be valid until the sensor's magnetic environment
+   * changes.
+   *
+   * For a fast start, the sensor is created before the SensESP app, so
+   * the sensors are installed before the filesystem is mounted and the
+   * configurations are loaded, and fusion runs from the first pass of
+   * loop(), while WiFi and the Signal K connection are still coming up.
+   */
+  auto* orientation_sensor = new OrientationSensor(
+      PIN_I2C_SDA, PIN_I2C_SCL, BOARD_ACCEL_MAG_I2C_ADDR, BOARD_GYRO_I2C_ADDR);
+
+  /* Save the attitude to flash at most every 15 minutes, when it has
+   * changed. After a reboot, report the saved attitude for up to 15 s,
+   * until fusion is valid again, on a provisional path of its own (see
+   * below), so it isn't mistaken for a current heading. It is timestamped
+   * with the time it was saved, if the clock was set then.
+   */
+  auto* fusion_state = new FusionStateStore(orientation_sensor, 900, 15000);
 
   /**
    * Create the global SensESPApp() object.
@@ -103,6 +219,7 @@ void setup() {
                     ->enable_system_hz_sensor()
                     ->enable_wifi_signal_sensor()
                     ->get_app();
+  BootProfiler::Mark(kBootAppBuilt);
 
   /**
    * The "SignalK path" identifies this sensor to the Signal K server. Leaving
@@ -164,6 +281,63 @@ void setup() {
   const char* kSKPathMagBValueTrial = "orientation.calibration.magmagnitudetrial";
   const char* kSKPathMagNoise       = "orientation.calibration.magnoise";
   const char* kSKPathMagCalValues   = "orientation.calibration.magvalues";
+  /**
+   * Latency statistics (how old the attitude is when it is serialized
+   * and sent) are not part of the Signal K spec either.
+   */
+  const char* kSKPathAttitudeLatency = "orientation.diagnostics.attitudeLatency";
+  const char* kSKPathCoalescedCount  = "orientation.diagnostics.coalesced";
+  const char* kSKPathDroppedCount    = "orientation.diagnostics.dropped";
+  const char* kSKPathHeapStats       = "orientation.diagnostics.heap";
+  const char* kSKPathBootProfile     = "orientation.diagnostics.boot";
+  /**
+   * Attitude and heading extrapolated forward to compensate for output
+   * latency. These are kept apart from the spec'd paths so that both
+   * raw and predicted values are available.
+   */
+  const char* kSKPathAttitudePredicted = "orientation.predicted.attitude";
+  const char* kSKPathHeadingPredicted  = "orientation.predicted.headingCompass";
+  /**
+   * Magnetic heading smoothed by a circular filter, and the circular
+   * variance of heading.
+   */
+  const char* kSKPathHeadingSmoothed = "orientation.smoothed.headingMagnetic";
+  const char* kSKPathHeadingVariance = "orientation.smoothed.headingVariance";
+  /**
+   * True heading, and the magnetic variation used to find it.
+   */
+  const char* kSKPathHeadingTrue = "navigation.headingTrue";
+  const char* kSKPathVariation   = "navigation.magneticVariation";
+  /**
+   * True while the magnetic field is disturbed and heading is coming from
+   * the gyro alone.
+   */
+  const char* kSKPathMagDisturbed = "orientation.diagnostics.magneticDisturbance";
+  /**
+   * Estimated 1-sigma error of the compass and magnetic headings, sent at
+   * the same rate as heading so consumers can weight each heading sample.
+   */
+  const char* kSKPathHeadingUncertainty = "orientation.headingUncertainty";
+  /**
+   * Spectrum of the vibration at the sensor: overall RMS acceleration,
+   * the strongest frequency, and RMS acceleration in four bands. Uncomment
+   * along with the vibration monitor, below.
+   */
+  // const char* kSKPathVibration = "orientation.vibration";
+  /**
+   * Mean bearing, swing amplitude and period at anchor, once per window,
+   * and the notification raised when the swing changes abnormally.
+   */
+  const char* kSKPathAnchorSwing = "orientation.anchor.swing";
+  const char* kSKPathAnchorSwingAlert = "notifications.navigation.anchor.swing";
+  /**
+   * Attitude interpolated to exactly-spaced instants, for spectral analysis.
+   */
+  const char* kSKPathAttitudeResampled = "orientation.resampled.attitude";
+  /**
+   * Attitude saved before a reboot, reported only until fusion is valid.
+   */
+  const char* kSKPathAttitudeProvisional = "orientation.provisional.attitude";
 
   /**
    * If you are creating a new Signal K path that does not
@@ -223,21 +397,31 @@ void setup() {
    * paths. You can override them, but will then need to define your
    * own instruments to display the data.
    * 
+   * The settings of the orientation outputs themselves (report intervals,
+   * save mag cal, latency and prediction settings) are not given paths of
+   * their own. Instead they are members of the single document at
+   * kConfigPathOrientation, which is read from flash once at startup and
+   * saved as a whole. See the OrientationConfig section below.
+   *
    * Below arrangement of config paths yields this web interface structure:
    * 
-       sensors->attitude
-                       ->settings (adjusts report interval, saves mag cal)
-              ->heading
+       orientation (report intervals etc. of all orientation outputs)
+       sensors->heading
                        ->deviation (adjusts compass deviation with Curve Interpolator)
                        ->offset    (adjusts compass deviation with single value)
-                       ->settings  (adjusts report interval, saves mag cal)
+              ->temperature
+                       ->calibrate (adjusts temperature calibration)
+                       ->sk        (adjusts temperature Signal K path)
+              ->acceleration, rollRate, pitchRate
+                       ->sk        (adjusts Signal K path)
    * 
    */
+  const char* kConfigPathOrientation = "/orientation";
    const char* kConfigPathAttitude_SK = "";
-   const char* kConfigPathAttitude    = "/sensors/attitude/settings";
+   const char* kConfigPathAttitude    = "";
   const char* kConfigPathHeading_SKC = "";
   const char* kConfigPathHeading_SKM = "";
-  const char* kConfigPathHeading     = "/sensors/heading/settings";
+  const char* kConfigPathHeading     = "";
   const char* kConfigPathHeadingDev  = "/sensors/heading/deviation";
   const char* kConfigPathHeadingOffset = "/sensors/heading/offset";
   /* The above provides a web interface for attitude and compass heading. 
@@ -246,35 +430,31 @@ void setup() {
    */
   const char* kConfigPathTurnRate_SK    = "";
   const char* kConfigPathTurnRate       = "";
-     const char* kConfigPathAccelXYZ       = "/sensors/acceleration/settings";
+     const char* kConfigPathAccelXYZ       = "";
      const char* kConfigPathAccelXYZ_SK    = "/sensors/acceleration/sk";
-     const char *kConfigPathRollRate = "/sensors/rollRate/settings";
+     const char *kConfigPathRollRate = "";
      const char *kConfigPathRollRate_SK = "/sensors/rollRate/sk";
-     const char *kConfigPathPitchRate = "/sensors/pitchRate/settings";
+     const char *kConfigPathPitchRate = "";
      const char *kConfigPathPitchRate_SK = "/sensors/pitchRate/sk";
-  const char* kConfigPathTemperature    = "/sensors/temperature/settings";
+  const char* kConfigPathTemperature    = "";
   const char* kConfigPathTemperatureCal = "/sensors/temperature/calibrate";
   const char* kConfigPathTemperature_SK = "/sensors/temperature/sk";
-
-  /**
-   * Create and initialize the Orientation data source.
-   * This uses a 9 Degrees-of-freedom combination sensor that provides multiple
-   * orientation parameters. Selection of which particular parameters are
-   * output is performed later when the value producers are created.
-   * 
-   * Magnetic Calibration occurs during regular runtime. After power-on, move
-   * the sensor through a series of rolls, pitches and yaws. After enough
-   * readings have been collected (takes 15-30 seconds when rotating the sensor
-   * by hand) then the sensor should be calibrated.
-   * A Magnetic Calibration can be saved in non-volatile memory so it will be
-   * loaded at the next power-up. To save a calibration, use the
-   * sensors/heading/settings->Save_Mag_Cal entry in the sensor web interface, AND/OR
-   * enable and use the optional hardware switch mentioned later in this code.
-   * A calibration will be valid until the sensor's magnetic environment
-   * changes.
+  const char* kConfigPathAttitudeLatency = "";
+  const char* kConfigPathAttitudePredict = "";
+  const char* kConfigPathAttitudeResample = "";
+
+  /* Gather the settings of all the orientation outputs into one document.
+   * It is loaded once at startup, and can be read or replaced as a whole,
+   * e.g. to provision several sensors from a script:
+   *   curl http://<sensor IP>:8083/config/orientation > orientation.json
+   *   curl -X PUT -H "Content-Type: application/json" \
+   *        -d @orientation.json http://<sensor IP>:8083/config/orientation
+   * It is served on its own port because SensESP's /config handler can't
+   * parse a document this large. A document that is rejected by any
+   * output changes none of them.
    */
-  auto* orientation_sensor = new OrientationSensor(
-      PIN_I2C_SDA, PIN_I2C_SCL, BOARD_ACCEL_MAG_I2C_ADDR, BOARD_GYRO_I2C_ADDR);
+  auto* orientation_config =
+      new OrientationConfig(kConfigPathOrientation, 8083);
 
   /*
    * Create the desired outputs from the orientation sensor. Note that the physical
@@ -316,7 +496,7 @@ void setup() {
   auto* sensor_heading = new OrientationValues(
       orientation_sensor, OrientationValues::kCompassHeading,
       ORIENTATION_REPORTING_INTERVAL_MS, kConfigPathHeading);
-  sensor_heading
+  auto* heading_magnetic = sensor_heading
         /* Correct for mounting offsets - Pi/2 rotation in my case.
          */
         ->connect_to(new AngleCorrection((PI/2.0), 0.0, kConfigPathHeadingOffset))
@@ -334,8 +514,90 @@ void setup() {
         /* AngleCorrection normalizes to [0..2Pi] range, when CurveInterpolator output < 0 or > 2*Pi
          */
         ->connect_to(new AngleCorrection(0.0, 0.0, ""))
-        ->connect_to(
-            new SKOutputFloat(kSKPathHeadingMagnetic, kConfigPathHeading_SKM));
+        /* The corrected heading feeds several consumers below. They all
+         * connect to one FanOut, which passes each fusion result on once,
+         * rather than each consumer getting it separately. Code outside
+         * the SensESP graph can use heading_magnetic->add_consumer().
+         */
+        ->connect_to(new FanOut<float>(orientation_sensor));
+  heading_magnetic->connect_to(
+      new SKOutputFloat(kSKPathHeadingMagnetic, kConfigPathHeading_SKM));
+  orientation_config->Add("heading", sensor_heading);
+
+  /* Send the corrected heading as NMEA 0183 HDM sentences on a serial
+   * port. These don't wait for WiFi or the Signal K server, so an
+   * autopilot or display wired to the port gets heading as soon as fusion
+   * has a valid result, with the same offset and deviation as above.
+   */
+  Serial2.begin(4800, SERIAL_8N1, -1, PIN_NMEA0183_TX);
+  heading_magnetic->connect_to(
+      new HeadingNMEA0183(&Serial2, ORIENTATION_REPORTING_INTERVAL_MS));
+
+  /* Report how far the heading can be trusted, from the magnetic noise,
+   * the calibration fit and any magnetic disturbance, in radians 1-sigma.
+   */
+  SKMetadata* metadata_heading_uncertainty = new SKMetadata();
+  metadata_heading_uncertainty->description_ =
+      "Estimated 1-sigma error of heading";
+  metadata_heading_uncertainty->display_name_ = "Heading Uncertainty";
+  metadata_heading_uncertainty->short_name_ = "Hdg Unc";
+  metadata_heading_uncertainty->units_ = "rad";
+  auto* sensor_heading_uncertainty = new OrientationValues(
+      orientation_sensor, OrientationValues::kHeadingUncertainty,
+      ORIENTATION_REPORTING_INTERVAL_MS, "");
+  sensor_heading_uncertainty->connect_to(
+      new SKOutputFloat(kSKPathHeadingUncertainty, "",
+                        metadata_heading_uncertainty));
+  orientation_config->Add("heading_uncertainty", sensor_heading_uncertainty);
+
+  /* Smooth the magnetic heading for displays, averaging unit vectors so
+   * there is no jump at north, and report how widely heading is
+   * wandering as the circular variance (0 steady, towards 1 scattered).
+   * Smoothing adds lag, so autopilots should use the unsmoothed heading.
+   */
+  auto* heading_smoothed = new CircularHeadingFilter(0, 0.2, "");
+  heading_magnetic->connect_to(heading_smoothed)
+      ->connect_to(new SKOutputFloat(kSKPathHeadingSmoothed, ""));
+  heading_smoothed->circular_variance_.connect_to(
+      new SKOutputFloat(kSKPathHeadingVariance, ""));
+  orientation_config->Add("heading_smoothing", heading_smoothed);
+
+  /* At anchor, summarize the swing every 10 minutes and raise a
+   * notification if the mean bearing moves more than 30 degrees, or the
+   * amplitude or period more than doubles or halves. Arm it through the
+   * configuration when the anchor is down.
+   */
+  auto* anchor_swing = new AnchorSwingAnalyzer(600, 30.0, 2.0, 2.0, "");
+  heading_magnetic->connect_to(anchor_swing)
+      ->connect_to(new SKOutputAnchorSwing(kSKPathAnchorSwing, ""));
+  anchor_swing->notification_.connect_to(
+      new SKOutputNotification(kSKPathAnchorSwingAlert, ""));
+  orientation_config->Add("anchor_swing", anchor_swing);
+
+  /* Convert the magnetic heading to true, adding the variation from the
+   * on-device grid at the vessel's position from Signal K. Until a
+   * position arrives, the configured fixed position is used, and without
+   * either the configured variation. With none configured, neither true
+   * heading nor variation is sent, leaving those from other sources.
+   */
+  auto* heading_true = new TrueHeading(TrueHeading::kNoVariation,
+                                       "/variation.bin", "");
+  heading_magnetic->connect_to(heading_true)
+      ->connect_to(new SKOutputFloat(kSKPathHeadingTrue, ""));
+  heading_true->variation_.connect_to(
+      new SKOutputFloat(kSKPathVariation, ""));
+  new PositionListener(heading_true);
+  orientation_config->Add("heading_true", heading_true);
+
+  /* Watch the field magnitude and inclination at every fusion run. While
+   * they are off (e.g. the engine is starting or the windlass running),
+   * heading and yaw outputs hold the last good heading and follow the
+   * gyro, and the flag reports true.
+   */
+  auto* mag_disturbance = new MagneticDisturbanceDetector(
+      orientation_sensor, 0.1, 5.0, 2000, 300, 1000, "");
+  mag_disturbance->connect_to(new SKOutputBool(kSKPathMagDisturbed, ""));
+  orientation_config->Add("magnetic_disturbance", mag_disturbance);
 
   /* Enable Attitude output (yaw, pitch, roll). Note that this
    * output does not pass through any transform to correct for residual
@@ -344,8 +606,108 @@ void setup() {
   auto* sensor_attitude = new AttitudeValues(
       orientation_sensor, ORIENTATION_REPORTING_INTERVAL_MS,
       kConfigPathAttitude);
-  sensor_attitude->connect_to(
-      new SKOutputAttitude(kSKPathAttitude, kConfigPathAttitude_SK));
+  /* The CoalescingBuffer holds back attitude values while the connection
+   * to the Signal K server is stalled, keeping only the newest one, so
+   * memory use stays bounded and stale values aren't delivered late.
+   */
+  auto* attitude_output =
+      new SKOutputAttitude(kSKPathAttitude, kConfigPathAttitude_SK);
+  sensor_attitude->connect_to(new CoalescingBuffer<Attitude>())
+      ->connect_to(attitude_output);
+  orientation_config->Add("attitude", sensor_attitude);
+  // The attitude saved before a reboot, until fusion is valid again
+  fusion_state->connect_to(
+      new SKOutputAttitude(kSKPathAttitudeProvisional, ""));
+  // Report how many values have been coalesced or dropped by the buffers
+  auto* coalesced_count = new RepeatSensor<int>(10000, []() {
+    return (int)CoalescingBufferBase::get_total_coalesced_count();
+  });
+  coalesced_count->connect_to(new SKOutputInt(kSKPathCoalescedCount, ""));
+  auto* dropped_count = new RepeatSensor<int>(10000, []() {
+    return (int)CoalescingBufferBase::get_total_dropped_count();
+  });
+  dropped_count->connect_to(new SKOutputInt(kSKPathDroppedCount, ""));
+
+  /* Measure how old the attitude is when its output serializes it, i.e.
+   * after the CoalescingBuffer has released it, and when it is sent.
+   * Report the p50/p99/max latencies every 10 s.
+   */
+  auto* attitude_latency = new LatencyMonitor(10000, kConfigPathAttitudeLatency);
+  attitude_output->set_latency_monitor(attitude_latency);
+  attitude_latency->connect_to(
+      new SKOutputLatencyStats(kSKPathAttitudeLatency, ""));
+  orientation_config->Add("attitude_latency", attitude_latency);
+
+  /* Report free heap, largest free block, fragmentation and allocation
+   * rates every 10 s, to catch the slow fragmentation that can lead to
+   * a reboot after days of uptime.
+   */
+  auto* heap_telemetry = new HeapTelemetry(10000, "");
+  heap_telemetry->connect_to(new SKOutputHeapStats(kSKPathHeapStats, ""));
+  orientation_config->Add("heap", heap_telemetry);
+
+  /* The vibration monitor is off by default. Fusion pauses during each of
+   * its bursts, so attitude and heading skip those reports and the filter
+   * has to catch up afterwards. If you want the spectrum of engine or
+   * shaft vibration, uncomment the following: every 10 minutes it takes a
+   * burst of 256 accelerometer samples at 800 Hz (about a third of a
+   * second) and reports its spectrum.
+   */
+  // auto* vibration_monitor = new VibrationMonitor(
+  //     orientation_sensor, BOARD_ACCEL_MAG_I2C_ADDR, 256, 800, 600, "");
+  // vibration_monitor->connect_to(
+  //     new SKOutputVibrationSpectrum(kSKPathVibration, ""));
+  // orientation_config->Add("vibration", vibration_monitor);
+
+  /* Report once, after startup, when each phase of it was reached:
+   * setup, sensor install, first fusion, valid heading, WiFi and Signal K
+   * connections. Use it to see where time goes before heading appears.
+   */
+  auto* boot_profiler = new BootProfiler();
+  boot_profiler->connect_to(new SKOutputBootProfile(kSKPathBootProfile, ""));
+
+  /* Extrapolate the attitude forward by the measured sensor-to-send
+   * latency (lead time 0), using the current turn, pitch and roll rates.
+   * The latency is that of the attitude output above, which includes
+   * any time its values were held in the CoalescingBuffer.
+   */
+  auto* attitude_predictor = new AttitudePredictor(
+      orientation_sensor, 0, kConfigPathAttitudePredict);
+  attitude_predictor->set_latency_monitor(attitude_latency);
+  sensor_attitude->connect_to(attitude_predictor)
+      ->connect_to(new SKOutputAttitude(kSKPathAttitudePredicted, ""));
+  attitude_predictor->predicted_heading_.connect_to(
+      new SKOutputFloat(kSKPathHeadingPredicted, ""));
+  orientation_config->Add("attitude_prediction", attitude_predictor);
+
+  /* Output attitude SLERP-interpolated to exactly every 100 ms, rather
+   * than whatever fusion result is current when the report timer fires.
+   */
+  auto* attitude_resampled = new AttitudeResampler(
+      orientation_sensor, ORIENTATION_REPORTING_INTERVAL_MS,
+      kConfigPathAttitudeResample);
+  attitude_resampled->connect_to(
+      new SKOutputAttitude(kSKPathAttitudeResampled, ""));
+  orientation_config->Add("attitude_resampled", attitude_resampled);
+
+  /* Keep the last 75 s of attitude, rates and acceleration at the full
+   * fusion rate in RAM (about 60 kB). Download it for troubleshooting with
+   *   curl -o history.bin http://<sensor IP>:8082/history
+   */
+  new OrientationHistory(orientation_sensor, 3000, 1, 8082);
+
+  /**
+   * Log attitude, rates and acceleration to flash once every 15 s (one
+   * of every 600 fusion runs). Samples this far apart compress less well,
+   * to at most 24 bytes each, so two 24 kB files hold at least the last
+   * 8 hours of a passage, and more in calm conditions.
+   * Lower the decimation for finer detail over a shorter span. The
+   * 128 kB SPIFFS of min_spiffs.csv also has to hold the configuration
+   * files and /variation.bin, so allow for those before making the files
+   * larger. Copy /mlog0.bin and /mlog1.bin off the device and convert
+   * them with tools/motion_log_decode.cpp.
+   */
+  new MotionLogRecorder(orientation_sensor, 600, 24576, 2);
 
   /**
    * The following outputs are useful when calibrating. See the wiki at
@@ -360,47 +722,43 @@ void setup() {
    * instrument panel to display these paths on a secondary screen,
    * separate from the primary navigation screen.
    */
-  auto* sensor_cal_fit = new OrientationValues(
-      orientation_sensor, OrientationValues::kMagCalFitInUse,
-      ORIENTATION_REPORTING_INTERVAL_MS * 39, "");
-  sensor_cal_fit->connect_to(
-      new SKOutputFloat(kSKPathMagFit, ""));
-
-  auto* sensor_cal_candidate = new OrientationValues(
-      orientation_sensor, OrientationValues::kMagCalFitTrial,
-      ORIENTATION_REPORTING_INTERVAL_MS * 19, "");
-  sensor_cal_candidate->connect_to(
-      new SKOutputFloat(kSKPathMagFitTrial, ""));
-
-  auto* sensor_cal_order = new OrientationValues(
-      orientation_sensor, OrientationValues::kMagCalAlgorithmSolver,
-      ORIENTATION_REPORTING_INTERVAL_MS * 99, "");
-  sensor_cal_order->connect_to(
-      new SKOutputFloat(kSKPathMagSolver, ""));
-
-   auto* sensor_mag_inclination = new OrientationValues(
-       orientation_sensor, OrientationValues::kMagInclination,
-       ORIENTATION_REPORTING_INTERVAL_MS * 10, "");
-   sensor_mag_inclination->connect_to(
-       new SKOutputFloat(kSKPathMagInclination, ""));
-
-   auto* sensor_mag_b_value = new OrientationValues(
-       orientation_sensor, OrientationValues::kMagFieldMagnitude,
-       ORIENTATION_REPORTING_INTERVAL_MS * 10, "");
-   sensor_mag_b_value->connect_to(
-       new SKOutputFloat(kSKPathMagBValue, ""));
-
-   auto* sensor_mag_b_value_trial = new OrientationValues(
-       orientation_sensor, OrientationValues::kMagFieldMagnitudeTrial,
-       ORIENTATION_REPORTING_INTERVAL_MS * 10, "");
-   sensor_mag_b_value_trial->connect_to(
-       new SKOutputFloat(kSKPathMagBValueTrial, ""));
-
-  auto* sensor_mag_noise = new OrientationValues(
-      orientation_sensor, OrientationValues::kMagNoiseCovariance,
-      ORIENTATION_REPORTING_INTERVAL_MS * 10, "");
-  sensor_mag_noise->connect_to(
-      new SKOutputFloat(kSKPathMagNoise, ""));
+  /* These seven values share one OrientationOutputs, which needs much
+   * less memory than an OrientationValues for each. The footprint of both
+   * is logged at startup. Magnetic calibration changes slowly, so a
+   * deadband suppresses reports of unchanged values.
+   */
+  auto* cal_outputs = new OrientationOutputs(
+      orientation_sensor, ORIENTATION_REPORTING_INTERVAL_MS, "");
+  cal_outputs
+      ->Add(OrientationValues::kMagCalFitInUse,
+            ORIENTATION_REPORTING_INTERVAL_MS * 39)
+      ->connect_to(new SKOutputFloat(kSKPathMagFit, ""));
+  cal_outputs
+      ->Add(OrientationValues::kMagCalFitTrial,
+            ORIENTATION_REPORTING_INTERVAL_MS * 19)
+      ->connect_to(new SKOutputFloat(kSKPathMagFitTrial, ""));
+  cal_outputs
+      ->Add(OrientationValues::kMagCalAlgorithmSolver,
+            ORIENTATION_REPORTING_INTERVAL_MS * 99)
+      ->connect_to(new SKOutputFloat(kSKPathMagSolver, ""));
+  cal_outputs
+      ->Add(OrientationValues::kMagInclination,
+            ORIENTATION_REPORTING_INTERVAL_MS * 10, 0.001)
+      ->connect_to(new SKOutputFloat(kSKPathMagInclination, ""));
+  cal_outputs
+      ->Add(OrientationValues::kMagFieldMagnitude,
+            ORIENTATION_REPORTING_INTERVAL_MS * 10, 0.1)
+      ->connect_to(new SKOutputFloat(kSKPathMagBValue, ""));
+  cal_outputs
+      ->Add(OrientationValues::kMagFieldMagnitudeTrial,
+            ORIENTATION_REPORTING_INTERVAL_MS * 10, 0.1)
+      ->connect_to(new SKOutputFloat(kSKPathMagBValueTrial, ""));
+  cal_outputs
+      ->Add(OrientationValues::kMagNoiseCovariance,
+            ORIENTATION_REPORTING_INTERVAL_MS * 10)
+      ->connect_to(new SKOutputFloat(kSKPathMagNoise, ""));
+  cal_outputs->LogFootprint();
+  orientation_config->Add("calibration", cal_outputs);
 
   /* This report is a consolidation of all the above magnetic cal
    * values and will need a custom instrument to display.
@@ -409,6 +767,7 @@ void setup() {
        orientation_sensor, ORIENTATION_REPORTING_INTERVAL_MS * 10, "");
    sensor_mag_cal->connect_to(
        new SKOutputMagCal(kSKPathMagCalValues, ""));
+   orientation_config->Add("mag_cal", sensor_mag_cal);
 
   /**
    * Following section monitors a physical switch that, when pressed,
@@ -447,18 +806,21 @@ void setup() {
         ORIENTATION_REPORTING_INTERVAL_MS * 4, kConfigPathTurnRate);
   sensor_turn_rate->connect_to(
         new SKOutputFloat(kSKPathTurnRate, kConfigPathTurnRate_SK));
+  orientation_config->Add("turn_rate", sensor_turn_rate);
 
      auto* sensor_roll_rate = new OrientationValues(
          orientation_sensor, OrientationValues::kRateOfRoll,
          ORIENTATION_REPORTING_INTERVAL_MS, kConfigPathRollRate);
      sensor_roll_rate->connect_to(
          new SKOutputFloat(kSKPathRollRate, kConfigPathRollRate_SK, metadata_rate_of_roll));
+     orientation_config->Add("roll_rate", sensor_roll_rate);
 
      auto* sensor_pitch_rate = new OrientationValues(
          orientation_sensor, OrientationValues::kRateOfPitch,
          ORIENTATION_REPORTING_INTERVAL_MS, kConfigPathPitchRate);
      sensor_pitch_rate->connect_to(
          new SKOutputFloat(kSKPathPitchRate, kConfigPathPitchRate_SK, metadata_rate_of_pitch));
+     orientation_config->Add("pitch_rate", sensor_pitch_rate);
 
   /* Send the X acceleration as a single value.
    * TODO - it makes sense to send all three accel values (XYZ) in
@@ -470,6 +832,7 @@ void setup() {
          ORIENTATION_REPORTING_INTERVAL_MS, kConfigPathAccelXYZ);
      sensor_accel_x->connect_to(
          new SKOutputFloat(kSKPathAccel, kConfigPathAccelXYZ_SK, metadata_accel));
+     orientation_config->Add("accel_x", sensor_accel_x);
 
   /* Send Temperature as measured by the orientation sensor.
    * Depending on mounting and enclosure, it may be close to ambient.
@@ -489,6 +852,7 @@ void setup() {
         ->connect_to(new SKOutputFloat(
             kSKPathTemperature, kConfigPathTemperature_SK,
             metadata_temperature));
+  orientation_config->Add("temperature", sensor_temperature);
 
   /**
    *  Relationship of the Axes and the terminology:
@@ -504,6 +868,7 @@ void setup() {
   /* Start networking, SK server connections and other SensESP internals
    */
   sensesp_app->start();
+  BootProfiler::Mark(kBootAppStarted);
 
 }//end setup()
 
@@ -0,0 +1,338 @@
+/** @file anchor_swing_analyzer.cpp
+ *  @brief Watches how a vessel at anchor swings, and raises a
+ *  notification when that changes.
+ */
+
+#include "anchor_swing_analyzer.h"
+
+#include "config_schema.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+#define CONFIG_KEY_ARMED "armed"
+#define CONFIG_KEY_WINDOW "window"
+#define CONFIG_KEY_BEARING_LIMIT "bearing_limit"
+#define CONFIG_KEY_AMPLITUDE_RATIO "amplitude_ratio"
+#define CONFIG_KEY_PERIOD_RATIO "period_ratio"
+
+/// Interval of the averaged heading samples
+static const uint32_t kSampleIntervalMs = 1000;
+/// Windows averaged into the baseline before it is compared with
+static const uint kBaselineWindows = 3;
+/// Weight of each new window in the baseline
+static const float kBaselineWeight = 0.25;
+/// Least offset needed to count a crossing of the mean, radians (1 deg)
+static const float kMinHysteresis = 0.0175;
+/// Amplitudes below this aren't compared by ratio, radians (3 deg)
+static const float kMinComparedAmplitude = 0.052;
+
+/// Wraps an angle in radians into (-Pi, Pi]
+static float WrapRadians(float angle) {
+  while (angle > PI) {
+    angle -= 2.0 * PI;
+  }
+  while (angle <= -PI) {
+    angle += 2.0 * PI;
+  }
+  return angle;
+}
+
+/**
+ * @brief Constructor sets the window and the limits of normal change.
+ *
+ * The analyzer starts unarmed; arm it through its configuration when
+ * the anchor is down.
+ *
+ * @param window_s Length of each window, in seconds. It should span
+ * several swings; at anchor these typically take one to five minutes.
+ * @param bearing_limit_deg Largest normal move of the mean bearing from
+ * the baseline, in degrees.
+ * @param amplitude_ratio Largest normal factor by which the amplitude
+ * grows or shrinks from the baseline.
+ * @param period_ratio Likewise for the period.
+ * @param config_path RESTful path by which the analyzer can be armed and
+ * configured.
+ */
+AnchorSwingAnalyzer::AnchorSwingAnalyzer(uint window_s,
+                                         float bearing_limit_deg,
+                                         float amplitude_ratio,
+                                         float period_ratio,
+                                         String config_path)
+    : Transform<float, AnchorSwing>(config_path),
+      is_armed_{false},
+      window_s_{window_s},
+      bearing_limit_{bearing_limit_deg * DEG_TO_RAD},
+      amplitude_ratio_{amplitude_ratio},
+      period_ratio_{period_ratio},
+      is_reset_needed_{false},
+      is_alert_{false} {
+  load_configuration();
+  Reset();
+}  // end AnchorSwingAnalyzer()
+
+/**
+ * @brief Forgets the baseline and the window in progress.
+ */
+void AnchorSwingAnalyzer::Reset(void) {
+  is_reset_needed_ = false;
+  sample_cos_ = 0.0;
+  sample_sin_ = 0.0;
+  sample_start_ms_ = 0;
+  has_sample_ = false;
+  window_cos_ = 0.0;
+  window_sin_ = 0.0;
+  window_start_ms_ = 0;
+  offset_min_ = INFINITY;
+  offset_max_ = -INFINITY;
+  crossings_ = 0;
+  side_ = 0;
+  hysteresis_ = kMinHysteresis;
+  baseline_count_ = 0;
+  memset(&baseline_, 0, sizeof(baseline_));
+  is_alert_ = false;
+}  // end Reset()
+
+/**
+ * @brief Averages headings into one-second samples.
+ *
+ * @param input Heading, in radians.
+ */
+void AnchorSwingAnalyzer::set_input(float input, uint8_t input_channel) {
+  if (is_reset_needed_) {
+    if (is_alert_) {
+      AlertNotification notification;
+      notification.is_alert = false;
+      strlcpy(notification.message, "Anchor swing watch restarted",
+              sizeof(notification.message));
+      notification_.emit(notification);
+    }
+    Reset();  // here rather than in set_configuration(), on the loop task
+  }
+  if (!is_armed_ || isnan(input)) {
+    return;
+  }
+  uint32_t now_ms = millis();
+  if (!has_sample_) {
+    has_sample_ = true;
+    sample_start_ms_ = now_ms;
+    window_start_ms_ = now_ms;
+  }
+  sample_cos_ += cosf(input);
+  sample_sin_ += sinf(input);
+  if (now_ms - sample_start_ms_ < kSampleIntervalMs) {
+    return;
+  }
+  AddSample(atan2(sample_sin_, sample_cos_), now_ms);
+  sample_cos_ = 0.0;
+  sample_sin_ = 0.0;
+  sample_start_ms_ = now_ms;
+}  // end set_input()
+
+/**
+ * @brief Adds a one-second sample to the window's running sums, and
+ * ends the window when it is complete.
+ *
+ * The sample's offset is measured from the mean of the window so far,
+ * including this sample.
+ *
+ * @param heading Averaged heading, in radians.
+ * @param now_ms millis() at the end of the sample.
+ */
+void AnchorSwingAnalyzer::AddSample(float heading, uint32_t now_ms) {
+  window_cos_ += cosf(heading);
+  window_sin_ += sinf(heading);
+  float offset = WrapRadians(heading - atan2(window_sin_, window_cos_));
+  if (offset < offset_min_) {
+    offset_min_ = offset;
+  }
+  if (offset > offset_max_) {
+    offset_max_ = offset;
+  }
+  if (side_ <= 0 && offset > hysteresis_) {
+    crossings_ += (side_ < 0) ? 1 : 0;
+    side_ = 1;
+  } else if (side_ >= 0 && offset < -hysteresis_) {
+    crossings_ += (side_ > 0) ? 1 : 0;
+    side_ = -1;
+  }
+  if (now_ms - window_start_ms_ >= window_s_ * 1000) {
+    EndWindow(now_ms);
+  }
+}  // end AddSample()
+
+/**
+ * @brief Summarizes the window, compares it with the baseline, and
+ * starts the next window.
+ *
+ * @param now_ms millis() at the end of the window.
+ */
+void AnchorSwingAnalyzer::EndWindow(uint32_t now_ms) {
+  float seconds = (now_ms - window_start_ms_) / 1000.0;
+  AnchorSwing swing;
+  swing.mean_bearing = atan2(window_sin_, window_cos_);
+  if (swing.mean_bearing < 0.0) {
+    swing.mean_bearing += 2.0 * PI;
+  }
+  swing.amplitude = (offset_max_ - offset_min_) / 2.0;
+  // two crossings per full swing
+  swing.period = (crossings_ >= 2) ? 2.0 * seconds / crossings_ : NAN;
+  swing.is_data_valid = true;
+  swing.is_alert = false;
+
+  if (baseline_count_ >= kBaselineWindows) {
+    AlertNotification notification;
+    bool is_abnormal = CheckWindow(swing, notification.message,
+                                   sizeof(notification.message));
+    swing.is_alert = is_abnormal;
+    if (is_abnormal != is_alert_) {
+      is_alert_ = is_abnormal;
+      notification.is_alert = is_abnormal;
+      if (!is_abnormal) {
+        strlcpy(notification.message, "Anchor swing back to normal",
+                sizeof(notification.message));
+      }
+      debugI("AnchorSwing: %s", notification.message);
+      notification_.emit(notification);
+    }
+  }
+  // fold the window into the baseline
+  if (0 == baseline_count_) {
+    baseline_ = swing;
+  } else {
+    baseline_.mean_bearing += kBaselineWeight *
+        WrapRadians(swing.mean_bearing - baseline_.mean_bearing);
+    baseline_.amplitude +=
+        kBaselineWeight * (swing.amplitude - baseline_.amplitude);
+    if (isnan(baseline_.period)) {
+      baseline_.period = swing.period;
+    } else if (!isnan(swing.period)) {
+      baseline_.period += kBaselineWeight * (swing.period - baseline_.period);
+    }
+  }
+  baseline_count_++;
+  this->emit(swing);
+
+  // the next window's crossings are counted against this window's swing
+  hysteresis_ = swing.amplitude / 4.0;
+  if (hysteresis_ < kMinHysteresis) {
+    hysteresis_ = kMinHysteresis;
+  }
+  window_cos_ = 0.0;
+  window_sin_ = 0.0;
+  window_start_ms_ = now_ms;
+  offset_min_ = INFINITY;
+  offset_max_ = -INFINITY;
+  crossings_ = 0;
+  side_ = 0;
+}  // end EndWindow()
+
+/**
+ * @brief Compares a window with the baseline.
+ *
+ * @param swing The window's summary.
+ * @param reason Receives a description of the first abnormal change.
+ * @param size Size of reason.
+ * @return True if the change from the baseline is abnormal.
+ */
+bool AnchorSwingAnalyzer::CheckWindow(const AnchorSwing& swing, char* reason,
+                                      size_t size) {
+  float shift = WrapRadians(swing.mean_bearing - baseline_.mean_bearing);
+  if (fabsf(shift) > bearing_limit_) {
+    snprintf(reason, size, "Anchor swing: mean bearing moved %.0f deg",
+             shift * RAD_TO_DEG);
+    return true;
+  }
+  float larger = swing.amplitude > baseline_.amplitude ? swing.amplitude
+                                                       : baseline_.amplitude;
+  float smaller = swing.amplitude > baseline_.amplitude ? baseline_.amplitude
+                                                        : swing.amplitude;
+  if (larger > kMinComparedAmplitude && larger > amplitude_ratio_ * smaller) {
+    snprintf(reason, size, "Anchor swing: amplitude %.0f deg, usually %.0f",
+             swing.amplitude * RAD_TO_DEG, baseline_.amplitude * RAD_TO_DEG);
+    return true;
+  }
+  if (!isnan(swing.period) && !isnan(baseline_.period) &&
+      (swing.period > period_ratio_ * baseline_.period ||
+       baseline_.period > period_ratio_ * swing.period)) {
+    snprintf(reason, size, "Anchor swing: period %.0f s, usually %.0f",
+             swing.period, baseline_.period);
+    return true;
+  }
+  reason[0] = '\0';
+  return false;
+}  // end CheckWindow()
+
+/**
+ * @brief Define the format for the AnchorSwingAnalyzer configuration.
+ */
+static const char SCHEMA_ANCHOR_SWING[] PROGMEM = SCHEMA_OBJECT(
+    SCHEMA_NUMBER(CONFIG_KEY_ARMED, "Armed",
+                  "1 at anchor, 0 otherwise. Arming starts a new baseline")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_WINDOW, "Window",
+                       "Seconds summarized together. Span several swings")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_BEARING_LIMIT, "Bearing Limit",
+                       "Largest normal move of mean bearing, degrees")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_AMPLITUDE_RATIO, "Amplitude Ratio",
+                       "Largest normal factor of amplitude change")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_PERIOD_RATIO, "Period Ratio",
+                       "Largest normal factor of period change"));
+
+/// Keys that a configuration of AnchorSwingAnalyzer holds
+static const char* const kConfigKeysAnchorSwing[] = {
+    CONFIG_KEY_ARMED, CONFIG_KEY_WINDOW, CONFIG_KEY_BEARING_LIMIT,
+    CONFIG_KEY_AMPLITUDE_RATIO, CONFIG_KEY_PERIOD_RATIO};
+
+/**
+ * @brief Get the current configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void AnchorSwingAnalyzer::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_ARMED] = is_armed_ ? 1 : 0;
+  doc[CONFIG_KEY_WINDOW] = window_s_;
+  doc[CONFIG_KEY_BEARING_LIMIT] = bearing_limit_ * RAD_TO_DEG;
+  doc[CONFIG_KEY_AMPLITUDE_RATIO] = amplitude_ratio_;
+  doc[CONFIG_KEY_PERIOD_RATIO] = period_ratio_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String AnchorSwingAnalyzer::get_config_schema() {
+  return FPSTR(SCHEMA_ANCHOR_SWING);
+}
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * Any change starts a new baseline, at the next input.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found,
+ * the window is 0, or a ratio isn't above 1.
+ */
+bool AnchorSwingAnalyzer::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysAnchorSwing)) {
+    return false;
+  }
+  uint window_s = config[CONFIG_KEY_WINDOW];
+  float amplitude_ratio = config[CONFIG_KEY_AMPLITUDE_RATIO];
+  float period_ratio = config[CONFIG_KEY_PERIOD_RATIO];
+  if (0 == window_s || amplitude_ratio <= 1.0 || period_ratio <= 1.0) {
+    return false;
+  }
+  is_armed_ = (0 != config[CONFIG_KEY_ARMED].as<int>());
+  window_s_ = window_s;
+  bearing_limit_ = config[CONFIG_KEY_BEARING_LIMIT].as<float>() * DEG_TO_RAD;
+  amplitude_ratio_ = amplitude_ratio;
+  period_ratio_ = period_ratio;
+  is_reset_needed_ = true;
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
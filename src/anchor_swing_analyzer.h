@@ -0,0 +1,91 @@
+/** @file anchor_swing_analyzer.h
+ *  @brief Watches how a vessel at anchor swings, and raises a
+ *  notification when that changes.
+ */
+
+#ifndef anchor_swing_analyzer_H_
+#define anchor_swing_analyzer_H_
+
+#include "sensesp/transforms/transform.h"
+#include "signalk_orientation.h"
+
+namespace sensesp {
+
+/**
+ * @brief AnchorSwingAnalyzer turns the heading stream of a vessel at
+ * anchor into, once per window, the mean bearing and the amplitude and
+ * period of its swing, and raises a notification when these change
+ * abnormally, as they do when the anchor drags or the wind shifts.
+ *
+ * Heading is averaged (as unit vectors) into one sample per second, and
+ * each window of window_s seconds is summarized with running sums, so
+ * memory use doesn't depend on the window:
+ * - the mean bearing is the direction of the summed unit vectors;
+ * - the swing is the heading's offset from the running mean bearing of
+ *   the window so far. Its amplitude is half its range, and its period
+ *   is the window's length over half the number of times it crosses the
+ *   mean. Crossings are only counted once the offset passes a quarter of
+ *   the previous window's amplitude on the other side, so jitter isn't
+ *   counted.
+ *
+ * Each window is compared with a baseline, an exponential average of
+ * earlier windows. A change is abnormal if the mean bearing moved by more
+ * than the bearing limit, or the amplitude or period grew or shrank by
+ * more than their ratio limits. The notification is raised when a window
+ * is abnormal, and cleared when one isn't. The baseline follows every
+ * window, so a lasting new pattern stops being abnormal after a few
+ * windows; a dragging anchor keeps changing it.
+ *
+ * Nothing is reported until the analyzer is armed, and arming it (e.g.
+ * on dropping the anchor) starts a fresh baseline. Only one AnchorSwing
+ * per window, and notifications on change, leave the device.
+ *
+ * The input is heading in radians. The output is an AnchorSwing per
+ * window; notifications come from notification_.
+ */
+class AnchorSwingAnalyzer : public Transform<float, AnchorSwing> {
+ public:
+  AnchorSwingAnalyzer(uint window_s = 600, float bearing_limit_deg = 30.0,
+                      float amplitude_ratio = 2.0, float period_ratio = 2.0,
+                      String config_path = "");
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+  AlertNotificationProducer notification_;  ///< raised on abnormal change
+
+ private:
+  void Reset(void);  ///< forgets the baseline and the current window
+  void AddSample(float heading, uint32_t now_ms);
+  void EndWindow(uint32_t now_ms);
+  bool CheckWindow(const AnchorSwing& swing, char* reason, size_t size);
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  bool is_armed_;             ///< true while at anchor
+  uint window_s_;             ///< length of each window
+  float bearing_limit_;       ///< radians
+  float amplitude_ratio_;     ///< abnormal amplitude change, > 1
+  float period_ratio_;        ///< abnormal period change, > 1
+  volatile bool is_reset_needed_;  ///< set when armed or reconfigured
+  // the one-second sample being averaged
+  double sample_cos_;
+  double sample_sin_;
+  uint32_t sample_start_ms_;
+  bool has_sample_;           ///< true once sample_start_ms_ is set
+  // the window being summarized
+  double window_cos_;
+  double window_sin_;
+  uint32_t window_start_ms_;
+  float offset_min_;          ///< least offset from the running mean
+  float offset_max_;          ///< greatest offset from the running mean
+  uint crossings_;            ///< times the offset crossed zero
+  int8_t side_;               ///< side of the mean: -1, 0 (unknown), 1
+  // from earlier windows
+  float hysteresis_;          ///< offset needed to count a crossing
+  uint baseline_count_;       ///< windows in the baseline
+  AnchorSwing baseline_;      ///< exponential average of earlier windows
+  bool is_alert_;             ///< notification currently raised
+
+};  // end class AnchorSwingAnalyzer
+
+}  // namespace sensesp
+
+#endif  // anchor_swing_analyzer_H_
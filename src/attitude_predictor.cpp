@@ -0,0 +1,113 @@
+/** @file attitude_predictor.cpp
+ *  @brief Extrapolates attitude forward in time to compensate output latency.
+ */
+
+#include "attitude_predictor.h"
+
+#include "config_schema.h"
+#include "orientation_math.h"
+
+namespace sensesp {
+
+#define CONFIG_KEY_LEAD_TIME "lead_time"
+
+/**
+ * @brief Constructor sets up the prediction lead time.
+ *
+ * @param orientation_sensor Pointer to the physical sensor's interface,
+ * from which the angular rates are read.
+ * @param lead_ms Time to extrapolate forward, in ms. If 0, the latency
+ * measured by the LatencyMonitor given to set_latency_monitor() is used.
+ * @param config_path RESTful path by which the lead time can be configured.
+ */
+AttitudePredictor::AttitudePredictor(OrientationSensor* orientation_sensor,
+                                     uint lead_ms, String config_path)
+    : SymmetricTransform<Attitude>(config_path),
+      orientation_sensor_{orientation_sensor},
+      lead_ms_{lead_ms},
+      latency_monitor_{NULL} {
+  load_configuration();
+}  // end AttitudePredictor()
+
+/**
+ * @brief Extrapolates the incoming attitude and passes it on.
+ *
+ * Invalid attitudes are passed on unchanged. The epoch of the output is
+ * that of the fusion run the prediction was based on, with its wall-clock
+ * time moved on by the lead, so that the output is timestamped with the
+ * time it predicts.
+ */
+void AttitudePredictor::set_input(Attitude input, uint8_t input_channel) {
+  if (input.is_data_valid) {
+    float lead_s = lead_ms_ / 1000.0;
+    if ((0 == lead_ms_) && latency_monitor_ &&
+        latency_monitor_->GetStats().is_data_valid) {
+      lead_s = latency_monitor_->GetStats().send_p50;
+    }
+    if (lead_s > 0.0) {
+      UnitQuaternion q =
+          QuaternionFromAttitude(input.yaw, input.pitch, input.roll);
+      q = RotateByBodyRates(
+          q, orientation_sensor_->sensor_interface_->GetRollRateRadPerS(),
+          orientation_sensor_->sensor_interface_->GetPitchRateRadPerS(),
+          orientation_sensor_->sensor_interface_->GetTurnRateRadPerS(),
+          lead_s);
+      QuaternionToAttitude(q, &input.yaw, &input.pitch, &input.roll);
+      if (input.epoch.sk_time_ms) {
+        input.epoch.sk_time_ms += (uint64_t)(lead_s * 1000.0);
+      }
+    }
+  }
+  this->emit(input);
+  if (input.is_data_valid) {
+    predicted_heading_.emit(input.yaw);
+  }
+}  // end set_input()
+
+/**
+ * @brief Define the format for the AttitudePredictor configuration.
+ */
+static const char SCHEMA_PREDICTOR[] PROGMEM =
+    SCHEMA_OBJECT(SCHEMA_NUMBER(
+        CONFIG_KEY_LEAD_TIME, "Lead Time",
+        "Milliseconds to extrapolate attitude forward. 0 uses measured "
+        "latency"));
+
+/// Keys that a configuration of AttitudePredictor holds
+static const char* const kConfigKeysPredictor[] = {CONFIG_KEY_LEAD_TIME};
+
+/**
+ * @brief Get the current configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void AttitudePredictor::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_LEAD_TIME] = lead_ms_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String AttitudePredictor::get_config_schema() {
+  return FPSTR(SCHEMA_PREDICTOR);
+}
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found.
+ */
+bool AttitudePredictor::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysPredictor)) {
+    return false;
+  }
+  lead_ms_ = config[CONFIG_KEY_LEAD_TIME];
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
@@ -0,0 +1,55 @@
+/** @file attitude_predictor.h
+ *  @brief Extrapolates attitude forward in time to compensate output latency.
+ */
+
+#ifndef attitude_predictor_H_
+#define attitude_predictor_H_
+
+#include "latency_monitor.h"
+#include "orientation_sensor.h"
+#include "sensesp/transforms/transform.h"
+#include "signalk_orientation.h"
+
+namespace sensesp {
+
+/**
+ * @brief AttitudePredictor extrapolates an Attitude forward by the
+ * expected output latency, using the current angular rates.
+ *
+ * By the time a heading reaches its consumer (e.g. an autopilot) it is
+ * tens of milliseconds old, which shows up as lag during fast turns.
+ * This transform rotates the attitude by the vessel's roll, pitch, and
+ * turn rates over the lead time, integrating quaternion-wise so there is
+ * no trouble at the 0/2Pi heading wrap. The lead time is either set in
+ * the configuration, or if that is 0 it is taken from the median
+ * sensor-to-send latency measured by a LatencyMonitor.
+ *
+ * The predicted Attitude is this transform's output, and the predicted
+ * heading alone is available from predicted_heading_. The raw values
+ * remain available from the upstream producer.
+ */
+class AttitudePredictor : public SymmetricTransform<Attitude> {
+ public:
+  AttitudePredictor(OrientationSensor* orientation_sensor, uint lead_ms = 0,
+                    String config_path = "");
+  virtual void set_input(Attitude input, uint8_t input_channel = 0) override;
+  /// Sets the monitor whose measured latency is used when lead_ms is 0
+  void set_latency_monitor(LatencyMonitor* monitor) {
+    latency_monitor_ = monitor;
+  }
+  ValueProducer<float> predicted_heading_;  ///< predicted heading, in rad
+  OrientationSensor*
+      orientation_sensor_;  ///< Pointer to the orientation sensor
+
+ private:
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  uint lead_ms_;  ///< prediction lead time. 0 means use measured latency.
+  LatencyMonitor* latency_monitor_;  ///< source of measured latency
+
+};  // end class AttitudePredictor
+
+}  // namespace sensesp
+
+#endif  // attitude_predictor_H_
@@ -0,0 +1,183 @@
+/** @file attitude_resampler.cpp
+ *  @brief Resamples attitude to exact, evenly-spaced report instants.
+ */
+
+#include "attitude_resampler.h"
+
+#include "config_schema.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+/**
+ * @brief Constructor sets up the frequency of output and starts collecting
+ * fusion results.
+ *
+ * @param orientation_sensor Pointer to the physical sensor's interface
+ * @param report_interval_ms Interval between output reports
+ * @param config_path RESTful path by which reporting frequency can be
+ * configured.
+ */
+AttitudeResampler::AttitudeResampler(OrientationSensor* orientation_sensor,
+                                     uint report_interval_ms,
+                                     String config_path)
+    : Sensor(config_path),
+      orientation_sensor_{orientation_sensor},
+      samples_{},
+      newest_{0},
+      sample_count_{0},
+      schedule_origin_us_{0},
+      report_count_{0},
+      report_interval_ms_{report_interval_ms},
+      scheduler_{orientation_sensor} {
+  HEAP_COUNTER_NAME(heap_counter_, "AttitudeResampler");
+  load_configuration();
+  orientation_sensor_->attach([this]() { this->StoreSample(); });
+}  // end AttitudeResampler()
+
+/**
+ * @brief Starts periodic output of resampled Attitude.
+ *
+ * The start() function is inherited from sensesp::Sensor, and is
+ * automatically called when the SensESP app starts.
+ */
+void AttitudeResampler::start() {
+  scheduler_.Start(report_interval_ms_, [this]() { this->Update(); });
+}
+
+/**
+ * @brief Stores the latest fusion result in the ring, replacing the
+ * oldest once the ring is full.
+ *
+ * Called after every fusion run.
+ */
+void AttitudeResampler::StoreSample(void) {
+  newest_ = (newest_ + 1) % kSampleCount;
+  if (sample_count_ < kSampleCount) {
+    sample_count_++;
+  }
+  FusionSample& sample = samples_[newest_];
+  sample.is_data_valid =
+      orientation_sensor_->sensor_interface_->IsDataValid();
+  sample.q = QuaternionFromAttitude(
+      orientation_sensor_->GetHeadingRadians(),
+      orientation_sensor_->sensor_interface_->GetPitchRadians(),
+      orientation_sensor_->sensor_interface_->GetRollRadians());
+  sample.epoch = orientation_sensor_->GetFusionEpoch();
+}  // end StoreSample()
+
+/**
+ * @brief Provides the attitude at the next scheduled report instant.
+ *
+ * The report instant comes from the fixed schedule rather than from when
+ * the timer actually fired, so the output is evenly spaced in time even
+ * when the timer is not. If the timer has fallen more than one interval
+ * behind, the missed instants are skipped.
+ */
+void AttitudeResampler::Update() {
+  HEAP_SCOPE(heap_counter_);
+  const uint32_t kFusionIntervalUs = 1000000 / FUSION_HZ;
+  const uint32_t interval_us = scheduler_.get_interval_ms() * 1000;
+  if (scheduler_.get_start_us() != schedule_origin_us_) {
+    // first report of a new schedule, e.g. after the interval changed
+    schedule_origin_us_ = scheduler_.get_start_us();
+    report_count_ = 0;
+  }
+  uint32_t now_us = micros();
+  uint32_t behind_us =
+      now_us - schedule_origin_us_ - report_count_ * interval_us;
+  if ((int32_t)behind_us > (int32_t)interval_us) {
+    report_count_ += behind_us / interval_us;
+  }
+  uint32_t target_us =
+      schedule_origin_us_ + report_count_ * interval_us - kFusionIntervalUs;
+  report_count_++;
+
+  // Search back from the newest result for the one at or before the
+  // target; the result after it, if any, completes the bracketing pair.
+  const FusionSample* before = NULL;
+  const FusionSample* after = NULL;
+  for (uint8_t i = 0; i < sample_count_; i++) {
+    const FusionSample& sample =
+        samples_[(newest_ + kSampleCount - i) % kSampleCount];
+    if ((int32_t)(target_us - sample.epoch.monotonic_us) >= 0) {
+      before = &sample;
+      break;
+    }
+    after = &sample;
+  }
+
+  if (before && after) {
+    attitude_.is_data_valid = before->is_data_valid && after->is_data_valid;
+    uint32_t span_us = after->epoch.monotonic_us - before->epoch.monotonic_us;
+    uint32_t offset_us = target_us - before->epoch.monotonic_us;
+    float fraction = (span_us > 0) ? (float)offset_us / span_us : 1.0;
+    UnitQuaternion q = Slerp(before->q, after->q, fraction);
+    QuaternionToAttitude(q, &attitude_.yaw, &attitude_.pitch, &attitude_.roll);
+    attitude_.epoch = before->epoch;
+    attitude_.epoch.monotonic_us = target_us;
+    if (attitude_.epoch.sk_time_ms) {
+      attitude_.epoch.sk_time_ms += offset_us / 1000;
+    }
+  } else if (before || after) {
+    // Target is past the newest result or before the oldest kept: use
+    // the nearest result as it is, rather than extrapolate
+    const FusionSample* nearest = before ? before : after;
+    attitude_.is_data_valid = nearest->is_data_valid;
+    QuaternionToAttitude(nearest->q, &attitude_.yaw, &attitude_.pitch,
+                         &attitude_.roll);
+    attitude_.epoch = nearest->epoch;
+  } else {
+    attitude_.is_data_valid = false;  // no fusion results yet
+    attitude_.epoch = FusionEpoch{};
+  }
+
+  output = attitude_;
+  notify();
+}  // end Update()
+
+/**
+ * @brief Define the format for the AttitudeResampler configuration.
+ */
+static const char SCHEMA_RESAMPLER[] PROGMEM =
+    SCHEMA_OBJECT(SCHEMA_REPORT_INTERVAL);
+
+/// Keys that a configuration of AttitudeResampler holds
+static const char* const kConfigKeysResampler[] = {CONFIG_KEY_REPORT_INTERVAL};
+
+/**
+ * @brief Get the current sensor configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void AttitudeResampler::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_REPORT_INTERVAL] = report_interval_ms_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String AttitudeResampler::get_config_schema() {
+  return FPSTR(SCHEMA_RESAMPLER);
+}
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found.
+ */
+bool AttitudeResampler::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysResampler)) {
+    return false;
+  }
+  report_interval_ms_ = config[CONFIG_KEY_REPORT_INTERVAL];
+  scheduler_.SetInterval(report_interval_ms_);  // re-arms if running
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
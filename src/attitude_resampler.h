@@ -0,0 +1,70 @@
+/** @file attitude_resampler.h
+ *  @brief Resamples attitude to exact, evenly-spaced report instants.
+ */
+
+#ifndef attitude_resampler_H_
+#define attitude_resampler_H_
+
+#include "heap_telemetry.h"
+#include "orientation_math.h"
+#include "orientation_sensor.h"
+#include "report_scheduler.h"
+#include "sensesp/sensors/sensor.h"
+#include "signalk_orientation.h"
+
+namespace sensesp {
+
+/**
+ * @brief AttitudeResampler outputs attitude interpolated to exact,
+ * evenly-spaced instants.
+ *
+ * AttitudeValues reports whichever fusion result is current when its
+ * timer fires, so the instant each report represents jitters by up to
+ * one fusion period. This class instead keeps the kSampleCount most
+ * recent fusion results, with their timestamps, and uses SLERP to
+ * interpolate the attitude at the scheduled report instant between the
+ * two results that bracket it. Report instants are evenly spaced by
+ * report_interval_ms, and lag real time by one fusion period so that
+ * each instant normally lies between two fusion results, even when the
+ * timer fires late.
+ * The epoch of each output Attitude has monotonic_us set to the instant
+ * it represents. If no two results bracket the instant (e.g. fusion was
+ * suspended), the nearest result is output with its own epoch, so the
+ * timestamp always matches the attitude.
+ */
+class AttitudeResampler : public AttitudeProducer, public sensesp::Sensor {
+ public:
+  AttitudeResampler(OrientationSensor* orientation_sensor,
+                    uint report_interval_ms = 100, String config_path = "");
+  void start() override final;  ///< starts periodic outputs of Attitude
+  OrientationSensor*
+      orientation_sensor_;  ///< Pointer to the orientation sensor
+
+ private:
+  /// One fusion result, as kept for interpolation
+  struct FusionSample {
+    bool is_data_valid;    ///< whether the fusion result was valid
+    UnitQuaternion q;      ///< attitude
+    FusionEpoch epoch;     ///< when the attitude was measured
+  };
+  static const uint8_t kSampleCount = 8;  ///< fusion results kept, 200 ms
+  void StoreSample(void);  ///< stores latest fusion result
+  void Update(void);  ///< interpolates attitude and notifies consumer
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  FusionSample samples_[kSampleCount];  ///< ring of recent fusion results
+  uint8_t newest_;        ///< index in samples_ of the most recent result
+  uint8_t sample_count_;  ///< number of results in samples_
+  uint32_t schedule_origin_us_;  ///< instant of report number 0
+  uint32_t report_count_;        ///< number of the next report
+  Attitude attitude_;  ///< struct storing the interpolated yaw,pitch,roll
+  uint report_interval_ms_;  ///< interval between attitude updates
+  ReportScheduler scheduler_;  ///< runs Update() every report_interval_ms_
+  HEAP_COUNTER(heap_counter_)  ///< allocations made by Update()
+
+};  // end class AttitudeResampler
+
+}  // namespace sensesp
+
+#endif  // attitude_resampler_H_
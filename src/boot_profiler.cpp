@@ -0,0 +1,111 @@
+/** @file boot_profiler.cpp
+ *  @brief Timestamps of startup phases, reported once after boot.
+ */
+
+#include "boot_profiler.h"
+
+#include <WiFi.h>
+
+#include "sensesp.h"
+#include "sensesp_app.h"
+
+namespace sensesp {
+
+uint32_t BootProfiler::marks_ms_[kBootPhaseCount];
+uint16_t BootProfiler::marked_ = 0;
+
+/**
+ * @brief Constructor.
+ *
+ * @param timeout_ms The profile is reported at the latest this long after
+ * the app has started, even if some phases haven't been reached.
+ */
+BootProfiler::BootProfiler(uint timeout_ms)
+    : timeout_ms_{timeout_ms}, start_ms_{0}, repeat_{NULL} {}
+
+/**
+ * @brief Records the time a phase of startup is reached. Later calls for
+ * the same phase are ignored.
+ *
+ * @param phase The phase that has been reached.
+ */
+void BootProfiler::Mark(BootPhase phase) {
+  uint16_t bit = 1 << phase;
+  if (marked_ & bit) {
+    return;
+  }
+  marks_ms_[phase] = millis();
+  marked_ |= bit;
+}  // end Mark()
+
+/**
+ * @brief Starts polling for the connection phases.
+ *
+ * The start() function is inherited from sensesp::Startable, and is
+ * automatically called when the SensESP app starts.
+ */
+void BootProfiler::start() {
+  start_ms_ = millis();
+  repeat_ = ReactESP::app->onRepeat(100, [this]() { this->Update(); });
+}  // end start()
+
+/**
+ * @brief Marks the connection phases once they are up, and reports the
+ * profile when the last of the required phases is in or the timeout has
+ * elapsed.
+ */
+void BootProfiler::Update(void) {
+  if (WiFi.isConnected()) {
+    Mark(kBootWifiConnected);
+  }
+  if (sensesp_app->get_ws_client()->is_connected()) {
+    Mark(kBootSignalKConnected);
+  }
+  // the phases normally reached last; the others precede them, or are
+  // optional
+  const uint16_t kRequiredPhases =
+      (1 << kBootHeadingValid) | (1 << kBootSignalKConnected);
+  if ((marked_ & kRequiredPhases) != kRequiredPhases &&
+      millis() - start_ms_ < timeout_ms_) {
+    return;
+  }
+  repeat_->remove();
+  repeat_ = NULL;
+  Report();
+}  // end Update()
+
+/**
+ * @brief Returns when a phase was reached.
+ *
+ * @param phase The phase of interest.
+ * @return Seconds since power-on, or -1 if the phase wasn't reached.
+ */
+float BootProfiler::Seconds(BootPhase phase) {
+  return (marked_ & (1 << phase)) ? marks_ms_[phase] / 1000.0 : -1.0;
+}  // end Seconds()
+
+/**
+ * @brief Logs the profile and passes it to the consumers.
+ */
+void BootProfiler::Report(void) {
+  BootProfile profile;
+  profile.setup_start = Seconds(kBootSetupStart);
+  profile.app_built = Seconds(kBootAppBuilt);
+  profile.sensor_installed = Seconds(kBootSensorInstalled);
+  profile.state_restored = Seconds(kBootStateRestored);
+  profile.app_started = Seconds(kBootAppStarted);
+  profile.first_fusion = Seconds(kBootFirstFusion);
+  profile.heading_valid = Seconds(kBootHeadingValid);
+  profile.wifi_connected = Seconds(kBootWifiConnected);
+  profile.sk_connected = Seconds(kBootSignalKConnected);
+  debugI("Boot: setup %.2f app %.2f sensor %.2f restored %.2f started %.2f s",
+         profile.setup_start, profile.app_built, profile.sensor_installed,
+         profile.state_restored, profile.app_started);
+  debugI("Boot: fusion %.2f heading %.2f wifi %.2f sk %.2f s",
+         profile.first_fusion, profile.heading_valid, profile.wifi_connected,
+         profile.sk_connected);
+  output = profile;
+  notify();
+}  // end Report()
+
+}  // namespace sensesp
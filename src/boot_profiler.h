@@ -0,0 +1,65 @@
+/** @file boot_profiler.h
+ *  @brief Timestamps of startup phases, reported once after boot.
+ */
+
+#ifndef boot_profiler_H_
+#define boot_profiler_H_
+
+#include <ReactESP.h>
+
+#include "sensesp/system/startable.h"
+#include "signalk_orientation.h"
+
+namespace sensesp {
+
+/// Phases of startup, in the order they are normally reached
+enum BootPhase {
+  kBootSetupStart,
+  kBootAppBuilt,
+  kBootSensorInstalled,
+  kBootStateRestored,
+  kBootAppStarted,
+  kBootFirstFusion,
+  kBootHeadingValid,
+  kBootWifiConnected,
+  kBootSignalKConnected,
+  kBootPhaseCount
+};
+
+/**
+ * @brief BootProfiler records when each phase of startup is reached, and
+ * reports all of them once, as a BootProfile.
+ *
+ * Phases are marked with BootProfiler::Mark(), which only records the
+ * first call for each phase, so it is cheap enough to be called from the
+ * fusion loop. OrientationSensor marks the sensor and fusion phases
+ * itself; setup() should mark kBootSetupStart, kBootAppBuilt and
+ * kBootAppStarted. The WiFi and Signal K connections are polled.
+ *
+ * Times are from millis(), so they include the bootloader and Arduino
+ * startup. The profile is reported once heading is valid and Signal K is
+ * connected, or when timeout_ms has elapsed since start(), whichever is
+ * first. kBootStateRestored is optional (it is only marked on a warm
+ * start with a FusionStateStore), so it isn't waited for.
+ */
+class BootProfiler : public BootProfileProducer, public Startable {
+ public:
+  BootProfiler(uint timeout_ms = 120000);
+  static void Mark(BootPhase phase);
+  void start() override;  ///< starts polling for the connection phases
+
+ private:
+  void Update(void);  ///< polls connections, and reports when all are in
+  void Report(void);  ///< logs and emits the profile
+  static float Seconds(BootPhase phase);  ///< time of phase, or -1
+  static uint32_t marks_ms_[kBootPhaseCount];  ///< millis() at each phase
+  static uint16_t marked_;  ///< bit n is set once phase n is marked
+  uint timeout_ms_;         ///< longest time to wait for all phases
+  uint32_t start_ms_;       ///< millis() at start()
+  reactesp::RepeatReaction* repeat_;  ///< polling reaction, until reported
+
+};  // end class BootProfiler
+
+}  // namespace sensesp
+
+#endif  // boot_profiler_H_
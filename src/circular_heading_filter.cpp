@@ -0,0 +1,171 @@
+/** @file circular_heading_filter.cpp
+ *  @brief Smooths heading without trouble at the 0/2Pi wrap.
+ */
+
+#include "circular_heading_filter.h"
+
+#include "config_schema.h"
+
+namespace sensesp {
+
+#define CONFIG_KEY_WINDOW_SIZE "window_size"
+#define CONFIG_KEY_WEIGHT "weight"
+
+/**
+ * @brief Constructor sets up the kind of average.
+ *
+ * @param window_size Number of recent headings averaged equally, or 0
+ * for an exponentially-weighted average. Limited to kMaxWindowSize.
+ * @param weight Weight given to each new heading by the exponential
+ * average, in (0, 1]. Smaller is smoother but lags more.
+ * @param config_path RESTful path by which the window size and weight
+ * can be configured.
+ */
+CircularHeadingFilter::CircularHeadingFilter(uint window_size, float weight,
+                                             String config_path)
+    : SymmetricTransform<float>(config_path),
+      window_size_{window_size > kMaxWindowSize ? kMaxWindowSize
+                                                : window_size},
+      configured_window_size_{window_size_},
+      weight_{weight},
+      is_reset_needed_{false} {
+  load_configuration();
+  Reset();
+}  // end CircularHeadingFilter()
+
+/**
+ * @brief Sizes the ring for the window, and forgets all headings.
+ */
+void CircularHeadingFilter::Reset(void) {
+  is_reset_needed_ = false;
+  window_size_ = configured_window_size_;
+  cos_.assign(window_size_, 0.0);
+  sin_.assign(window_size_, 0.0);
+  next_ = 0;
+  count_ = 0;
+  sum_cos_ = 0.0;
+  sum_sin_ = 0.0;
+}  // end Reset()
+
+/**
+ * @brief Adds a heading to the average, and passes on the smoothed
+ * heading and the circular variance.
+ *
+ * @param input Heading, in radians.
+ */
+void CircularHeadingFilter::set_input(float input, uint8_t input_channel) {
+  if (isnan(input)) {
+    return;
+  }
+  if (is_reset_needed_) {
+    Reset();  // here rather than in set_configuration(), on the loop task
+  }
+  float c = cosf(input);
+  float s = sinf(input);
+  float mean_cos;
+  float mean_sin;
+  if (0 == window_size_) {
+    if (0 == count_) {
+      sum_cos_ = c;
+      sum_sin_ = s;
+      count_ = 1;
+    } else {
+      sum_cos_ += weight_ * (c - sum_cos_);
+      sum_sin_ += weight_ * (s - sum_sin_);
+    }
+    mean_cos = sum_cos_;
+    mean_sin = sum_sin_;
+  } else {
+    if (count_ == window_size_) {
+      sum_cos_ -= cos_[next_];  // drop the oldest
+      sum_sin_ -= sin_[next_];
+    } else {
+      count_++;
+    }
+    cos_[next_] = c;
+    sin_[next_] = s;
+    sum_cos_ += c;
+    sum_sin_ += s;
+    next_ = (next_ + 1) % window_size_;
+    mean_cos = sum_cos_ / count_;
+    mean_sin = sum_sin_ / count_;
+  }
+
+  float heading = atan2f(mean_sin, mean_cos);
+  if (heading < 0.0) {
+    heading += 2.0 * PI;
+  }
+  float r = sqrtf(mean_cos * mean_cos + mean_sin * mean_sin);
+  this->emit(heading);
+  circular_variance_.emit(r < 1.0 ? 1.0 - r : 0.0);
+}  // end set_input()
+
+/**
+ * @brief Define the format for the CircularHeadingFilter configuration.
+ */
+static const char SCHEMA_CIRCULAR[] PROGMEM = SCHEMA_OBJECT(
+    SCHEMA_NUMBER(CONFIG_KEY_WINDOW_SIZE, "Window Size",
+                  "Number of headings averaged, at most 1024. 0 for "
+                  "exponential averaging")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_WEIGHT, "Weight",
+                       "Weight of each new heading in exponential averaging, "
+                       "0 to 1. Smaller is smoother"));
+
+/// Keys that a configuration of CircularHeadingFilter holds
+static const char* const kConfigKeysCircular[] = {CONFIG_KEY_WINDOW_SIZE,
+                                                  CONFIG_KEY_WEIGHT};
+
+/**
+ * @brief Get the current configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void CircularHeadingFilter::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_WINDOW_SIZE] = configured_window_size_;
+  doc[CONFIG_KEY_WEIGHT] = weight_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String CircularHeadingFilter::get_config_schema() {
+  return FPSTR(SCHEMA_CIRCULAR);
+}
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * A changed window size takes effect, with an empty history, at the
+ * next input.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found,
+ * the weight is outside (0, 1] or the window size exceeds kMaxWindowSize.
+ */
+bool CircularHeadingFilter::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysCircular)) {
+    return false;
+  }
+  float weight = config[CONFIG_KEY_WEIGHT];
+  if (weight <= 0.0 || weight > 1.0) {
+    return false;
+  }
+  uint window_size = config[CONFIG_KEY_WINDOW_SIZE];
+  if (window_size > kMaxWindowSize) {
+    debugE("Heading filter window size %u exceeds %u", window_size,
+           kMaxWindowSize);
+    return false;
+  }
+  weight_ = weight;
+  if (window_size != configured_window_size_) {
+    configured_window_size_ = window_size;
+    is_reset_needed_ = true;
+  }
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
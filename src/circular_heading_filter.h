@@ -0,0 +1,65 @@
+/** @file circular_heading_filter.h
+ *  @brief Smooths heading without trouble at the 0/2Pi wrap.
+ */
+
+#ifndef circular_heading_filter_H_
+#define circular_heading_filter_H_
+
+#include <vector>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+/**
+ * @brief CircularHeadingFilter smooths a heading, or any other angle, by
+ * averaging unit vectors rather than the angles themselves.
+ *
+ * The usual moving-average transforms fail at the 0/2Pi wrap: the mean
+ * of 359 and 1 degrees comes out as 180. Here each heading is turned
+ * into its (cos, sin) unit vector, those are averaged, and the smoothed
+ * heading is the direction of the mean vector.
+ *
+ * With a window size of 0 the average is exponentially weighted, giving
+ * each new heading the configured weight. Otherwise it is the plain mean
+ * of the last window_size headings, kept as running sums of a ring of
+ * vectors, so each heading costs the same however large the window. The
+ * window holds at most kMaxWindowSize headings, since the ring is
+ * allocated whole and a failed allocation aborts.
+ *
+ * The length R of the mean vector shows how tightly the headings are
+ * grouped. The circular variance, 1 - R, is 0 when all headings are the
+ * same and approaches 1 as they spread around the compass. It is
+ * available from circular_variance_.
+ *
+ * Inputs and the output are in radians; the output is within [0, 2Pi).
+ */
+class CircularHeadingFilter : public SymmetricTransform<float> {
+ public:
+  static const uint kMaxWindowSize = 1024;  ///< largest window accepted
+  CircularHeadingFilter(uint window_size = 0, float weight = 0.2,
+                        String config_path = "");
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+  ValueProducer<float> circular_variance_;  ///< 1 - R, in [0, 1]
+
+ private:
+  void Reset(void);  ///< applies configured_window_size_, clears history
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  uint window_size_;         ///< headings averaged; 0 for exponential
+  uint configured_window_size_;  ///< window size to apply at next Reset()
+  float weight_;             ///< weight of each new heading, exponential
+  volatile bool is_reset_needed_;  ///< set when window size is changed
+  std::vector<float> cos_;   ///< ring of the window's cosines
+  std::vector<float> sin_;   ///< ring of the window's sines
+  size_t next_;              ///< ring index of the oldest heading
+  size_t count_;             ///< headings in the ring, up to window_size_
+  double sum_cos_;           ///< sum of cos_, or exponential mean of cosine
+  double sum_sin_;           ///< sum of sin_, or exponential mean of sine
+
+};  // end class CircularHeadingFilter
+
+}  // namespace sensesp
+
+#endif  // circular_heading_filter_H_
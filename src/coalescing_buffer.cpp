@@ -0,0 +1,88 @@
+/** @file coalescing_buffer.cpp
+ *  @brief Keeps only the newest value for a Signal K path while the
+ * connection to the server cannot keep up.
+ */
+
+#include "coalescing_buffer.h"
+
+#include <algorithm>
+
+#include "heap_telemetry.h"
+#include "sensesp_app.h"
+
+namespace sensesp {
+
+std::vector<CoalescingBufferBase*> CoalescingBufferBase::buffers_;
+
+/**
+ * @brief Constructor registers the buffer, and on the first one starts
+ * checking whether the transport is ready.
+ */
+CoalescingBufferBase::CoalescingBufferBase()
+    : is_pending_{false}, coalesced_count_{0}, dropped_count_{0} {
+  if (buffers_.empty()) {
+    ReactESP::app->onTick([]() { CoalescingBufferBase::ReleaseIfReady(); });
+  }
+  buffers_.push_back(this);
+}  // end CoalescingBufferBase()
+
+CoalescingBufferBase::~CoalescingBufferBase() {
+  buffers_.erase(std::remove(buffers_.begin(), buffers_.end(), this),
+                 buffers_.end());
+}  // end ~CoalescingBufferBase()
+
+/**
+ * @brief Counts a pending value being replaced by a newer one.
+ *
+ * If the websocket is connected, the value was waiting for the delta
+ * queue to drain and is counted as coalesced; otherwise it could never
+ * have been sent and is counted as dropped.
+ */
+void CoalescingBufferBase::CountOverwrite(void) {
+  if (sensesp_app->get_ws_client()->is_connected()) {
+    coalesced_count_++;
+  } else {
+    dropped_count_++;
+  }
+}  // end CountOverwrite()
+
+/**
+ * @brief Releases the pending value of every buffer, but only when the
+ * websocket is connected and the previous deltas have been sent.
+ */
+void CoalescingBufferBase::ReleaseIfReady(void) {
+  HEAP_SCOPE_STATIC("CoalescingBuffer");
+  if (!sensesp_app->get_ws_client()->is_connected() ||
+      sensesp_app->get_sk_delta()->data_available()) {
+    return;
+  }
+  for (auto buffer : buffers_) {
+    if (buffer->is_pending_) {
+      buffer->Release();
+    }
+  }
+}  // end ReleaseIfReady()
+
+/**
+ * @brief Returns the number of coalesced values, summed over all buffers.
+ */
+uint32_t CoalescingBufferBase::get_total_coalesced_count(void) {
+  uint32_t total = 0;
+  for (auto buffer : buffers_) {
+    total += buffer->coalesced_count_;
+  }
+  return total;
+}  // end get_total_coalesced_count()
+
+/**
+ * @brief Returns the number of dropped values, summed over all buffers.
+ */
+uint32_t CoalescingBufferBase::get_total_dropped_count(void) {
+  uint32_t total = 0;
+  for (auto buffer : buffers_) {
+    total += buffer->dropped_count_;
+  }
+  return total;
+}  // end get_total_dropped_count()
+
+}  // namespace sensesp
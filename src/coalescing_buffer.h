@@ -0,0 +1,89 @@
+/** @file coalescing_buffer.h
+ *  @brief Keeps only the newest value for a Signal K path while the
+ * connection to the server cannot keep up.
+ */
+
+#ifndef coalescing_buffer_H_
+#define coalescing_buffer_H_
+
+#include <vector>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+/**
+ * @brief Non-template part of CoalescingBuffer: the registry of buffers,
+ * the counters, and the release of buffered values when the transport
+ * is ready.
+ *
+ * One ReactESP tick reaction, shared by all buffers, checks whether the
+ * websocket is connected and the Signal K delta queue has been drained.
+ * Only then are the buffered values passed on, which is when SKOutput
+ * serializes them. While the transport is busy, each buffer holds only
+ * its newest value, so memory use is fixed at one value per path no
+ * matter how long the stall lasts.
+ */
+class CoalescingBufferBase {
+ public:
+  CoalescingBufferBase();
+  virtual ~CoalescingBufferBase();
+  /// Number of values replaced by a newer one while waiting to be sent
+  uint32_t get_coalesced_count(void) const { return coalesced_count_; }
+  /// Number of values replaced by a newer one while disconnected
+  uint32_t get_dropped_count(void) const { return dropped_count_; }
+  static uint32_t get_total_coalesced_count(void);  ///< sum over all buffers
+  static uint32_t get_total_dropped_count(void);    ///< sum over all buffers
+
+ protected:
+  void CountOverwrite(void);  ///< counts the replacement of a pending value
+  virtual void Release(void) = 0;  ///< passes on the buffered value
+  bool is_pending_;  ///< true if a value is waiting to be released
+
+ private:
+  static void ReleaseIfReady(void);  ///< releases all if transport is ready
+  static std::vector<CoalescingBufferBase*> buffers_;  ///< all buffers
+  uint32_t coalesced_count_;  ///< values replaced while transport was busy
+  uint32_t dropped_count_;    ///< values replaced while disconnected
+};
+
+/**
+ * @brief A transform, placed immediately before an SKOutput, that
+ * passes on only the newest value once the transport is ready for it.
+ *
+ * Without it, every emission is serialized into a String and queued
+ * even while the server connection is stalled, so memory grows and the
+ * values eventually delivered are stale. Since each SKOutput has one
+ * Signal K path, a buffer in front of it coalesces that path's values.
+ *
+ * A LatencyMonitor is given to the SKOutput after the buffer, which
+ * records a value when it serializes it. The time a value was held in
+ * the buffer is therefore part of the latencies reported.
+ */
+template <typename T>
+class CoalescingBuffer : public CoalescingBufferBase,
+                         public SymmetricTransform<T> {
+ public:
+  CoalescingBuffer(String config_path = "")
+      : CoalescingBufferBase(), SymmetricTransform<T>(config_path) {}
+
+  virtual void set_input(T new_value, uint8_t input_channel = 0) override {
+    if (is_pending_) {
+      CountOverwrite();
+    }
+    latest_ = new_value;
+    is_pending_ = true;
+  }
+
+ protected:
+  virtual void Release(void) override {
+    is_pending_ = false;
+    this->emit(latest_);
+  }
+
+  T latest_;  ///< newest value not yet passed on
+};
+
+}  // namespace sensesp
+
+#endif  // coalescing_buffer_H_
@@ -0,0 +1,62 @@
+/** @file config_schema.h
+ *  @brief Configuration keys and schema fragments shared by the
+ *  orientation producers.
+ *
+ * Keys are defined once and used by the schemas, get_configuration()
+ * and set_configuration() alike, so the three can't drift apart. The
+ * schemas are assembled from the fragments by the preprocessor into
+ * single string literals, and the key lists are constant arrays of
+ * const char*, so neither is built at run time.
+ */
+
+#ifndef config_schema_H_
+#define config_schema_H_
+
+#include <ArduinoJson.h>
+
+namespace sensesp {
+
+#define CONFIG_KEY_REPORT_INTERVAL "report_interval"
+#define CONFIG_KEY_SAVE_MAG_CAL "save_mag_cal"
+#define CONFIG_KEY_TICK_INTERVAL "tick_interval"
+
+/// One numeric property of a JSON schema
+#define SCHEMA_NUMBER(key, title, description)                       \
+  "\"" key "\": { \"title\": \"" title "\", \"type\": \"number\", " \
+  "\"description\": \"" description "\" }"
+
+/// A JSON schema object with the given, comma-separated, properties
+#define SCHEMA_OBJECT(properties) \
+  "{ \"type\": \"object\", \"properties\": { " properties " } }"
+
+#define SCHEMA_REPORT_INTERVAL                                \
+  SCHEMA_NUMBER(CONFIG_KEY_REPORT_INTERVAL, "Report Interval", \
+                "Milliseconds between outputs of this parameter")
+
+#define SCHEMA_SAVE_MAG_CAL                                   \
+  SCHEMA_NUMBER(CONFIG_KEY_SAVE_MAG_CAL, "Save Magnetic Cal", \
+                "Set to 1 to save current magnetic calibration")
+
+/**
+ * @brief Checks that config holds every one of keys.
+ *
+ * Keys are looked up as const char*, so no temporary Strings are made.
+ *
+ * @param config JSON object containing the configuration parameters.
+ * @param keys Array of the keys that are required.
+ * @return True if all keys are present.
+ */
+template <size_t N>
+inline bool ContainsAllKeys(const JsonObject& config,
+                            const char* const (&keys)[N]) {
+  for (size_t i = 0; i < N; i++) {
+    if (!config.containsKey(keys[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace sensesp
+
+#endif  // config_schema_H_
@@ -0,0 +1,110 @@
+/** @file fan_out.h
+ *  @brief Passes each fusion result to several consumers, converting it
+ * only once.
+ */
+
+#ifndef fan_out_H_
+#define fan_out_H_
+
+#include <functional>
+#include <vector>
+
+#include "orientation_sensor.h"
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+/**
+ * @brief FanOut is a transform to which all the consumers of one value
+ * connect, so that the value is converted once and shared, rather than
+ * once by each consumer.
+ *
+ * Consumers are added either with connect_to(), as for any producer, or
+ * with add_consumer(), for code outside the SensESP graph (e.g. a logger
+ * or an NMEA 2000 encoder). SensESP passes values to its consumers by
+ * copy, while added functions receive a const reference to the one stored
+ * result, which matters for larger types such as Attitude.
+ *
+ * A value with the same fusion epoch as the previous one is the same
+ * result again (e.g. the report interval is shorter than the fusion
+ * interval, or fusion is suspended for a vibration burst), so it is
+ * neither converted nor passed on, and nothing downstream serializes it
+ * again. This is where repeats are stopped: an SKOutput serializes every
+ * value it is given, as returning a cached delta would cost a copy of its
+ * text each time. Values that carry their own epoch (Attitude, MagCal)
+ * are compared by it, including its time, so resampled values between
+ * two fusion runs aren't repeats. Other values are compared by the
+ * current epoch of the OrientationSensor, if one is given. Values from
+ * before the first fusion run (sequence 0) are always passed on.
+ *
+ * @tparam IN Type of the input.
+ * @tparam OUT Type given to the consumers, by default that of the input.
+ */
+template <typename IN, typename OUT = IN>
+class FanOut : public Transform<IN, OUT> {
+ public:
+  typedef std::function<OUT(const IN&)> Converter;
+  typedef std::function<void(const OUT&)> Consumer;
+
+  /**
+   * @param orientation_sensor Sensor whose fusion epoch identifies repeated
+   * values that carry no epoch of their own, or NULL to pass all of
+   * those on.
+   * @param convert Conversion from input to output, or nullptr to assign
+   * the input unchanged.
+   * @param config_path Configuration path; FanOut has no configuration.
+   */
+  FanOut(OrientationSensor* orientation_sensor = NULL,
+         Converter convert = nullptr, String config_path = "")
+      : Transform<IN, OUT>(config_path),
+        orientation_sensor_{orientation_sensor},
+        convert_{convert},
+        last_epoch_{},
+        repeat_count_{0} {}
+
+  /// Adds a function to be called with each new output
+  void add_consumer(Consumer consumer) { consumers_.push_back(consumer); }
+
+  /// Number of values not passed on because their epoch was already seen
+  uint32_t get_repeat_count(void) const { return repeat_count_; }
+
+  virtual void set_input(IN input, uint8_t input_channel = 0) override {
+    FusionEpoch epoch = EpochOf(input, 0);
+    if (0 != epoch.sequence && epoch.sequence == last_epoch_.sequence &&
+        epoch.monotonic_us == last_epoch_.monotonic_us) {
+      repeat_count_++;
+      return;
+    }
+    last_epoch_ = epoch;
+    this->output = convert_ ? convert_(input) : (OUT)input;
+    for (auto& consumer : consumers_) {
+      consumer(this->output);
+    }
+    this->notify();
+  }
+
+ private:
+  /// Epoch carried by the value itself, for types with one
+  template <typename T>
+  auto EpochOf(const T& value, int) -> decltype(value.epoch) {
+    return value.epoch;
+  }
+
+  /// Otherwise the sensor's current epoch, or none if there is no sensor
+  template <typename T>
+  FusionEpoch EpochOf(const T&, long) {
+    return orientation_sensor_ ? orientation_sensor_->GetFusionEpoch()
+                               : FusionEpoch{};
+  }
+
+  OrientationSensor* orientation_sensor_;  ///< source of the fusion epoch
+  Converter convert_;                ///< applied once per new value
+  std::vector<Consumer> consumers_;  ///< functions added by add_consumer()
+  FusionEpoch last_epoch_;  ///< fusion epoch of the last value passed on
+  uint32_t repeat_count_;   ///< values dropped as repeats of an epoch
+
+};  // end class FanOut
+
+}  // namespace sensesp
+
+#endif  // fan_out_H_
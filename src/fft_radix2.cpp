@@ -0,0 +1,84 @@
+/** @file fft_radix2.cpp
+ *  @brief In-place radix-2 FFT for spectra of short sample bursts.
+ */
+
+#include "fft_radix2.h"
+
+#include <math.h>
+
+namespace sensesp {
+
+/**
+ * @brief Returns true if n is a power of two, and at least 2.
+ */
+bool IsPowerOfTwo(size_t n) { return n >= 2 && 0 == (n & (n - 1)); }
+
+/**
+ * @brief Multiplies samples by a Hann window, reducing the leakage of
+ * each frequency into its neighbours.
+ *
+ * The window's mean square is 3/8, which scales the power of the
+ * windowed spectrum.
+ *
+ * @param samples The samples, windowed in place.
+ * @param n Number of samples.
+ */
+void ApplyHannWindow(float* samples, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    samples[i] *= 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / n);
+  }
+}  // end ApplyHannWindow()
+
+/**
+ * @brief Replaces a complex sequence by its discrete Fourier transform.
+ *
+ * Iterative decimation in time: the samples are put in bit-reversed
+ * order, then combined by butterflies of doubling span. Each span's
+ * twiddle factor is advanced by a rotation rather than computed with
+ * sin/cos per butterfly. No memory is allocated.
+ *
+ * @param re Real parts; replaced by the real parts of the transform.
+ * @param im Imaginary parts; replaced likewise. Zero for real samples.
+ * @param n Length, a power of two.
+ */
+void FftInPlace(float* re, float* im, size_t n) {
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j |= bit;
+    if (i < j) {
+      float t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+  for (size_t span = 2; span <= n; span <<= 1) {
+    double angle = -2.0 * M_PI / span;
+    float step_re = cos(angle);
+    float step_im = sin(angle);
+    for (size_t start = 0; start < n; start += span) {
+      float w_re = 1.0f;
+      float w_im = 0.0f;
+      for (size_t k = 0; k < span / 2; k++) {
+        size_t a = start + k;
+        size_t b = a + span / 2;
+        float t_re = re[b] * w_re - im[b] * w_im;
+        float t_im = re[b] * w_im + im[b] * w_re;
+        re[b] = re[a] - t_re;
+        im[b] = im[a] - t_im;
+        re[a] += t_re;
+        im[a] += t_im;
+        float next_re = w_re * step_re - w_im * step_im;
+        w_im = w_re * step_im + w_im * step_re;
+        w_re = next_re;
+      }
+    }
+  }
+}  // end FftInPlace()
+
+}  // namespace sensesp
@@ -0,0 +1,21 @@
+/** @file fft_radix2.h
+ *  @brief In-place radix-2 FFT for spectra of short sample bursts.
+ *
+ * This file does not depend on Arduino or SensESP, so it can be checked
+ * on a desktop machine.
+ */
+
+#ifndef fft_radix2_H_
+#define fft_radix2_H_
+
+#include <stddef.h>
+
+namespace sensesp {
+
+bool IsPowerOfTwo(size_t n);
+void ApplyHannWindow(float* samples, size_t n);
+void FftInPlace(float* re, float* im, size_t n);
+
+}  // namespace sensesp
+
+#endif  // fft_radix2_H_
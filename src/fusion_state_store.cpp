@@ -0,0 +1,143 @@
+/** @file fusion_state_store.cpp
+ *  @brief Keeps the latest fusion state in flash, for a warm start after
+ *  a reboot.
+ */
+
+#include "fusion_state_store.h"
+
+#include <Preferences.h>
+
+#include "boot_profiler.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+/// NVS namespace and key of the saved state
+static const char* kNamespace = "fusion_state";
+static const char* kKey = "state";
+
+/**
+ * @brief Constructor restores the saved state, starts periodic checks
+ * of whether the state should be saved, and if a state was restored,
+ * starts reporting it.
+ *
+ * @param orientation_sensor Pointer to the physical sensor's interface.
+ * @param save_interval_s Minimum interval between saves, in seconds.
+ * @param provisional_ms How long after boot the restored attitude may
+ * be reported while fusion isn't yet valid. 0 disables it.
+ */
+FusionStateStore::FusionStateStore(OrientationSensor* orientation_sensor,
+                                   uint save_interval_s, uint provisional_ms)
+    : orientation_sensor_{orientation_sensor},
+      save_interval_ms_{save_interval_s * 1000},
+      provisional_ms_{provisional_ms},
+      is_restored_{false},
+      last_save_ms_{0},
+      save_count_{0},
+      provisional_{NULL} {
+  memset(&restored_, 0, sizeof(restored_));
+  Load();
+  saved_ = restored_;
+  ReactESP::app->onRepeat(kCheckIntervalMs, [this]() { this->Update(); });
+  if (is_restored_ && provisional_ms_ > 0) {
+    provisional_ = ReactESP::app->onRepeat(
+        kProvisionalIntervalMs, [this]() { this->ReportProvisional(); });
+  }
+}  // end FusionStateStore()
+
+/**
+ * @brief Reads the saved state from NVS.
+ */
+void FusionStateStore::Load(void) {
+  Preferences preferences;
+  if (!preferences.begin(kNamespace, true)) {  // read-only
+    debugI("FusionState: no saved state");
+    return;
+  }
+  size_t length = preferences.getBytes(kKey, &restored_, sizeof(restored_));
+  preferences.end();
+  if (length != sizeof(restored_) || restored_.version != kVersion) {
+    debugI("FusionState: no saved state");
+    return;
+  }
+  is_restored_ = true;
+  BootProfiler::Mark(kBootStateRestored);
+  debugI("FusionState: restored yaw %.3f pitch %.3f roll %.3f fit %.1f",
+         restored_.yaw, restored_.pitch, restored_.roll,
+         restored_.mag_fit_error);
+}  // end Load()
+
+/**
+ * @brief Outputs the restored attitude while fusion isn't yet valid.
+ *
+ * The attitude carries the epoch of the save rather than a fusion run:
+ * sequence 0, and the wall-clock time it was saved, which is sent as its
+ * timestamp. Once fusion is valid or provisional_ms has passed, an
+ * invalid attitude with the current epoch is output to clear it, and
+ * reporting stops.
+ */
+void FusionStateStore::ReportProvisional(void) {
+  bool is_over = orientation_sensor_->sensor_interface_->IsDataValid() ||
+                 (millis() > provisional_ms_);
+  Attitude attitude;
+  attitude.is_data_valid = !is_over;
+  attitude.yaw = restored_.yaw;
+  attitude.pitch = restored_.pitch;
+  attitude.roll = restored_.roll;
+  if (is_over) {
+    attitude.epoch = orientation_sensor_->GetFusionEpoch();
+  } else {
+    attitude.epoch = {0, 0, restored_.sk_time_ms};
+  }
+  output = attitude;
+  notify();
+  if (is_over) {
+    provisional_->remove();
+    provisional_ = NULL;
+  }
+}  // end ReportProvisional()
+
+/**
+ * @brief Saves the current state if the save interval has elapsed, the
+ * fusion result is valid and not magnetically disturbed, and the heading
+ * has changed noticeably.
+ */
+void FusionStateStore::Update(void) {
+  SensorFusion* fusion = orientation_sensor_->sensor_interface_;
+  uint32_t now_ms = millis();
+  if ((save_count_ > 0 && now_ms - last_save_ms_ < save_interval_ms_) ||
+      !fusion->IsDataValid() || orientation_sensor_->IsMagneticallyDisturbed()) {
+    return;
+  }
+  State state;
+  memset(&state, 0, sizeof(state));  // padding is saved too
+  state.version = kVersion;
+  state.yaw = fusion->GetHeadingRadians();
+  state.pitch = fusion->GetPitchRadians();
+  state.roll = fusion->GetRollRadians();
+  state.mag_noise_covariance = fusion->GetMagneticNoiseCovariance();
+  state.mag_fit_error = fusion->GetMagneticFitError();
+  state.sk_time_ms = orientation_sensor_->GetFusionEpoch().sk_time_ms;
+
+  float change = fabsf(state.yaw - saved_.yaw);
+  if (change > PI) {
+    change = 2 * PI - change;  // across north
+  }
+  if (is_restored_ || save_count_ > 0) {
+    if (change < kMinHeadingChange) {
+      return;
+    }
+  }
+  Preferences preferences;
+  if (!preferences.begin(kNamespace, false)) {
+    debugE("FusionState: cannot open NVS");
+    return;
+  }
+  preferences.putBytes(kKey, &state, sizeof(state));
+  preferences.end();
+  saved_ = state;
+  last_save_ms_ = now_ms;
+  save_count_++;
+}  // end Update()
+
+}  // namespace sensesp
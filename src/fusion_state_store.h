@@ -0,0 +1,88 @@
+/** @file fusion_state_store.h
+ *  @brief Keeps the latest fusion state in flash, for a warm start after
+ *  a reboot.
+ */
+
+#ifndef fusion_state_store_H_
+#define fusion_state_store_H_
+
+#include <ReactESP.h>
+
+#include "orientation_sensor.h"
+#include "signalk_orientation.h"
+
+namespace sensesp {
+
+/**
+ * @brief FusionStateStore saves a compact summary of the fusion state to
+ * non-volatile storage now and then, and restores it at boot.
+ *
+ * After a brownout the fusion filter starts from scratch, and attitude
+ * isn't reported until it is valid again. Until then, and for at most
+ * provisional_ms after boot, the store itself outputs the restored
+ * attitude once a second, for a path of its own. It is never passed off
+ * as a current value on the normal attitude and heading paths: the state
+ * may be many minutes old, and an autopilot must not steer by it. Its
+ * epoch has sequence 0 and the wall-clock time of the save, so an
+ * SKOutputAttitude sends it with the save time as its Signal K
+ * timestamp, and a consumer can tell how old it is. When fusion becomes
+ * valid or the time runs out, one final invalid attitude, with the
+ * current epoch, clears the provisional path.
+ *
+ * The state is kept in the ESP32's NVS partition, whose writes are
+ * atomic and wear-levelled across the partition. Writes are further
+ * limited to at most one per save_interval_s, and only when the state is
+ * valid and the heading has changed by more than kMinHeadingChange since
+ * the previous save, so a vessel at a mooring rarely writes at all.
+ *
+ * The magnetic calibration is saved by the fusion library itself; the
+ * noise covariance and fit error saved here indicate how much the
+ * restored attitude can be trusted. The filter itself is not seeded:
+ * the OrientationSensorFusion-ESP library, a lib_deps dependency, keeps
+ * its quaternion and gyro bias private and has no interface for reading
+ * or setting them, and it initializes them itself when fusion starts.
+ * The filter reconverges as before, while the restored attitude covers
+ * the gap. tools/boot_timing.cpp compares the time to valid fusion, and
+ * to a first heading output, of warm and cold starts.
+ */
+class FusionStateStore : public AttitudeProducer {
+ public:
+  FusionStateStore(OrientationSensor* orientation_sensor,
+                   uint save_interval_s = 900, uint provisional_ms = 15000);
+  /// Returns true if a saved state was found at boot
+  bool is_restored(void) const { return is_restored_; }
+
+ private:
+  /// What is saved. Add fields at the end, and increment kVersion.
+  struct State {
+    uint8_t version;             ///< kVersion when saved
+    float yaw;                   ///< heading, in radians
+    float pitch;                 ///< pitch, in radians
+    float roll;                  ///< roll, in radians
+    float mag_noise_covariance;  ///< magnetic noise when saved
+    float mag_fit_error;         ///< magnetic calibration fit error, percent
+    uint64_t sk_time_ms;         ///< wall-clock time of the save, or 0
+  };
+  static const uint8_t kVersion = 2;
+  static const uint32_t kCheckIntervalMs = 10000;  ///< how often to check
+  static const uint32_t kProvisionalIntervalMs = 1000;  ///< output interval
+  static constexpr float kMinHeadingChange = 0.035;  ///< radians, about 2 deg
+
+  void Load(void);    ///< reads the saved state, if any
+  void Update(void);  ///< saves the state if due and changed
+  void ReportProvisional(void);  ///< outputs the restored attitude
+  OrientationSensor* orientation_sensor_;  ///< source of the state
+  uint32_t save_interval_ms_;  ///< minimum interval between saves
+  uint provisional_ms_;        ///< how long after boot restored state is used
+  State restored_;             ///< state read at boot
+  State saved_;                ///< state most recently saved
+  bool is_restored_;           ///< true if restored_ holds a saved state
+  uint32_t last_save_ms_;      ///< millis() at the previous save
+  uint32_t save_count_;        ///< saves since boot
+  reactesp::RepeatReaction* provisional_;  ///< runs ReportProvisional()
+
+};  // end class FusionStateStore
+
+}  // namespace sensesp
+
+#endif  // fusion_state_store_H_
@@ -0,0 +1,56 @@
+/** @file heading_nmea0183.cpp
+ *  @brief Magnetic heading sent as NMEA 0183 sentences on a serial port.
+ */
+
+#include "heading_nmea0183.h"
+
+namespace sensesp {
+
+/**
+ * @brief Constructor.
+ *
+ * @param port Serial port the sentences are written to, already begun
+ * at the desired baud rate (4800 for standard NMEA 0183).
+ * @param report_interval_ms Minimum interval between sentences. A
+ * sentence is sent only when a heading arrives, so the interval is
+ * rounded up to a multiple of the heading's report interval.
+ */
+HeadingNMEA0183::HeadingNMEA0183(Stream* port, uint report_interval_ms)
+    : port_{port},
+      report_interval_ms_{report_interval_ms},
+      last_report_ms_{0},
+      has_reported_{false} {}
+
+/**
+ * @brief Sends a sentence with the heading if the interval has elapsed.
+ *
+ * @param heading Deviation-corrected magnetic heading, in radians.
+ */
+void HeadingNMEA0183::set_input(float heading, uint8_t input_channel) {
+  uint32_t now_ms = millis();
+  if (has_reported_ && (now_ms - last_report_ms_ < report_interval_ms_)) {
+    return;
+  }
+  last_report_ms_ = now_ms;
+  has_reported_ = true;
+  heading = fmodf(heading, 2.0 * PI);
+  if (heading < 0.0) {
+    heading += 2.0 * PI;
+  }
+  float degrees = heading * 180.0 / PI;
+  if (degrees >= 359.95) {
+    degrees = 0.0;  // so it isn't rounded to 360.0
+  }
+
+  char sentence[24];
+  int length = snprintf(sentence, sizeof(sentence), "$HCHDM,%.1f,M", degrees);
+  uint8_t checksum = 0;
+  for (int i = 1; i < length; i++) {  // all characters between $ and *
+    checksum ^= sentence[i];
+  }
+  snprintf(sentence + length, sizeof(sentence) - length, "*%02X\r\n",
+           checksum);
+  port_->print(sentence);
+}  // end set_input()
+
+}  // namespace sensesp
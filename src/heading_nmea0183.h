@@ -0,0 +1,40 @@
+/** @file heading_nmea0183.h
+ *  @brief Magnetic heading sent as NMEA 0183 sentences on a serial port.
+ */
+
+#ifndef heading_nmea0183_H_
+#define heading_nmea0183_H_
+
+#include <Arduino.h>
+
+#include "sensesp/system/valueconsumer.h"
+
+namespace sensesp {
+
+/**
+ * @brief HeadingNMEA0183 writes the compass heading as NMEA 0183 HDM
+ * sentences, e.g. $HCHDM,238.5,M*25, to a serial port.
+ *
+ * Its input is magnetic heading in radians, taken from the end of the
+ * heading chain, so the mounting offset and deviation corrections
+ * configured there apply to the sentences too, as HDM requires. The
+ * chain runs from the first loop() pass, so sentences are sent as soon
+ * as fusion has a valid heading, while WiFi and the Signal K connection
+ * are still coming up, and continue if they are lost.
+ */
+class HeadingNMEA0183 : public ValueConsumer<float> {
+ public:
+  HeadingNMEA0183(Stream* port, uint report_interval_ms = 100);
+  virtual void set_input(float heading, uint8_t input_channel = 0) override;
+
+ private:
+  Stream* port_;              ///< where sentences are written
+  uint report_interval_ms_;   ///< minimum interval between sentences
+  uint32_t last_report_ms_;   ///< millis() at the previous sentence
+  bool has_reported_;         ///< true once a sentence has been sent
+
+};  // end class HeadingNMEA0183
+
+}  // namespace sensesp
+
+#endif  // heading_nmea0183_H_
@@ -0,0 +1,236 @@
+/** @file heap_telemetry.cpp
+ *  @brief Heap fragmentation and allocation-rate telemetry.
+ */
+
+#include "heap_telemetry.h"
+
+#include <esp_heap_caps.h>
+#include <string.h>
+
+#include "config_schema.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+HeapCounter* HeapCounter::first_ = NULL;
+HeapCounter* HeapScope::current_ = NULL;
+void* HeapTelemetry::loop_task_ = NULL;
+HeapCounter HeapTelemetry::unattributed_("loop task, unattributed");
+HeapCounter HeapTelemetry::other_tasks_("other tasks");
+
+/**
+ * @brief Constructor adds the counter to the list of all counters.
+ *
+ * @param name Name used when reporting, copied into the counter.
+ */
+HeapCounter::HeapCounter(const char* name)
+    : allocations_{0},
+      bytes_{0},
+      reported_allocations_{0},
+      reported_bytes_{0},
+      period_allocations_{0},
+      period_bytes_{0},
+      next_{first_} {
+  set_name(name);
+  first_ = this;
+}  // end HeapCounter()
+
+/**
+ * @brief Destructor removes the counter from the list of all counters.
+ */
+HeapCounter::~HeapCounter() {
+  for (HeapCounter** c = &first_; *c != NULL; c = &(*c)->next_) {
+    if (*c == this) {
+      *c = next_;
+      break;
+    }
+  }
+}  // end ~HeapCounter()
+
+/**
+ * @brief Sets the name used when reporting.
+ *
+ * @param name The name, truncated to kNameSize - 1 characters.
+ */
+void HeapCounter::set_name(const char* name) {
+  strncpy(name_, name, kNameSize - 1);
+  name_[kNameSize - 1] = '\0';
+}  // end set_name()
+
+/**
+ * @brief Constructor sets up the frequency of reports.
+ *
+ * Must be constructed from setup(), as the task it is constructed in is
+ * taken to be the main loop task.
+ *
+ * @param report_interval_ms Interval between heap reports.
+ * @param config_path RESTful path by which reporting frequency can be
+ * configured.
+ */
+HeapTelemetry::HeapTelemetry(uint report_interval_ms, String config_path)
+    : Sensor(config_path),
+      report_interval_ms_{report_interval_ms},
+      last_report_ms_{0} {
+  HEAP_COUNTER_NAME(heap_counter_, "HeapTelemetry");
+  loop_task_ = xTaskGetCurrentTaskHandle();
+  load_configuration();
+}  // end HeapTelemetry()
+
+/**
+ * @brief Starts periodic reports.
+ *
+ * The start() function is inherited from sensesp::Sensor, and is
+ * automatically called when the SensESP app starts.
+ */
+void HeapTelemetry::start() {
+  last_report_ms_ = millis();
+  scheduler_.Start(report_interval_ms_, [this]() { this->Update(); });
+}
+
+/**
+ * @brief Counts one heap allocation against the current scope.
+ *
+ * Called from the malloc() wrappers, so must not allocate, block, or log.
+ *
+ * @param size Number of bytes requested.
+ */
+void HeapTelemetry::RecordAllocation(size_t size) {
+  HeapCounter* counter;
+  if (xTaskGetCurrentTaskHandle() != loop_task_) {
+    counter = &other_tasks_;
+  } else if (HeapScope::current_ != NULL) {
+    counter = HeapScope::current_;
+  } else {
+    counter = &unattributed_;
+  }
+  counter->allocations_++;
+  counter->bytes_ += size;
+}  // end RecordAllocation()
+
+/**
+ * @brief Reports the heap state and the allocation rates since the
+ * previous report.
+ *
+ * All counters are snapshotted before anything is logged, so the
+ * logging itself isn't included in this report's rates.
+ */
+void HeapTelemetry::Update(void) {
+  HEAP_SCOPE(heap_counter_);
+  uint32_t now_ms = millis();
+  float seconds = (now_ms - last_report_ms_) / 1000.0;
+  last_report_ms_ = now_ms;
+  if (seconds <= 0.0) {
+    return;
+  }
+
+  HeapStats stats;
+  stats.allocations_per_s = 0.0;
+  stats.bytes_per_s = 0.0;
+  for (HeapCounter* c = HeapCounter::first_; c != NULL; c = c->next_) {
+    uint32_t allocations = c->allocations_;
+    uint32_t bytes = c->bytes_;
+    c->period_allocations_ = allocations - c->reported_allocations_;
+    c->period_bytes_ = bytes - c->reported_bytes_;
+    c->reported_allocations_ = allocations;
+    c->reported_bytes_ = bytes;
+    stats.allocations_per_s += c->period_allocations_;
+    stats.bytes_per_s += c->period_bytes_;
+  }
+  stats.allocations_per_s /= seconds;
+  stats.bytes_per_s /= seconds;
+  stats.free_bytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  stats.largest_free_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  stats.fragmentation =
+      (stats.free_bytes > 0)
+          ? 1.0 - (float)stats.largest_free_block / stats.free_bytes
+          : 0.0;
+
+#ifdef HEAP_TELEMETRY
+  for (HeapCounter* c = HeapCounter::first_; c != NULL; c = c->next_) {
+    if (c->period_allocations_ > 0) {
+      debugI("Heap: %s %.1f allocs/s %.0f bytes/s", c->name_,
+             c->period_allocations_ / seconds, c->period_bytes_ / seconds);
+    }
+  }
+#endif
+  debugI("Heap: free %u largest block %u fragmentation %.2f",
+         stats.free_bytes, stats.largest_free_block, stats.fragmentation);
+
+  output = stats;
+  notify();
+}  // end Update()
+
+/**
+ * @brief Define the format for the HeapTelemetry configuration.
+ */
+static const char SCHEMA_HEAP[] PROGMEM =
+    SCHEMA_OBJECT(SCHEMA_NUMBER(
+        CONFIG_KEY_REPORT_INTERVAL, "Report Interval",
+        "Milliseconds between heap reports"));
+
+/// Keys that a configuration of HeapTelemetry holds
+static const char* const kConfigKeysHeap[] = {CONFIG_KEY_REPORT_INTERVAL};
+
+/**
+ * @brief Get the current configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void HeapTelemetry::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_REPORT_INTERVAL] = report_interval_ms_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String HeapTelemetry::get_config_schema() { return FPSTR(SCHEMA_HEAP); }
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found.
+ */
+bool HeapTelemetry::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysHeap)) {
+    return false;
+  }
+  report_interval_ms_ = config[CONFIG_KEY_REPORT_INTERVAL];
+  scheduler_.SetInterval(report_interval_ms_);  // re-arms if running
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
+
+#ifdef HEAP_TELEMETRY
+/*
+ * With -Wl,--wrap=malloc etc., the linker resolves every call to
+ * malloc() to __wrap_malloc(), and __real_malloc() to the original.
+ */
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  sensesp::HeapTelemetry::RecordAllocation(size);
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  sensesp::HeapTelemetry::RecordAllocation(count * size);
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  if (size > 0) {
+    sensesp::HeapTelemetry::RecordAllocation(size);
+  }
+  return __real_realloc(ptr, size);
+}
+}  // extern "C"
+#endif
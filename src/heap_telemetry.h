@@ -0,0 +1,128 @@
+/** @file heap_telemetry.h
+ *  @brief Heap fragmentation and allocation-rate telemetry.
+ */
+
+#ifndef heap_telemetry_H_
+#define heap_telemetry_H_
+
+#include "report_scheduler.h"
+#include "sensesp/sensors/sensor.h"
+#include "signalk_orientation.h"
+
+namespace sensesp {
+
+/**
+ * @brief HeapCounter accumulates the heap allocations made while it is
+ * the current HeapScope.
+ *
+ * Counters link themselves into a list when constructed, without
+ * allocating, and unlink themselves when destroyed. Each producer or
+ * SKOutput normally has its own, declared with HEAP_COUNTER and named
+ * after its path, so e.g. every SKOutputFloat is reported separately.
+ * Static functions use a function-level static from HEAP_SCOPE_STATIC.
+ */
+class HeapCounter {
+ public:
+  static const size_t kNameSize = 40;  ///< longer names are truncated
+  explicit HeapCounter(const char* name = "");
+  ~HeapCounter();
+  HeapCounter(const HeapCounter&) = delete;  ///< the list links it
+  void set_name(const char* name);  ///< copies name, without allocating
+  char name_[kNameSize];  ///< name used when reporting
+  uint32_t allocations_;  ///< allocations since boot
+  uint32_t bytes_;        ///< bytes allocated since boot
+  uint32_t reported_allocations_;  ///< allocations_ at the previous report
+  uint32_t reported_bytes_;        ///< bytes_ at the previous report
+  uint32_t period_allocations_;    ///< allocations between last two reports
+  uint32_t period_bytes_;          ///< bytes between last two reports
+  HeapCounter* next_;     ///< next counter in the list, or NULL
+  static HeapCounter* first_;  ///< start of the list of all counters
+};
+
+/**
+ * @brief HeapScope attributes the allocations made during its lifetime,
+ * by the main loop task, to a HeapCounter.
+ *
+ * Scopes nest: allocations go to the innermost one, so e.g. an
+ * SKOutput's serialization is counted separately from the producer that
+ * triggered it.
+ */
+class HeapScope {
+ public:
+  explicit HeapScope(HeapCounter* counter) : previous_{current_} {
+    current_ = counter;
+  }
+  ~HeapScope() { current_ = previous_; }
+  static HeapCounter* current_;  ///< innermost scope, or NULL for none
+
+ private:
+  HeapCounter* previous_;  ///< scope to restore when this one ends
+};
+
+/**
+ * HEAP_COUNTER(counter) declares a HeapCounter member called counter,
+ * and HEAP_COUNTER_NAME(counter, name) names it. HEAP_SCOPE(counter)
+ * attributes the allocations made in the rest of the enclosing block to
+ * that member, and HEAP_SCOPE_STATIC(name) to a counter shared by all
+ * calls, for static functions. All compile to nothing unless
+ * HEAP_TELEMETRY is defined, so HEAP_COUNTER takes no semicolon.
+ */
+#ifdef HEAP_TELEMETRY
+#define HEAP_COUNTER(counter) sensesp::HeapCounter counter;
+#define HEAP_COUNTER_NAME(counter, name) (counter).set_name(name)
+#define HEAP_SCOPE(counter) sensesp::HeapScope heap_scope_(&(counter))
+#define HEAP_SCOPE_STATIC(name)                          \
+  static sensesp::HeapCounter heap_counter_static_(name); \
+  sensesp::HeapScope heap_scope_(&heap_counter_static_)
+#else
+#define HEAP_COUNTER(counter)
+#define HEAP_COUNTER_NAME(counter, name)
+#define HEAP_SCOPE(counter)
+#define HEAP_SCOPE_STATIC(name)
+#endif
+
+/**
+ * @brief HeapTelemetry periodically reports the free heap, the largest
+ * free block and the resulting fragmentation ratio, along with the rate
+ * of heap allocations.
+ *
+ * Counting allocations requires building with
+ *   -D HEAP_TELEMETRY -Wl,--wrap=malloc -Wl,--wrap=calloc
+ *   -Wl,--wrap=realloc
+ * (see platformio.ini), so that every malloc() passes through
+ * RecordAllocation(). Each report then also logs the allocations per
+ * second and bytes per second for every HeapCounter, i.e. for each
+ * SKOutput and producer marked with HEAP_SCOPE, plus allocations by the
+ * loop task outside any scope and those by other tasks (WiFi, TCP/IP).
+ * tools/heap_soak.cpp replays a day of the serializers' allocations on
+ * a desktop machine. Counts from other tasks are approximate since they are not
+ * updated atomically.
+ *
+ * A steady fragmentation ratio climbing towards 1 while free heap stays
+ * roughly constant indicates the fragmentation that eventually prevents
+ * large allocations such as JSON documents.
+ */
+class HeapTelemetry : public HeapStatsProducer, public Sensor {
+ public:
+  HeapTelemetry(uint report_interval_ms = 10000, String config_path = "");
+  void start() override final;  ///< starts periodic reports
+  static void RecordAllocation(size_t size);  ///< called for each malloc()
+
+ private:
+  void Update(void);  ///< reports heap state and allocation rates
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  uint report_interval_ms_;  ///< interval between reports
+  ReportScheduler scheduler_;  ///< runs Update() every report_interval_ms_
+  uint32_t last_report_ms_;  ///< millis() at the previous report
+  HEAP_COUNTER(heap_counter_)  ///< allocations made by reporting
+  static void* loop_task_;   ///< task whose allocations are attributed
+  static HeapCounter unattributed_;  ///< loop task, outside any HeapScope
+  static HeapCounter other_tasks_;   ///< allocations by other tasks
+
+};  // end class HeapTelemetry
+
+}  // namespace sensesp
+
+#endif  // heap_telemetry_H_
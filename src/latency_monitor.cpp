@@ -0,0 +1,208 @@
+/** @file latency_monitor.cpp
+ *  @brief Measures how old orientation data are when they leave the device.
+ */
+
+#include "latency_monitor.h"
+
+#include "config_schema.h"
+#include "sensesp_app.h"
+
+namespace sensesp {
+
+/**
+ * @brief Adds one latency sample to the histogram.
+ *
+ * @param latency_us Latency in microseconds.
+ */
+void LatencyHistogram::Record(uint32_t latency_us) {
+  int bucket = 0;
+  while ((bucket < kNumBuckets - 1) && (latency_us >> (bucket + 1))) {
+    bucket++;
+  }
+  if (UINT16_MAX == counts_[bucket]) {
+    // halve everything rather than lose the shape of the distribution
+    total_ = 0;
+    for (int i = 0; i < kNumBuckets; i++) {
+      counts_[i] /= 2;
+      total_ += counts_[i];
+    }
+  }
+  counts_[bucket]++;
+  total_++;
+  if (latency_us > max_us_) {
+    max_us_ = latency_us;
+  }
+}  // end Record()
+
+/**
+ * @brief Discards all samples.
+ */
+void LatencyHistogram::Reset(void) {
+  memset(counts_, 0, sizeof(counts_));
+  total_ = 0;
+  max_us_ = 0;
+}  // end Reset()
+
+/**
+ * @brief Estimates a percentile of the recorded latencies.
+ *
+ * The result is interpolated linearly within the bucket holding the
+ * requested percentile, and never exceeds the recorded maximum.
+ *
+ * @param fraction Percentile as a fraction, e.g. 0.99 for p99.
+ * @return Latency in seconds, or 0 if there are no samples.
+ */
+float LatencyHistogram::Percentile(float fraction) const {
+  if (0 == total_) {
+    return 0.0;
+  }
+  float rank = fraction * total_;
+  uint32_t cumulative = 0;
+  for (int i = 0; i < kNumBuckets; i++) {
+    if (cumulative + counts_[i] >= rank && counts_[i] > 0) {
+      float lower_us = (0 == i) ? 0.0 : (float)(1UL << i);
+      float upper_us = (float)(1UL << (i + 1));
+      float within = (rank - cumulative) / counts_[i];
+      float latency_us = lower_us + within * (upper_us - lower_us);
+      if (latency_us > max_us_) {
+        latency_us = max_us_;
+      }
+      return latency_us / 1e6;
+    }
+    cumulative += counts_[i];
+  }
+  return Max();
+}  // end Percentile()
+
+/**
+ * @brief Constructor sets up the frequency of reports.
+ *
+ * @param report_interval_ms Interval between latency reports.
+ * @param config_path RESTful path by which reporting frequency can be
+ * configured.
+ */
+LatencyMonitor::LatencyMonitor(uint report_interval_ms, String config_path)
+    : Sensor(config_path),
+      pending_since_us_{0},
+      is_send_pending_{false},
+      stats_{},
+      report_interval_ms_{report_interval_ms} {
+  HEAP_COUNTER_NAME(heap_counter_, "LatencyMonitor");
+  load_configuration();
+}  // end LatencyMonitor()
+
+/**
+ * @brief Starts periodic reports, and watching of the delta queue.
+ *
+ * The start() function is inherited from sensesp::Sensor, and is
+ * automatically called when the SensESP app starts.
+ */
+void LatencyMonitor::start() {
+  scheduler_.Start(report_interval_ms_, [this]() { this->Update(); });
+  ReactESP::app->onTick([this]() { this->CheckSent(); });
+}
+
+/**
+ * @brief Records that a value from the given fusion run has been serialized.
+ *
+ * @param epoch Fusion epoch of the sensor reading the value came from.
+ */
+void LatencyMonitor::RecordSerialized(const FusionEpoch& epoch) {
+  serialize_histogram_.Record(micros() - epoch.monotonic_us);
+  if (!is_send_pending_) {
+    pending_since_us_ = epoch.monotonic_us;
+    is_send_pending_ = true;
+  }
+}  // end RecordSerialized()
+
+/**
+ * @brief Records that a value from the given fusion run has been
+ * serialized and sent to the websocket directly, not via the delta queue.
+ *
+ * @param epoch Fusion epoch of the sensor reading the value came from.
+ */
+void LatencyMonitor::RecordSent(const FusionEpoch& epoch) {
+  uint32_t latency_us = micros() - epoch.monotonic_us;
+  serialize_histogram_.Record(latency_us);
+  send_histogram_.Record(latency_us);
+}  // end RecordSent()
+
+/**
+ * @brief Records the send latency once the delta queue has been drained.
+ *
+ * Only the oldest unsent value is timed, as it is the one that has
+ * waited the longest. This keeps the monitor constant-size regardless
+ * of how many values are queued.
+ */
+void LatencyMonitor::CheckSent(void) {
+  if (is_send_pending_ && !sensesp_app->get_sk_delta()->data_available()) {
+    send_histogram_.Record(micros() - pending_since_us_);
+    is_send_pending_ = false;
+  }
+}  // end CheckSent()
+
+/**
+ * @brief Publishes the latency statistics gathered since the last report.
+ */
+void LatencyMonitor::Update(void) {
+  HEAP_SCOPE(heap_counter_);
+  stats_.sample_count = serialize_histogram_.Count();
+  stats_.is_data_valid = (stats_.sample_count > 0);
+  stats_.serialize_p50 = serialize_histogram_.Percentile(0.50);
+  stats_.serialize_p99 = serialize_histogram_.Percentile(0.99);
+  stats_.serialize_max = serialize_histogram_.Max();
+  stats_.send_p50 = send_histogram_.Percentile(0.50);
+  stats_.send_p99 = send_histogram_.Percentile(0.99);
+  stats_.send_max = send_histogram_.Max();
+  serialize_histogram_.Reset();
+  send_histogram_.Reset();
+
+  output = stats_;
+  notify();
+}  // end Update()
+
+/**
+ * @brief Define the format for the LatencyMonitor configuration.
+ */
+static const char SCHEMA_LATENCY[] PROGMEM =
+    SCHEMA_OBJECT(SCHEMA_NUMBER(
+        CONFIG_KEY_REPORT_INTERVAL, "Report Interval",
+        "Milliseconds between latency reports"));
+
+/// Keys that a configuration of LatencyMonitor holds
+static const char* const kConfigKeysLatency[] = {CONFIG_KEY_REPORT_INTERVAL};
+
+/**
+ * @brief Get the current configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void LatencyMonitor::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_REPORT_INTERVAL] = report_interval_ms_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String LatencyMonitor::get_config_schema() { return FPSTR(SCHEMA_LATENCY); }
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found.
+ */
+bool LatencyMonitor::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysLatency)) {
+    return false;
+  }
+  report_interval_ms_ = config[CONFIG_KEY_REPORT_INTERVAL];
+  scheduler_.SetInterval(report_interval_ms_);  // re-arms if running
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
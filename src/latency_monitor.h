@@ -0,0 +1,81 @@
+/** @file latency_monitor.h
+ *  @brief Measures how old orientation data are when they leave the device.
+ */
+
+#ifndef latency_monitor_H_
+#define latency_monitor_H_
+
+#include "heap_telemetry.h"
+#include "report_scheduler.h"
+#include "sensesp/sensors/sensor.h"
+#include "signalk_orientation.h"
+
+namespace sensesp {
+
+/**
+ * @brief LatencyHistogram is a compact histogram of latencies with
+ * logarithmically-spaced buckets.
+ *
+ * Bucket i counts latencies in [2^i, 2^(i+1)) microseconds, so the
+ * relative resolution is the same from microseconds up to the 16 s
+ * held in the top bucket. Counts are 16 bits; if one saturates, all
+ * counts are halved so percentiles remain meaningful.
+ */
+class LatencyHistogram {
+ public:
+  LatencyHistogram() { Reset(); }
+  void Record(uint32_t latency_us);  ///< adds one latency sample
+  void Reset(void);                  ///< discards all samples
+  float Percentile(float fraction) const;  ///< returns latency in seconds
+  float Max(void) const { return max_us_ / 1e6; }  ///< returns max, in s
+  uint32_t Count(void) const { return total_; }  ///< returns number of samples
+
+ private:
+  static const int kNumBuckets = 24;
+  uint16_t counts_[kNumBuckets];  ///< sample counts per bucket
+  uint32_t total_;                ///< total of all counts_
+  uint32_t max_us_;               ///< largest latency recorded
+};
+
+/**
+ * @brief LatencyMonitor tracks the latency of one output path and
+ * periodically reports its p50, p99, and max values.
+ *
+ * An SKOutput that has been given a monitor with set_latency_monitor()
+ * calls RecordSerialized() from as_signalk(), once the value exists as
+ * Signal K JSON in the delta queue. This measures the time from when the
+ * sensors were read until the output that sends the value serialized it,
+ * so any buffering between the sensor and the output is included. The
+ * monitor then watches the delta queue, and when it has been drained by
+ * the websocket client the time-to-send is recorded as well. An output
+ * that sends its own delta to the websocket calls RecordSent() instead.
+ */
+class LatencyMonitor : public LatencyStatsProducer, public sensesp::Sensor {
+ public:
+  LatencyMonitor(uint report_interval_ms = 10000, String config_path = "");
+  void start() override final;  ///< starts periodic outputs of LatencyStats
+  void RecordSerialized(const FusionEpoch& epoch);
+  void RecordSent(const FusionEpoch& epoch);
+  /// Returns the statistics published in the most recent report
+  const LatencyStats& GetStats(void) const { return stats_; }
+
+ private:
+  void CheckSent(void);  ///< records send latency once queue is drained
+  void Update(void);     ///< publishes stats and starts a new period
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  LatencyHistogram serialize_histogram_;  ///< sensor-to-serialize latencies
+  LatencyHistogram send_histogram_;       ///< sensor-to-send latencies
+  uint32_t pending_since_us_;  ///< sensor time of oldest value not yet sent
+  bool is_send_pending_;       ///< true if a serialized value awaits sending
+  LatencyStats stats_;         ///< most recently reported statistics
+  uint report_interval_ms_;    ///< interval between reports to Signal K
+  ReportScheduler scheduler_;  ///< runs Update() every report_interval_ms_
+  HEAP_COUNTER(heap_counter_)  ///< allocations made by Update()
+
+};  // end class LatencyMonitor
+
+}  // namespace sensesp
+
+#endif  // latency_monitor_H_
@@ -0,0 +1,245 @@
+/** @file magnetic_disturbance_detector.cpp
+ *  @brief Detects magnetic interference, and carries heading through it
+ *  on the gyro alone.
+ */
+
+#include "magnetic_disturbance_detector.h"
+
+#include "config_schema.h"
+#include "orientation_sensor.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+#define CONFIG_KEY_MAGNITUDE_TOLERANCE "magnitude_tolerance"
+#define CONFIG_KEY_INCLINATION_TOLERANCE "inclination_tolerance"
+#define CONFIG_KEY_HOLD "hold"
+#define CONFIG_KEY_MAX_DURATION "max_duration"
+
+/// Time constant of the reference inclination's average, in seconds
+static const float kReferenceTimeConstantS = 60.0;
+
+/**
+ * @brief Constructor sets the thresholds, and has the sensor call
+ * Update() after every fusion run.
+ *
+ * @param orientation_sensor Pointer to the physical sensor's interface.
+ * @param magnitude_tolerance Largest departure of field magnitude from
+ * the calibrated magnitude, as a fraction of it, before the field is
+ * taken as disturbed.
+ * @param inclination_tolerance_deg Largest departure of inclination from
+ * the reference, in degrees.
+ * @param hold_ms How long both checks must pass to end a disturbance.
+ * @param max_duration_s Longest time heading is propagated on the gyro.
+ * @param report_interval_ms Interval between repeated reports of the flag.
+ * @param config_path RESTful path by which the thresholds can be
+ * configured.
+ */
+MagneticDisturbanceDetector::MagneticDisturbanceDetector(
+    OrientationSensor* orientation_sensor, float magnitude_tolerance,
+    float inclination_tolerance_deg, uint hold_ms, uint max_duration_s,
+    uint report_interval_ms, String config_path)
+    : BoolSensor(config_path),
+      orientation_sensor_{orientation_sensor},
+      magnitude_tolerance_{magnitude_tolerance},
+      inclination_tolerance_{inclination_tolerance_deg * DEG_TO_RAD},
+      hold_ms_{hold_ms},
+      max_duration_s_{max_duration_s},
+      report_interval_ms_{report_interval_ms},
+      scheduler_{orientation_sensor} {
+  load_configuration();
+  Reset();
+  orientation_sensor_->set_disturbance_detector(this);
+}  // end MagneticDisturbanceDetector()
+
+/**
+ * @brief Starts periodic output of the quality flag.
+ *
+ * The start() function is inherited from sensesp::Sensor, and is
+ * automatically called when the SensESP app starts.
+ */
+void MagneticDisturbanceDetector::start() {
+  scheduler_.Start(report_interval_ms_, [this]() { this->Report(); });
+}
+
+/**
+ * @brief Forgets the reference inclination and ends any disturbance.
+ */
+void MagneticDisturbanceDetector::Reset(void) {
+  is_disturbed_ = false;
+  is_locked_out_ = false;
+  has_reference_ = false;
+  reference_inclination_ = 0.0;
+  last_heading_ = 0.0;
+  heading_ = 0.0;
+  last_us_ = 0;
+  disturbed_since_us_ = 0;
+  last_anomaly_us_ = 0;
+}  // end Reset()
+
+/**
+ * @brief Checks the latest fusion result for a disturbance, and
+ * propagates heading on the gyro while there is one.
+ *
+ * Called by the OrientationSensor after every fusion run, before its
+ * observers are notified.
+ *
+ * @param epoch Epoch of the fusion run.
+ */
+void MagneticDisturbanceDetector::Update(const FusionEpoch& epoch) {
+  SensorFusion* fusion = orientation_sensor_->sensor_interface_;
+  if (!fusion->IsDataValid()) {
+    if (is_disturbed_ || has_reference_) {
+      Reset();
+      Report();
+    }
+    return;
+  }
+  float fusion_heading = fusion->GetHeadingRadians();
+  float dt = (epoch.monotonic_us - last_us_) * 1e-6;
+  bool is_first_run = (0 == last_us_);
+  last_us_ = epoch.monotonic_us;
+
+  float magnitude = fusion->GetMagneticBMag();
+  float covariance = fusion->GetMagneticNoiseCovariance();
+  float departure = sqrtf(covariance > 0.0 ? covariance : 0.0);
+  float inclination = fusion->GetMagneticInclinationRad();
+  bool is_anomalous =
+      (magnitude > 0.0 && departure > magnitude_tolerance_ * magnitude) ||
+      (has_reference_ &&
+       fabsf(inclination - reference_inclination_) > inclination_tolerance_);
+
+  if (is_anomalous) {
+    last_anomaly_us_ = epoch.monotonic_us;
+    if (!is_disturbed_ && !is_first_run && !is_locked_out_) {
+      // the fusion heading may already be pulled off; start from the
+      // previous run's
+      is_disturbed_ = true;
+      disturbed_since_us_ = epoch.monotonic_us;
+      heading_ = last_heading_;
+      debugI("Disturbance: magnetic field disturbed, using gyro heading");
+      Report();
+    }
+  }
+
+  if (is_disturbed_) {
+    heading_ += fusion->GetTurnRateRadPerS() * dt;
+    if (heading_ < 0.0) {
+      heading_ += 2.0 * PI;
+    } else if (heading_ >= 2.0 * PI) {
+      heading_ -= 2.0 * PI;
+    }
+    bool is_quiet =
+        epoch.monotonic_us - last_anomaly_us_ >= hold_ms_ * 1000;
+    bool is_too_long = epoch.monotonic_us - disturbed_since_us_ >=
+                       (uint64_t)max_duration_s_ * 1000000;
+    if (is_quiet || is_too_long) {
+      is_disturbed_ = false;
+      if (is_too_long) {
+        reference_inclination_ = inclination;  // take field as the new normal
+        is_locked_out_ = !is_quiet;
+        debugI("Disturbance: lasted %us, accepting field as changed",
+               max_duration_s_);
+      } else {
+        debugI("Disturbance: magnetic field steady, using fusion heading");
+      }
+      Report();
+    }
+  } else {
+    if (is_locked_out_ &&
+        epoch.monotonic_us - last_anomaly_us_ >= hold_ms_ * 1000) {
+      is_locked_out_ = false;
+      debugI("Disturbance: magnetic field steady, detection resumed");
+    }
+    if (!is_anomalous) {
+      // follow slow changes in inclination, e.g. with latitude
+      if (!has_reference_) {
+        reference_inclination_ = inclination;
+        has_reference_ = true;
+      } else {
+        reference_inclination_ += (inclination - reference_inclination_) *
+                                  dt / kReferenceTimeConstantS;
+      }
+    }
+  }
+  last_heading_ = is_disturbed_ ? heading_ : fusion_heading;
+}  // end Update()
+
+/**
+ * @brief Passes on whether the field is currently disturbed.
+ */
+void MagneticDisturbanceDetector::Report(void) { emit(is_disturbed_); }
+
+/**
+ * @brief Define the format for the MagneticDisturbanceDetector
+ * configuration.
+ */
+static const char SCHEMA_DISTURBANCE[] PROGMEM = SCHEMA_OBJECT(
+    SCHEMA_REPORT_INTERVAL
+    ", " SCHEMA_NUMBER(CONFIG_KEY_MAGNITUDE_TOLERANCE, "Magnitude Tolerance",
+                       "Largest departure from calibrated field magnitude, "
+                       "as a fraction of it")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_INCLINATION_TOLERANCE,
+                       "Inclination Tolerance",
+                       "Largest departure from usual inclination, degrees")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_HOLD, "Hold Time",
+                       "Time field must be steady to end a disturbance, ms")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_MAX_DURATION, "Maximum Duration",
+                       "Longest use of gyro-only heading, seconds"));
+
+/// Keys that a configuration of MagneticDisturbanceDetector holds
+static const char* const kConfigKeysDisturbance[] = {
+    CONFIG_KEY_REPORT_INTERVAL, CONFIG_KEY_MAGNITUDE_TOLERANCE,
+    CONFIG_KEY_INCLINATION_TOLERANCE, CONFIG_KEY_HOLD,
+    CONFIG_KEY_MAX_DURATION};
+
+/**
+ * @brief Get the current configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void MagneticDisturbanceDetector::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_REPORT_INTERVAL] = report_interval_ms_;
+  doc[CONFIG_KEY_MAGNITUDE_TOLERANCE] = magnitude_tolerance_;
+  doc[CONFIG_KEY_INCLINATION_TOLERANCE] = inclination_tolerance_ * RAD_TO_DEG;
+  doc[CONFIG_KEY_HOLD] = hold_ms_;
+  doc[CONFIG_KEY_MAX_DURATION] = max_duration_s_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String MagneticDisturbanceDetector::get_config_schema() {
+  return FPSTR(SCHEMA_DISTURBANCE);
+}
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found
+ * or a tolerance isn't positive.
+ */
+bool MagneticDisturbanceDetector::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysDisturbance)) {
+    return false;
+  }
+  float magnitude_tolerance = config[CONFIG_KEY_MAGNITUDE_TOLERANCE];
+  float inclination_tolerance = config[CONFIG_KEY_INCLINATION_TOLERANCE];
+  if (magnitude_tolerance <= 0.0 || inclination_tolerance <= 0.0) {
+    return false;
+  }
+  magnitude_tolerance_ = magnitude_tolerance;
+  inclination_tolerance_ = inclination_tolerance * DEG_TO_RAD;
+  hold_ms_ = config[CONFIG_KEY_HOLD];
+  max_duration_s_ = config[CONFIG_KEY_MAX_DURATION];
+  report_interval_ms_ = config[CONFIG_KEY_REPORT_INTERVAL];
+  scheduler_.SetInterval(report_interval_ms_);  // re-arms if running
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
@@ -0,0 +1,100 @@
+/** @file magnetic_disturbance_detector.h
+ *  @brief Detects magnetic interference, and carries heading through it
+ *  on the gyro alone.
+ */
+
+#ifndef magnetic_disturbance_detector_H_
+#define magnetic_disturbance_detector_H_
+
+#include "report_scheduler.h"
+#include "sensesp/sensors/sensor.h"
+#include "signalk_orientation.h"
+
+namespace sensesp {
+
+class OrientationSensor;
+
+/**
+ * @brief MagneticDisturbanceDetector checks every fusion result for
+ * magnetic interference, such as from an engine starting or a windlass
+ * running, and while it lasts replaces the fusion heading with one
+ * propagated from the gyro.
+ *
+ * The field is taken to be disturbed when either
+ * - its magnitude departs from the calibrated magnitude by more than the
+ *   magnitude tolerance (a fraction of the calibrated magnitude). The
+ *   departure is the square root of the fusion library's magnetic noise
+ *   covariance, which tracks how far readings lie off the calibrated
+ *   sphere; or
+ * - its inclination departs by more than the inclination tolerance from
+ *   the reference inclination. The fusion library doesn't keep a
+ *   calibrated inclination, so the reference is a slow average of the
+ *   inclination while undisturbed.
+ *
+ * When a disturbance starts, the heading from the previous fusion run is
+ * held, and advanced by the rate of turn times the fusion period at each
+ * run. It ends once neither check has failed for the hold time. The gyro
+ * heading drifts, so if the disturbance lasts longer than the maximum
+ * duration, the field is taken to have changed for good (e.g. new gear
+ * stowed near the sensor): the reference inclination is reset and the
+ * fusion heading is used again. The magnitude check compares against the
+ * fusion library's calibration, which can't be reset here, so no new
+ * disturbance is started until the field has been steady for the hold
+ * time. Otherwise a lasting change would start a new disturbance at the
+ * next run, and heading would stay on the gyro indefinitely.
+ *
+ * The check runs within the fusion tick, called by the OrientationSensor
+ * before its observers are notified, so everything reading heading after
+ * a fusion run sees the same value. OrientationSensor::GetHeadingRadians()
+ * gives that heading.
+ *
+ * The output is the quality flag, true while disturbed. It is passed on
+ * as soon as it changes, and repeated every report interval.
+ */
+class MagneticDisturbanceDetector : public BoolSensor {
+ public:
+  MagneticDisturbanceDetector(OrientationSensor* orientation_sensor,
+                              float magnitude_tolerance = 0.1,
+                              float inclination_tolerance_deg = 5.0,
+                              uint hold_ms = 2000,
+                              uint max_duration_s = 300,
+                              uint report_interval_ms = 1000,
+                              String config_path = "");
+  void start() override final;  ///< starts periodic outputs of the flag
+  void Update(const FusionEpoch& epoch);
+  /// Returns true while the field is disturbed
+  bool is_disturbed(void) const { return is_disturbed_; }
+  /// Returns the gyro-propagated heading, valid while disturbed
+  float get_heading(void) const { return heading_; }
+  /// Returns monotonic_us when the disturbance began, valid while disturbed
+  uint32_t get_disturbed_since_us(void) const { return disturbed_since_us_; }
+
+ private:
+  void Report(void);  ///< passes on the current flag
+  void Reset(void);   ///< forgets the reference and any disturbance
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  OrientationSensor* orientation_sensor_;  ///< source of fusion results
+  float magnitude_tolerance_;      ///< fraction of calibrated magnitude
+  float inclination_tolerance_;    ///< radians
+  uint hold_ms_;                   ///< quiet time needed to end disturbance
+  uint max_duration_s_;            ///< longest gyro-only propagation
+  uint report_interval_ms_;        ///< interval between repeated reports
+  ReportScheduler scheduler_;      ///< runs Report() every report_interval_ms_
+  bool is_disturbed_;              ///< true while disturbed
+  bool is_locked_out_;             ///< true after a too-long disturbance,
+                                   ///< until the field is steady again
+  bool has_reference_;             ///< true once reference_inclination_ set
+  float reference_inclination_;    ///< undisturbed inclination, radians
+  float last_heading_;             ///< fusion heading at the previous run
+  float heading_;                  ///< gyro-propagated heading, radians
+  uint32_t last_us_;               ///< monotonic_us of the previous run
+  uint32_t disturbed_since_us_;    ///< monotonic_us when disturbance began
+  uint32_t last_anomaly_us_;       ///< monotonic_us when a check last failed
+
+};  // end class MagneticDisturbanceDetector
+
+}  // namespace sensesp
+
+#endif  // magnetic_disturbance_detector_H_
@@ -0,0 +1,400 @@
+/** @file motion_log_codec.cpp
+ *  @brief Block-based compression of orientation sample streams.
+ *
+ * The multi-byte header fields and the first sample are copied as-is,
+ * which relies on both the ESP32 and the host being little-endian.
+ */
+
+#include "motion_log_codec.h"
+
+#include <string.h>
+
+namespace sensesp {
+
+namespace {
+
+const uint8_t kSyncMarker[4] = {'M', 'L', 'B', '1'};
+const uint8_t kFormatVersion = 2;
+const uint8_t kMaxFieldWidth = 17;  // zig-zag of an int16 difference
+const int32_t kYawModulus = 36000;  // heading wraps at 360.00 degrees
+
+/// Copies the fields of a sample into an array, in coding order
+inline void ToFields(const PackedOrientationSample& s, int32_t* f) {
+  f[0] = s.yaw_cdeg;
+  f[1] = s.pitch_cdeg;
+  f[2] = s.roll_cdeg;
+  f[3] = s.rate_of_turn_cdeg_s;
+  f[4] = s.rate_of_pitch_cdeg_s;
+  f[5] = s.rate_of_roll_cdeg_s;
+  f[6] = s.accel_x_mg;
+  f[7] = s.accel_y_mg;
+  f[8] = s.accel_z_mg;
+  f[9] = s.dt_ms;
+  f[10] = s.flags;
+}
+
+/// Copies an array of fields, in coding order, into a sample
+inline void FromFields(const int32_t* f, PackedOrientationSample* s) {
+  s->yaw_cdeg = (uint16_t)f[0];
+  s->pitch_cdeg = (int16_t)f[1];
+  s->roll_cdeg = (int16_t)f[2];
+  s->rate_of_turn_cdeg_s = (int16_t)f[3];
+  s->rate_of_pitch_cdeg_s = (int16_t)f[4];
+  s->rate_of_roll_cdeg_s = (int16_t)f[5];
+  s->accel_x_mg = (int16_t)f[6];
+  s->accel_y_mg = (int16_t)f[7];
+  s->accel_z_mg = (int16_t)f[8];
+  s->dt_ms = (uint8_t)f[9];
+  s->flags = (uint8_t)f[10];
+}
+
+/// Difference of field 0 (heading) taking the shorter way around the circle
+inline int32_t YawDelta(int32_t current, int32_t previous) {
+  int32_t delta = current - previous;
+  if (delta >= kYawModulus / 2) {
+    delta -= kYawModulus;
+  } else if (delta < -kYawModulus / 2) {
+    delta += kYawModulus;
+  }
+  return delta;
+}
+
+/// Maps signed to unsigned so that small magnitudes give small numbers
+inline uint32_t ZigZag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t UnZigZag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/// Number of bits needed to hold value
+inline uint8_t BitWidth(uint32_t value) {
+  return (0 == value) ? 0 : 32 - __builtin_clz(value);
+}
+
+/// Updates a CRC-16/CCITT (polynomial 0x1021) a byte at a time
+uint16_t Crc16(uint16_t crc, const uint8_t* data, size_t length) {
+  static uint16_t table[256];
+  static bool is_table_built = false;
+  if (!is_table_built) {
+    for (int i = 0; i < 256; i++) {
+      uint16_t entry = i << 8;
+      for (int bit = 0; bit < 8; bit++) {
+        entry = (entry & 0x8000) ? (entry << 1) ^ 0x1021 : entry << 1;
+      }
+      table[i] = entry;
+    }
+    is_table_built = true;
+  }
+  for (size_t i = 0; i < length; i++) {
+    crc = (crc << 8) ^ table[(crc >> 8) ^ data[i]];
+  }
+  return crc;
+}
+
+uint16_t BlockCrc(const uint8_t* block, size_t payload_size) {
+  uint16_t crc = Crc16(0xFFFF, block, kMotionLogHeaderSize - 2);
+  return Crc16(crc, block + kMotionLogHeaderSize, payload_size);
+}
+
+/// Writes values of arbitrary bit width, least significant bit first
+class BitWriter {
+ public:
+  explicit BitWriter(uint8_t* out) : out_{out}, start_{out}, acc_{0}, bits_{0} {}
+  inline void Write(uint32_t value, uint8_t width) {
+    acc_ |= (uint64_t)value << bits_;
+    bits_ += width;
+    while (bits_ >= 8) {
+      *out_++ = (uint8_t)acc_;
+      acc_ >>= 8;
+      bits_ -= 8;
+    }
+  }
+  size_t Flush(void) {
+    if (bits_ > 0) {
+      *out_++ = (uint8_t)acc_;
+      acc_ = 0;
+      bits_ = 0;
+    }
+    return out_ - start_;
+  }
+
+ private:
+  uint8_t* out_;
+  uint8_t* start_;
+  uint64_t acc_;
+  int bits_;
+};
+
+/// Reads values written by BitWriter
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, size_t length)
+      : data_{data}, end_{data + length}, acc_{0}, bits_{0} {}
+  inline uint32_t Read(uint8_t width) {
+    if (bits_ < width) {
+      while ((bits_ <= 56) && (data_ < end_)) {
+        acc_ |= (uint64_t)(*data_++) << bits_;
+        bits_ += 8;
+      }
+    }
+    uint32_t value = (uint32_t)acc_ & ((1UL << width) - 1);
+    acc_ >>= width;
+    bits_ -= width;
+    return value;
+  }
+
+ private:
+  const uint8_t* data_;
+  const uint8_t* end_;
+  uint64_t acc_;
+  int bits_;
+};
+
+}  // namespace
+
+/**
+ * @brief Adds a sample to the block under construction.
+ *
+ * @param sample The sample to be added.
+ * @param sequence Fusion sequence number of the sample. Only those of the
+ * first and last samples of each block are stored.
+ * @param sk_time_ms Wall-clock time of the sample, or 0 if unknown. Only
+ * those of the first and last samples of each block are stored.
+ */
+void MotionLogEncoder::Add(const PackedOrientationSample& sample,
+                           uint32_t sequence, uint64_t sk_time_ms) {
+  if (IsFull()) {
+    return;
+  }
+  if (0 == count_) {
+    first_sequence_ = sequence;
+    first_sk_time_ms_ = sk_time_ms;
+  }
+  last_sequence_ = sequence;
+  last_sk_time_ms_ = sk_time_ms;
+  samples_[count_++] = sample;
+}  // end Add()
+
+/**
+ * @brief Compresses the samples added so far into a block, and empties
+ * the encoder for the next block.
+ *
+ * @param block Destination for the block.
+ * @param block_size Size of block; must be at least kMotionLogMaxBlockSize.
+ * @return Number of bytes in the block, or 0 if there were no samples or
+ * the destination was too small.
+ */
+size_t MotionLogEncoder::Finish(uint8_t* block, size_t block_size) {
+  if ((0 == count_) || (block_size < kMotionLogMaxBlockSize)) {
+    return 0;
+  }
+  int32_t previous[kMotionLogFields];
+  int32_t current[kMotionLogFields];
+  uint8_t widths[kMotionLogFields] = {0};
+
+  // First pass finds the number of bits needed for each field
+  ToFields(samples_[0], previous);
+  for (size_t i = 1; i < count_; i++) {
+    ToFields(samples_[i], current);
+    uint8_t width = BitWidth(ZigZag(YawDelta(current[0], previous[0])));
+    if (width > widths[0]) {
+      widths[0] = width;
+    }
+    for (size_t f = 1; f < kMotionLogFields; f++) {
+      width = BitWidth(ZigZag(current[f] - previous[f]));
+      if (width > widths[f]) {
+        widths[f] = width;
+      }
+    }
+    memcpy(previous, current, sizeof(previous));
+  }
+
+  // Second pass packs the differences
+  BitWriter writer(block + kMotionLogHeaderSize);
+  ToFields(samples_[0], previous);
+  for (size_t i = 1; i < count_; i++) {
+    ToFields(samples_[i], current);
+    writer.Write(ZigZag(YawDelta(current[0], previous[0])), widths[0]);
+    for (size_t f = 1; f < kMotionLogFields; f++) {
+      writer.Write(ZigZag(current[f] - previous[f]), widths[f]);
+    }
+    memcpy(previous, current, sizeof(previous));
+  }
+  uint16_t payload_size = (uint16_t)writer.Flush();
+
+  uint16_t sample_count = (uint16_t)count_;
+  memcpy(block, kSyncMarker, 4);
+  memcpy(block + 4, &sample_count, 2);
+  memcpy(block + 6, &payload_size, 2);
+  memcpy(block + 8, widths, kMotionLogFields);
+  block[19] = kFormatVersion;
+  memcpy(block + 20, &first_sequence_, 4);
+  memcpy(block + 24, &first_sk_time_ms_, 8);
+  memcpy(block + 32, &samples_[0], sizeof(PackedOrientationSample));
+  memcpy(block + 52, &last_sequence_, 4);
+  memcpy(block + 56, &last_sk_time_ms_, 8);
+  uint16_t crc = BlockCrc(block, payload_size);
+  memcpy(block + 64, &crc, 2);
+
+  count_ = 0;
+  return kMotionLogHeaderSize + payload_size;
+}  // end Finish()
+
+/**
+ * @brief Checks that a valid block starts at data, and reads its header.
+ *
+ * @param data Start of the block.
+ * @param length Bytes available at data.
+ * @param info Receives the header information. May be NULL.
+ * @return True if the sync marker, header fields and CRC are all valid.
+ */
+bool ReadMotionLogBlockInfo(const uint8_t* data, size_t length,
+                            MotionLogBlockInfo* info) {
+  if ((length < kMotionLogHeaderSize) || (0 != memcmp(data, kSyncMarker, 4)) ||
+      (kFormatVersion != data[19])) {
+    return false;
+  }
+  MotionLogBlockInfo header;
+  memcpy(&header.sample_count, data + 4, 2);
+  memcpy(&header.payload_size, data + 6, 2);
+  memcpy(&header.first_sequence, data + 20, 4);
+  memcpy(&header.first_sk_time_ms, data + 24, 8);
+  memcpy(&header.last_sequence, data + 52, 4);
+  memcpy(&header.last_sk_time_ms, data + 56, 8);
+  header.block_size = kMotionLogHeaderSize + header.payload_size;
+  if ((0 == header.sample_count) ||
+      (header.sample_count > kMotionLogBlockSamples) ||
+      (header.block_size > length)) {
+    return false;
+  }
+  for (size_t f = 0; f < kMotionLogFields; f++) {
+    if (data[8 + f] > kMaxFieldWidth) {
+      return false;
+    }
+  }
+  uint16_t crc;
+  memcpy(&crc, data + 64, 2);
+  if (crc != BlockCrc(data, header.payload_size)) {
+    return false;
+  }
+  if (info) {
+    *info = header;
+  }
+  return true;
+}  // end ReadMotionLogBlockInfo()
+
+/**
+ * @brief Decompresses one block.
+ *
+ * @param data Start of the block.
+ * @param length Bytes available at data.
+ * @param samples Receives the decoded samples.
+ * @param max_samples Room in samples; kMotionLogBlockSamples is always
+ * enough.
+ * @param info Receives the header information. May be NULL.
+ * @return Number of samples decoded, or 0 if the block is invalid or
+ * there was not enough room.
+ */
+size_t DecodeMotionLogBlock(const uint8_t* data, size_t length,
+                            PackedOrientationSample* samples,
+                            size_t max_samples, MotionLogBlockInfo* info) {
+  MotionLogBlockInfo header;
+  if (NULL == info) {
+    info = &header;
+  }
+  if (!ReadMotionLogBlockInfo(data, length, info) ||
+      (info->sample_count > max_samples)) {
+    return 0;
+  }
+  const uint8_t* widths = data + 8;
+  memcpy(&samples[0], data + 32, sizeof(PackedOrientationSample));
+  int32_t fields[kMotionLogFields];
+  ToFields(samples[0], fields);
+  BitReader reader(data + kMotionLogHeaderSize, info->payload_size);
+  for (size_t i = 1; i < info->sample_count; i++) {
+    int32_t yaw = fields[0] + UnZigZag(reader.Read(widths[0]));
+    if (yaw < 0) {
+      yaw += kYawModulus;
+    } else if (yaw >= kYawModulus) {
+      yaw -= kYawModulus;
+    }
+    fields[0] = yaw;
+    for (size_t f = 1; f < kMotionLogFields; f++) {
+      fields[f] += UnZigZag(reader.Read(widths[f]));
+    }
+    FromFields(fields, &samples[i]);
+  }
+  return info->sample_count;
+}  // end DecodeMotionLogBlock()
+
+/**
+ * @brief Finds the next valid block at or after offset.
+ *
+ * Used to start decoding part-way through a log, or to skip over a
+ * damaged block.
+ *
+ * @param data Start of the log.
+ * @param length Bytes in the log.
+ * @param offset Where to start looking.
+ * @return Offset of the next valid block, or length if there is none.
+ */
+size_t FindMotionLogBlock(const uint8_t* data, size_t length, size_t offset) {
+  while (offset + kMotionLogHeaderSize <= length) {
+    const void* found =
+        memchr(data + offset, kSyncMarker[0], length - offset);
+    if (NULL == found) {
+      break;
+    }
+    offset = (const uint8_t*)found - data;
+    if (ReadMotionLogBlockInfo(data + offset, length - offset, NULL)) {
+      return offset;
+    }
+    offset++;
+  }
+  return length;
+}  // end FindMotionLogBlock()
+
+/**
+ * @brief Returns the fusion sequence number of a sample of a block,
+ * interpolated between those of its first and last samples.
+ *
+ * @param info Header of the block.
+ * @param index Index of the sample within the block.
+ */
+uint32_t MotionLogSampleSequence(const MotionLogBlockInfo& info,
+                                 size_t index) {
+  if (info.sample_count < 2) {
+    return info.first_sequence;
+  }
+  uint32_t span = info.last_sequence - info.first_sequence;
+  return info.first_sequence +
+         (uint32_t)(((uint64_t)span * index + (info.sample_count - 1) / 2) /
+                    (info.sample_count - 1));
+}  // end MotionLogSampleSequence()
+
+/**
+ * @brief Returns the wall-clock time of a sample of a block, interpolated
+ * between those of its first and last samples.
+ *
+ * @param info Header of the block.
+ * @param index Index of the sample within the block.
+ * @return Time in ms since the Unix epoch, or 0 if the block's times are
+ * unknown.
+ */
+uint64_t MotionLogSampleTime(const MotionLogBlockInfo& info, size_t index) {
+  if ((0 == info.first_sk_time_ms) || (0 == info.last_sk_time_ms) ||
+      (info.last_sk_time_ms < info.first_sk_time_ms)) {
+    return 0;
+  }
+  if (info.sample_count < 2) {
+    return info.first_sk_time_ms;
+  }
+  uint64_t span = info.last_sk_time_ms - info.first_sk_time_ms;
+  return info.first_sk_time_ms +
+         (span * index + (info.sample_count - 1) / 2) /
+             (info.sample_count - 1);
+}  // end MotionLogSampleTime()
+
+}  // namespace sensesp
@@ -0,0 +1,110 @@
+/** @file motion_log_codec.h
+ *  @brief Block-based compression of orientation sample streams.
+ *
+ * This file does not depend on Arduino or SensESP, so that the same
+ * codec is used by the on-device recorder and by host-side tools.
+ */
+
+#ifndef motion_log_codec_H_
+#define motion_log_codec_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "orientation_sample.h"
+
+namespace sensesp {
+
+/**
+ * A motion log is a sequence of independent blocks, each holding up to
+ * kMotionLogBlockSamples samples. Every block begins with a header
+ * containing a sync marker, the timestamps and sequence numbers of its
+ * first and last samples, and that first sample uncompressed, so
+ * decoding can start at any block. Samples are recorded at a fixed
+ * decimation of the fusion rate, so the time and sequence number of the
+ * others are interpolated between the first and last; the sample's own
+ * dt saturates at 255 ms, which is too short for long-term logs. Following the header, each later sample is coded
+ * field by field as the zig-zag encoded difference from the previous
+ * sample, bit-packed using the fewest bits that hold that field's
+ * largest difference within the block. Smoothly-varying motion data
+ * thus takes a few bits per field. A CRC over the block detects
+ * corruption and false sync markers.
+ *
+ * Block layout, little-endian:
+ *   offset  size  content
+ *        0     4  sync marker "MLB1"
+ *        4     2  number of samples, including the first
+ *        6     2  number of bytes of packed payload
+ *        8    11  bit width used for each of the kMotionLogFields fields
+ *       19     1  format version, currently 2
+ *       20     4  fusion sequence number of the first sample
+ *       24     8  wall-clock time of first sample, in ms since Unix epoch
+ *       32    20  first sample, as a PackedOrientationSample
+ *       52     4  fusion sequence number of the last sample
+ *       56     8  wall-clock time of last sample, in ms since Unix epoch
+ *       64     2  CRC-16/CCITT of bytes 0..63 and the payload
+ *       66     -  packed payload
+ */
+const size_t kMotionLogBlockSamples = 128;  ///< max samples per block
+const size_t kMotionLogFields = 11;         ///< fields per sample
+const size_t kMotionLogHeaderSize = 66;     ///< bytes of block header
+/// Largest possible block: header plus 17 bits per field per sample
+const size_t kMotionLogMaxBlockSize =
+    kMotionLogHeaderSize +
+    ((kMotionLogBlockSamples - 1) * kMotionLogFields * 17 + 7) / 8;
+
+/// Information from the header of one block
+struct MotionLogBlockInfo {
+  uint16_t sample_count;     ///< samples in the block
+  uint16_t payload_size;     ///< bytes of packed payload
+  uint32_t first_sequence;   ///< fusion sequence number of first sample
+  uint64_t first_sk_time_ms;  ///< wall-clock time of first sample, or 0
+  uint32_t last_sequence;    ///< fusion sequence number of last sample
+  uint64_t last_sk_time_ms;  ///< wall-clock time of last sample, or 0
+  size_t block_size;         ///< total bytes, header plus payload
+};
+
+/**
+ * @brief MotionLogEncoder collects samples and compresses them into
+ * blocks.
+ *
+ * Add() samples until IsFull(), then Finish() to produce the block and
+ * start the next one. The encoder needs about 2.6 kB of RAM for the
+ * samples of the block under construction.
+ */
+class MotionLogEncoder {
+ public:
+  MotionLogEncoder()
+      : count_{0},
+        first_sequence_{0},
+        first_sk_time_ms_{0},
+        last_sequence_{0},
+        last_sk_time_ms_{0} {}
+  void Add(const PackedOrientationSample& sample, uint32_t sequence,
+           uint64_t sk_time_ms);
+  bool IsFull(void) const { return count_ >= kMotionLogBlockSamples; }
+  bool IsEmpty(void) const { return 0 == count_; }
+  size_t Finish(uint8_t* block, size_t block_size);
+
+ private:
+  PackedOrientationSample samples_[kMotionLogBlockSamples];
+  size_t count_;               ///< samples in the current block
+  uint32_t first_sequence_;    ///< sequence number of first sample
+  uint64_t first_sk_time_ms_;  ///< wall-clock time of first sample
+  uint32_t last_sequence_;     ///< sequence number of last sample
+  uint64_t last_sk_time_ms_;   ///< wall-clock time of last sample
+};
+
+bool ReadMotionLogBlockInfo(const uint8_t* data, size_t length,
+                            MotionLogBlockInfo* info);
+size_t DecodeMotionLogBlock(const uint8_t* data, size_t length,
+                            PackedOrientationSample* samples,
+                            size_t max_samples,
+                            MotionLogBlockInfo* info = NULL);
+size_t FindMotionLogBlock(const uint8_t* data, size_t length, size_t offset);
+uint32_t MotionLogSampleSequence(const MotionLogBlockInfo& info, size_t index);
+uint64_t MotionLogSampleTime(const MotionLogBlockInfo& info, size_t index);
+
+}  // namespace sensesp
+
+#endif  // motion_log_codec_H_
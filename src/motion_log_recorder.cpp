@@ -0,0 +1,158 @@
+/** @file motion_log_recorder.cpp
+ *  @brief Records compressed orientation samples to flash for long passages.
+ */
+
+#include "motion_log_recorder.h"
+
+#include <SPIFFS.h>
+
+#include "sensesp.h"
+
+namespace sensesp {
+
+/**
+ * @brief Constructor finds the log file to continue with and starts
+ * recording.
+ *
+ * @param orientation_sensor Pointer to the physical sensor's interface
+ * @param decimation Record one of every decimation fusion runs. With the
+ * default FUSION_HZ of 40, 600 records one sample every 15 s.
+ * @param max_file_bytes Size at which logging moves to the next file.
+ * @param max_files Number of files to rotate through.
+ */
+MotionLogRecorder::MotionLogRecorder(OrientationSensor* orientation_sensor,
+                                     uint decimation, size_t max_file_bytes,
+                                     uint max_files)
+    : orientation_sensor_{orientation_sensor},
+      block_length_{0},
+      is_write_pending_{false},
+      writer_task_{NULL},
+      decimation_{decimation > 0 ? decimation : 1},
+      fusion_count_{0},
+      last_record_us_{0},
+      has_recorded_{false},
+      max_file_bytes_{max_file_bytes},
+      max_files_{max_files > 0 ? max_files : 1},
+      file_index_{0} {
+  SelectNewestFile();
+  TaskHandle_t writer_task;
+  xTaskCreate(WriterTask, "MotionLogWriter", 4096, this, 1, &writer_task);
+  writer_task_ = writer_task;
+  orientation_sensor_->attach([this]() { this->Record(); });
+}  // end MotionLogRecorder()
+
+/**
+ * @brief Returns the name of the log file with the given index.
+ */
+String MotionLogRecorder::FileName(uint index) const {
+  return "/mlog" + String(index) + ".bin";
+}  // end FileName()
+
+/**
+ * @brief Chooses the file to append to after a restart.
+ *
+ * That is the file whose first block is the most recent, unless it is
+ * already full, in which case it's the one after it.
+ */
+void MotionLogRecorder::SelectNewestFile(void) {
+  uint64_t newest_time_ms = 0;
+  uint32_t newest_sequence = 0;
+  for (uint i = 0; i < max_files_; i++) {
+    File file = SPIFFS.open(FileName(i), "r");
+    if (!file) {
+      continue;
+    }
+    MotionLogBlockInfo info;
+    size_t length = file.read(block_, kMotionLogMaxBlockSize);
+    if (ReadMotionLogBlockInfo(block_, length, &info) &&
+        ((info.first_sk_time_ms > newest_time_ms) ||
+         ((0 == newest_time_ms) && (info.first_sequence > newest_sequence)))) {
+      newest_time_ms = info.first_sk_time_ms;
+      newest_sequence = info.first_sequence;
+      file_index_ = i;
+    }
+    file.close();
+  }
+  File file = SPIFFS.open(FileName(file_index_), "r");
+  if (file && (file.size() >= max_file_bytes_)) {
+    file_index_ = (file_index_ + 1) % max_files_;
+    SPIFFS.remove(FileName(file_index_));
+  }
+  file.close();
+}  // end SelectNewestFile()
+
+/**
+ * @brief Adds the latest fusion result to the block being built, and
+ * once the block is full, schedules it to be written.
+ *
+ * Called after every fusion run, so nothing here touches flash.
+ */
+void MotionLogRecorder::Record(void) {
+  if (++fusion_count_ < decimation_) {
+    return;
+  }
+  fusion_count_ = 0;
+  const FusionEpoch& epoch = orientation_sensor_->GetFusionEpoch();
+  OrientationSample sample;
+  orientation_sensor_->GetOrientationSample(&sample);
+  if (has_recorded_) {
+    sample.dt = (epoch.monotonic_us - last_record_us_) / 1e6;
+  }
+  last_record_us_ = epoch.monotonic_us;
+  has_recorded_ = true;
+  PackedOrientationSample packed;
+  EncodeOrientationSample(sample, &packed);
+  encoder_.Add(packed, epoch.sequence, epoch.sk_time_ms);
+  if (encoder_.IsFull() && !is_write_pending_) {
+    is_write_pending_ = true;
+    ReactESP::app->onDelay(0, [this]() { this->FinishBlock(); });
+  }
+}  // end Record()
+
+/**
+ * @brief Compresses the collected samples into block_, which empties the
+ * encoder for the next block, and has the writer task write it.
+ *
+ * Runs from the main loop, outside the fusion run.
+ */
+void MotionLogRecorder::FinishBlock(void) {
+  block_length_ = encoder_.Finish(block_, sizeof(block_));
+  xTaskNotifyGive((TaskHandle_t)writer_task_);
+}  // end FinishBlock()
+
+/**
+ * @brief Writes each block it is notified of, then allows the next one.
+ *
+ * @param recorder The MotionLogRecorder whose blocks are written.
+ */
+void MotionLogRecorder::WriterTask(void* recorder) {
+  MotionLogRecorder* self = (MotionLogRecorder*)recorder;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    self->WriteBlock();
+    self->is_write_pending_ = false;
+  }
+}  // end WriterTask()
+
+/**
+ * @brief Appends the compressed block to the current file, moving on to
+ * the next file if this one is full.
+ *
+ * Runs in the writer task, so flash writes hold up neither fusion nor
+ * the main loop.
+ */
+void MotionLogRecorder::WriteBlock(void) {
+  size_t length = block_length_;
+  File file = SPIFFS.open(FileName(file_index_), FILE_APPEND);
+  if (file && (file.size() + length > max_file_bytes_)) {
+    file.close();
+    file_index_ = (file_index_ + 1) % max_files_;
+    file = SPIFFS.open(FileName(file_index_), FILE_WRITE);  // truncates
+  }
+  if (!file || (file.write(block_, length) != length)) {
+    debugE("Unable to write motion log %s", FileName(file_index_).c_str());
+  }
+  file.close();
+}  // end WriteBlock()
+
+}  // namespace sensesp
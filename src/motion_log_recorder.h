@@ -0,0 +1,60 @@
+/** @file motion_log_recorder.h
+ *  @brief Records compressed orientation samples to flash for long passages.
+ */
+
+#ifndef motion_log_recorder_H_
+#define motion_log_recorder_H_
+
+#include "motion_log_codec.h"
+#include "orientation_sensor.h"
+
+namespace sensesp {
+
+/**
+ * @brief MotionLogRecorder compresses the orientation sample stream with
+ * MotionLogEncoder and appends the blocks to files in SPIFFS.
+ *
+ * Logging rotates through max_files files of up to max_file_bytes each,
+ * overwriting the oldest file once all are full, so flash use is fixed.
+ * A block is written each time kMotionLogBlockSamples samples have been
+ * collected (every 32 minutes at the default of one sample per 15 s),
+ * which keeps flash writes infrequent. The block is compressed in the
+ * next pass of the main loop, and written to flash by a task of its own,
+ * so neither fusion nor the main loop waits for flash. Recording goes on
+ * into the next block meanwhile; only if that fills before the write is
+ * done are samples not recorded. Files are named /mlog<N>.bin and can be
+ * decoded on a host with tools/motion_log_decode.cpp.
+ */
+class MotionLogRecorder {
+ public:
+  MotionLogRecorder(OrientationSensor* orientation_sensor,
+                    uint decimation = 600, size_t max_file_bytes = 24576,
+                    uint max_files = 2);
+  OrientationSensor*
+      orientation_sensor_;  ///< Pointer to the orientation sensor
+
+ private:
+  void Record(void);       ///< adds the latest fusion result to the encoder
+  void FinishBlock(void);  ///< compresses the full block for the writer
+  void WriteBlock(void);   ///< appends the compressed block to a file
+  static void WriterTask(void* recorder);  ///< runs WriteBlock() on notify
+  String FileName(uint index) const;
+  void SelectNewestFile(void);  ///< finds where to continue after boot
+  MotionLogEncoder encoder_;    ///< block under construction
+  uint8_t block_[kMotionLogMaxBlockSize];  ///< finished block
+  size_t block_length_;       ///< bytes in block_
+  volatile bool is_write_pending_;  ///< true until block_ has been written
+  void* writer_task_;         ///< handle of the task running WriteBlock()
+  uint decimation_;           ///< record one of every decimation_ fusion runs
+  uint fusion_count_;         ///< fusion runs since last recorded sample
+  uint32_t last_record_us_;   ///< micros() of last recorded sample
+  bool has_recorded_;         ///< true once a sample has been recorded
+  size_t max_file_bytes_;     ///< size at which next file is started
+  uint max_files_;            ///< number of files rotated through
+  uint file_index_;           ///< file currently being appended to
+
+};  // end class MotionLogRecorder
+
+}  // namespace sensesp
+
+#endif  // motion_log_recorder_H_
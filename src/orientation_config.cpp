@@ -0,0 +1,263 @@
+/** @file orientation_config.cpp
+ *  @brief One configuration document for many orientation producers.
+ */
+
+#include "orientation_config.h"
+
+#include <AsyncJson.h>
+#include <SPIFFS.h>
+
+#include "sensesp.h"
+
+namespace sensesp {
+
+/**
+ * @brief Constructor sets up the HTTP server for the document.
+ *
+ * The saved document isn't read until start(), by which time all the
+ * members have been added.
+ *
+ * @param config_path RESTful path of the whole document, and name of the
+ * file it is saved in. Must be less than 32 characters.
+ * @param http_port Port on which /config<config_path> is served, or 0
+ * for none.
+ */
+OrientationConfig::OrientationConfig(String config_path, uint16_t http_port)
+    : Configurable(config_path), server_{NULL} {
+  if (config_path_ == "" || 0 == http_port) {
+    return;
+  }
+  String uri = "/config" + config_path_;
+  server_ = new AsyncWebServer(http_port);
+  server_->on(uri.c_str(), HTTP_GET, [this](AsyncWebServerRequest* request) {
+    this->HandleGet(request);
+  });
+  auto* put_handler = new AsyncCallbackJsonWebHandler(
+      uri, [this](AsyncWebServerRequest* request, JsonVariant& json) {
+        this->HandlePut(request, json);
+      },
+      kDocumentSize);
+  put_handler->setMethod(HTTP_PUT);
+  server_->addHandler(put_handler);
+}  // end OrientationConfig()
+
+/**
+ * @brief Adds a producer's configuration to the document.
+ *
+ * @param key Name of the member in the document. Must remain valid for
+ * the life of the program, e.g. a string literal.
+ * @param member The producer. It should have been created with an empty
+ * config path, so it isn't also loaded and saved on its own.
+ */
+void OrientationConfig::Add(const char* key, Configurable* member) {
+  if (member->config_path_ != "") {
+    debugE("Config: %s also has its own path %s", key,
+           member->config_path_.c_str());
+  }
+  members_.push_back({key, member});
+}  // end Add()
+
+/**
+ * @brief Loads the saved document into all the members.
+ *
+ * The start() function is inherited from sensesp::Startable, and is
+ * automatically called when the SensESP app starts. Members whose timers
+ * have already started pick up a changed report interval on the next
+ * pass of the main loop.
+ */
+void OrientationConfig::start() {
+  LoadFromFile();
+  if (server_) {
+    server_->begin();
+  }
+}  // end start()
+
+/**
+ * @brief Sends the whole document.
+ */
+void OrientationConfig::HandleGet(AsyncWebServerRequest* request) {
+  DynamicJsonDocument doc(kDocumentSize);
+  JsonObject config = doc.to<JsonObject>();
+  get_configuration(config);
+  if (doc.overflowed()) {
+    request->send(500, "text/plain", "Configuration too large");
+    return;
+  }
+  AsyncResponseStream* response =
+      request->beginResponseStream("application/json");
+  serializeJson(doc, *response);
+  request->send(response);
+}  // end HandleGet()
+
+/**
+ * @brief Applies and saves a new document.
+ *
+ * @param json The request body, parsed into a kDocumentSize document.
+ */
+void OrientationConfig::HandlePut(AsyncWebServerRequest* request,
+                                  JsonVariant& json) {
+  if (!json.is<JsonObject>()) {
+    request->send(400, "text/plain", "Expected a JSON object");
+    return;
+  }
+  JsonObject config = json.as<JsonObject>();
+  if (!set_configuration(config)) {
+    request->send(400, "text/plain", "Configuration rejected");
+    return;
+  }
+  save_configuration();
+  request->send(200, "text/plain", "OK");
+}  // end HandlePut()
+
+/**
+ * @brief Reads the document from flash and applies it.
+ *
+ * This replaces Configurable::load_configuration(), whose document is
+ * too small to hold the configurations of many producers.
+ */
+void OrientationConfig::LoadFromFile(void) {
+  if (config_path_ == "" || !SPIFFS.exists(config_path_)) {
+    debugI("Config: no saved configuration at %s", config_path_.c_str());
+    return;
+  }
+  File file = SPIFFS.open(config_path_, "r");
+  DynamicJsonDocument doc(kDocumentSize);
+  DeserializationError error = deserializeJson(doc, file);
+  file.close();
+  if (error) {
+    debugE("Config: could not parse %s: %s", config_path_.c_str(),
+           error.c_str());
+    return;
+  }
+  JsonObject config = doc.as<JsonObject>();
+  if (!set_configuration(config)) {
+    debugE("Config: saved configuration at %s was rejected",
+           config_path_.c_str());
+  }
+}  // end LoadFromFile()
+
+/**
+ * @brief Writes the document to flash.
+ *
+ * Called by SensESP after the configuration has been set through the
+ * web interface or the RESTful API.
+ */
+void OrientationConfig::save_configuration() {
+  if (config_path_ == "") {
+    return;
+  }
+  DynamicJsonDocument doc(kDocumentSize);
+  JsonObject config = doc.to<JsonObject>();
+  get_configuration(config);
+  if (doc.overflowed()) {
+    debugE("Config: configuration exceeds %u bytes; not saved",
+           kDocumentSize);
+    return;
+  }
+  File file = SPIFFS.open(config_path_, "w");
+  serializeJson(doc, file);
+  file.close();
+}  // end save_configuration()
+
+/**
+ * @brief Copies the current configuration of every member.
+ *
+ * @param snapshot Document to hold the copy.
+ * @return True if the copy is complete.
+ */
+bool OrientationConfig::Snapshot(DynamicJsonDocument& snapshot) {
+  JsonObject root = snapshot.to<JsonObject>();
+  get_configuration(root);
+  return !snapshot.overflowed();
+}  // end Snapshot()
+
+/**
+ * @brief Puts the first count members back to their configurations
+ * from a snapshot.
+ *
+ * @param snapshot Copy made by Snapshot().
+ * @param count Number of members to restore.
+ */
+void OrientationConfig::Restore(DynamicJsonDocument& snapshot, size_t count) {
+  for (size_t i = 0; i < count && i < members_.size(); i++) {
+    JsonObject previous = snapshot[members_[i].key];
+    members_[i].configurable->set_configuration(previous);
+  }
+}  // end Restore()
+
+/**
+ * @brief Get the current configuration of all members and place it in
+ * a JSON object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void OrientationConfig::get_configuration(JsonObject& doc) {
+  for (auto& member : members_) {
+    JsonObject member_config = doc.createNestedObject(member.key);
+    member.configurable->get_configuration(member_config);
+  }
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration,
+ * assembled from the schemas of the members.
+ *
+ * It is only built when the web interface asks for it.
+ */
+String OrientationConfig::get_config_schema() {
+  String schema = "{ \"type\": \"object\", \"properties\": { ";
+  for (size_t i = 0; i < members_.size(); i++) {
+    if (i > 0) {
+      schema += ", ";
+    }
+    schema += "\"";
+    schema += members_[i].key;
+    schema += "\": ";
+    schema += members_[i].configurable->get_config_schema();
+  }
+  schema += " } }";
+  return schema;
+}  // end get_config_schema()
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the members.
+ *
+ * The current configuration is snapshotted first. If a member rejects
+ * its part, every member changed so far is restored from the snapshot.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated, one nested object per member.
+ * @return True if every member present was updated; False if nothing
+ * was changed.
+ */
+bool OrientationConfig::set_configuration(const JsonObject& config) {
+  for (auto& member : members_) {
+    if (config.containsKey(member.key) &&
+        !config[member.key].is<JsonObject>()) {
+      return false;
+    }
+  }
+  DynamicJsonDocument snapshot(kDocumentSize);
+  if (!Snapshot(snapshot)) {
+    debugE("Config: configuration exceeds %u bytes; not applied",
+           kDocumentSize);
+    return false;
+  }
+  for (size_t i = 0; i < members_.size(); i++) {
+    if (!config.containsKey(members_[i].key)) {
+      continue;
+    }
+    JsonObject member_config = config[members_[i].key];
+    if (!members_[i].configurable->set_configuration(member_config)) {
+      debugE("Config: %s rejected its configuration; none applied",
+             members_[i].key);
+      Restore(snapshot, i + 1);
+      return false;
+    }
+  }
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
@@ -0,0 +1,72 @@
+/** @file orientation_config.h
+ *  @brief One configuration document for many orientation producers.
+ */
+
+#ifndef orientation_config_H_
+#define orientation_config_H_
+
+#include <vector>
+
+#include <ESPAsyncWebServer.h>
+
+#include "sensesp/system/configurable.h"
+#include "sensesp/system/startable.h"
+
+namespace sensesp {
+
+/**
+ * @brief OrientationConfig gathers the configurations of any number of
+ * producers into one document, held under a single config path.
+ *
+ * Each producer normally has its own config path, and so its own file
+ * that is read at boot and written on every change, and its own RESTful
+ * endpoint. Producers created with an empty config path and added here
+ * instead become one member of a JSON object, keyed by the name given to
+ * Add(). The whole document is read from flash once, at startup, and can
+ * be fetched or replaced with a single request to /config<config_path>
+ * on http_port.
+ *
+ * SensESP's own /config handler on port 80 parses requests into a 1 kB
+ * document, which a PUT of the whole document overflows once there are
+ * more than a handful of members, so the request is rejected. The
+ * document is therefore served by its own HTTP server, which parses into
+ * kDocumentSize bytes, like the one OrientationHistory uses.
+ *
+ * Setting the configuration is all-or-nothing: if any member rejects
+ * its part, the members already changed are put back as they were and
+ * the document is not saved. Members missing from a new document are
+ * left unchanged, so a provisioning script may send only what it sets.
+ */
+class OrientationConfig : public Configurable, public Startable {
+ public:
+  OrientationConfig(String config_path = "/orientation",
+                    uint16_t http_port = 8083);
+  void Add(const char* key, Configurable* member);
+  void start() override;  ///< loads the saved document, starts the server
+  virtual void save_configuration() override;
+
+ private:
+  /// A producer whose configuration is part of the document
+  struct Member {
+    const char* key;            ///< name of the member in the document
+    Configurable* configurable;  ///< the producer itself
+  };
+  /// Capacity of the document read from or written to flash
+  static const size_t kDocumentSize = 4096;
+
+  void LoadFromFile(void);
+  void HandleGet(AsyncWebServerRequest* request);
+  void HandlePut(AsyncWebServerRequest* request, JsonVariant& json);
+  bool Snapshot(DynamicJsonDocument& snapshot);
+  void Restore(DynamicJsonDocument& snapshot, size_t count);
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  std::vector<Member> members_;  ///< all members, in order added
+  AsyncWebServer* server_;       ///< serves the whole document
+
+};  // end class OrientationConfig
+
+}  // namespace sensesp
+
+#endif  // orientation_config_H_
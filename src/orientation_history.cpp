@@ -0,0 +1,143 @@
+/** @file orientation_history.cpp
+ *  @brief RAM history of recent attitude, downloadable over HTTP.
+ */
+
+#include "orientation_history.h"
+
+#include <algorithm>
+
+#include "sensesp.h"
+
+namespace sensesp {
+
+/**
+ * @brief Constructor allocates the ring buffer and starts recording.
+ *
+ * @param orientation_sensor Pointer to the physical sensor's interface
+ * @param capacity Number of samples kept. Each takes 20 bytes of RAM.
+ * @param decimation Record one of every decimation fusion runs. 1 records
+ * at the full fusion rate (FUSION_HZ).
+ * @param http_port TCP port on which the history is served. It must
+ * differ from that of the SensESP web interface (80).
+ */
+OrientationHistory::OrientationHistory(OrientationSensor* orientation_sensor,
+                                       size_t capacity, uint decimation,
+                                       uint16_t http_port)
+    : orientation_sensor_{orientation_sensor},
+      capacity_{capacity},
+      written_{0},
+      decimation_{decimation > 0 ? decimation : 1},
+      fusion_count_{0},
+      last_record_us_{0},
+      newest_epoch_{0, 0, 0},
+      is_streaming_{false},
+      server_{NULL} {
+  samples_ = (PackedOrientationSample*)malloc(capacity_ * sizeof(PackedOrientationSample));
+  if (NULL == samples_) {
+    debugE("Insufficient memory for orientation history");
+    capacity_ = 0;
+    return;
+  }
+  server_ = new AsyncWebServer(http_port);
+  server_->on("/history", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    this->HandleRequest(request);
+  });
+  orientation_sensor_->attach([this]() { this->Record(); });
+}  // end OrientationHistory()
+
+/**
+ * @brief Starts the HTTP server.
+ *
+ * The start() function is inherited from sensesp::Startable, and is
+ * automatically called when the SensESP app starts.
+ */
+void OrientationHistory::start() {
+  if (capacity_ > 0) {
+    server_->begin();
+  }
+}
+
+/**
+ * @brief Quantizes the latest fusion result into the ring buffer.
+ *
+ * Called after every fusion run. Invalid results are not recorded.
+ */
+void OrientationHistory::Record(void) {
+  if (++fusion_count_ < decimation_) {
+    return;
+  }
+  fusion_count_ = 0;
+  if (is_streaming_ ||
+      !orientation_sensor_->sensor_interface_->IsDataValid()) {
+    return;
+  }
+  const FusionEpoch& epoch = orientation_sensor_->GetFusionEpoch();
+  OrientationSample sample;
+  orientation_sensor_->GetOrientationSample(&sample);
+  if (written_ > 0) {
+    sample.dt = (epoch.monotonic_us - last_record_us_) / 1e6;
+  }
+  EncodeOrientationSample(sample, &samples_[written_ % capacity_]);
+  last_record_us_ = epoch.monotonic_us;
+  newest_epoch_ = epoch;
+  written_++;
+}  // end Record()
+
+/**
+ * @brief Streams the header and samples, oldest first.
+ *
+ * Each chunk is filled by copying straight from the ring buffer into the
+ * response buffer, wrapping around the end of the ring as needed.
+ */
+void OrientationHistory::HandleRequest(AsyncWebServerRequest* request) {
+  if (is_streaming_) {
+    request->send(503, "text/plain", "History download already in progress");
+    return;
+  }
+  HistoryHeader header;
+  memcpy(header.magic, "OHST", 4);
+  header.version = 2;
+  header.sample_size = sizeof(PackedOrientationSample);
+  header.interval_ms = decimation_ * 1000 / FUSION_HZ;
+  header.sample_count = (written_ < capacity_) ? written_ : capacity_;
+  header.newest_sequence = newest_epoch_.sequence;
+  header.newest_sk_time_ms = newest_epoch_.sk_time_ms;
+  const uint32_t first = written_ - header.sample_count;
+  const size_t total_bytes =
+      sizeof(HistoryHeader) + header.sample_count * sizeof(PackedOrientationSample);
+  is_streaming_ = true;
+
+  AsyncWebServerResponse* response = request->beginChunkedResponse(
+      "application/octet-stream",
+      [this, header, first, total_bytes](uint8_t* buffer, size_t max_len,
+                                         size_t index) -> size_t {
+        size_t len = 0;
+        while ((len < max_len) && (index < total_bytes)) {
+          size_t count;
+          const uint8_t* source;
+          if (index < sizeof(HistoryHeader)) {
+            source = (const uint8_t*)&header + index;
+            count = sizeof(HistoryHeader) - index;
+          } else {
+            size_t offset = index - sizeof(HistoryHeader);
+            size_t slot = (first + offset / sizeof(PackedOrientationSample)) % capacity_;
+            size_t within = offset % sizeof(PackedOrientationSample);
+            source = (const uint8_t*)&samples_[slot] + within;
+            count = (capacity_ - slot) * sizeof(PackedOrientationSample) - within;
+          }
+          count = std::min(count,
+                           std::min(max_len - len, total_bytes - index));
+          memcpy(buffer + len, source, count);
+          len += count;
+          index += count;
+        }
+        if (index >= total_bytes) {
+          is_streaming_ = false;
+        }
+        return len;
+      });
+  request->onDisconnect([this]() { is_streaming_ = false; });
+  request->send(response);
+}  // end HandleRequest()
+
+}  // namespace sensesp
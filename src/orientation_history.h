@@ -0,0 +1,70 @@
+/** @file orientation_history.h
+ *  @brief RAM history of recent attitude, downloadable over HTTP.
+ */
+
+#ifndef orientation_history_H_
+#define orientation_history_H_
+
+#include <ESPAsyncWebServer.h>
+
+#include "orientation_sample.h"
+#include "orientation_sensor.h"
+#include "sensesp/system/startable.h"
+
+namespace sensesp {
+
+/**
+ * @brief OrientationHistory keeps the last minutes of orientation at
+ * full fusion rate in a RAM ring buffer, and serves it over HTTP.
+ *
+ * Signal K only delivers the live value, whereas troubleshooting from
+ * shore usually needs what happened in the recent past. Each sample of
+ * attitude, rates and acceleration is stored as a 20 byte
+ * PackedOrientationSample, so that e.g. 3000 samples (75 s at 40 Hz)
+ * fit in 60 kB. The buffer is allocated once, at construction.
+ *
+ * GET http://<device>:<port>/history returns a HistoryHeader followed by
+ * the samples, oldest first, all little-endian. The response is sent
+ * with chunked transfer, each chunk filled directly from the ring
+ * buffer, so no copy of the history is made. Recording pauses while a
+ * download is in progress so that the samples being sent can't be
+ * overwritten.
+ */
+class OrientationHistory : public Startable {
+ public:
+  /// Start of the HTTP response, describing the samples that follow
+  struct HistoryHeader {
+    char magic[4];          ///< "OHST"
+    uint8_t version;        ///< format version, currently 2
+    uint8_t sample_size;    ///< bytes per sample
+    uint16_t interval_ms;   ///< nominal time between samples
+    uint32_t sample_count;  ///< number of samples that follow
+    uint32_t newest_sequence;   ///< fusion sequence of newest sample
+    uint64_t newest_sk_time_ms;  ///< wall-clock time of newest sample, or 0
+  };
+
+  OrientationHistory(OrientationSensor* orientation_sensor,
+                     size_t capacity = 3000, uint decimation = 1,
+                     uint16_t http_port = 8082);
+  void start() override;  ///< starts the HTTP server
+  OrientationSensor*
+      orientation_sensor_;  ///< Pointer to the orientation sensor
+
+ private:
+  void Record(void);  ///< adds the latest fusion result to the ring
+  void HandleRequest(AsyncWebServerRequest* request);
+  PackedOrientationSample* samples_;  ///< ring buffer storage
+  size_t capacity_;          ///< number of samples the ring can hold
+  uint32_t written_;         ///< total number of samples ever written
+  uint decimation_;          ///< record one of every decimation_ fusion runs
+  uint fusion_count_;        ///< fusion runs since last recorded sample
+  uint32_t last_record_us_;  ///< micros() of last recorded sample
+  FusionEpoch newest_epoch_;  ///< epoch of newest recorded sample
+  bool is_streaming_;        ///< true while a download is in progress
+  AsyncWebServer* server_;   ///< server for the history endpoint
+
+};  // end class OrientationHistory
+
+}  // namespace sensesp
+
+#endif  // orientation_history_H_
@@ -0,0 +1,155 @@
+/** @file orientation_math.h
+ *  @brief Quaternion helpers for manipulating vessel attitude.
+ *
+ * Attitude is reported by the fusion library as compass heading, pitch
+ * and roll. Operations such as extrapolating or interpolating an attitude
+ * are done on the equivalent unit quaternion to avoid the singularities
+ * and 0/2Pi wrap of Euler angles. The body frame is x to the bow, y to
+ * starboard, and z down, so the rotation order is heading, pitch, roll.
+ */
+
+#ifndef orientation_math_H_
+#define orientation_math_H_
+
+#include <math.h>
+
+namespace sensesp {
+
+/**
+ * UnitQuaternion holds a rotation from the earth frame (North, East,
+ * Down) to the vessel's body frame. q0 is the scalar part.
+ */
+struct UnitQuaternion {
+  float q0;  ///< scalar component
+  float q1;  ///< x (bow) component
+  float q2;  ///< y (starboard) component
+  float q3;  ///< z (down) component
+};
+
+/**
+ * @brief Converts heading, pitch and roll to a unit quaternion.
+ *
+ * @param yaw Compass heading in radians, clockwise from North.
+ * @param pitch Pitch in radians, bow up is positive.
+ * @param roll Roll in radians, starboard down is positive.
+ */
+inline UnitQuaternion QuaternionFromAttitude(float yaw, float pitch,
+                                             float roll) {
+  float cy = cosf(yaw * 0.5f), sy = sinf(yaw * 0.5f);
+  float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+  float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+  UnitQuaternion q;
+  q.q0 = cr * cp * cy + sr * sp * sy;
+  q.q1 = sr * cp * cy - cr * sp * sy;
+  q.q2 = cr * sp * cy + sr * cp * sy;
+  q.q3 = cr * cp * sy - sr * sp * cy;
+  return q;
+}  // end QuaternionFromAttitude()
+
+/**
+ * @brief Converts a unit quaternion to heading, pitch and roll.
+ *
+ * @param q The quaternion to be converted.
+ * @param yaw Receives compass heading in radians, in range [0..2Pi).
+ * @param pitch Receives pitch in radians, in range [-Pi/2..Pi/2].
+ * @param roll Receives roll in radians, in range [-Pi..Pi].
+ */
+inline void QuaternionToAttitude(const UnitQuaternion& q, float* yaw,
+                                 float* pitch, float* roll) {
+  *yaw = atan2f(2.0f * (q.q0 * q.q3 + q.q1 * q.q2),
+                1.0f - 2.0f * (q.q2 * q.q2 + q.q3 * q.q3));
+  if (*yaw < 0.0f) {
+    *yaw += 2.0f * (float)M_PI;
+  }
+  float sin_pitch = 2.0f * (q.q0 * q.q2 - q.q3 * q.q1);
+  if (sin_pitch > 1.0f) {
+    sin_pitch = 1.0f;
+  } else if (sin_pitch < -1.0f) {
+    sin_pitch = -1.0f;
+  }
+  *pitch = asinf(sin_pitch);
+  *roll = atan2f(2.0f * (q.q0 * q.q1 + q.q2 * q.q3),
+                 1.0f - 2.0f * (q.q1 * q.q1 + q.q2 * q.q2));
+}  // end QuaternionToAttitude()
+
+/**
+ * @brief Rotates an attitude by constant body angular rates over time dt.
+ *
+ * Uses the first-order (small angle) form of the quaternion exponential,
+ * followed by renormalization. For the rotations that occur during the
+ * tens of milliseconds this is used for, the error is negligible and the
+ * cost is about 30 flops.
+ *
+ * @param q Starting attitude.
+ * @param roll_rate Angular rate about the x (bow) axis, in rad/s.
+ * @param pitch_rate Angular rate about the y (starboard) axis, in rad/s.
+ * @param yaw_rate Angular rate about the z (down) axis, in rad/s.
+ * @param dt Time to integrate over, in s. May be negative.
+ */
+inline UnitQuaternion RotateByBodyRates(const UnitQuaternion& q,
+                                        float roll_rate, float pitch_rate,
+                                        float yaw_rate, float dt) {
+  float hx = 0.5f * roll_rate * dt;
+  float hy = 0.5f * pitch_rate * dt;
+  float hz = 0.5f * yaw_rate * dt;
+  UnitQuaternion r;
+  r.q0 = q.q0 - q.q1 * hx - q.q2 * hy - q.q3 * hz;
+  r.q1 = q.q1 + q.q0 * hx + q.q2 * hz - q.q3 * hy;
+  r.q2 = q.q2 + q.q0 * hy + q.q3 * hx - q.q1 * hz;
+  r.q3 = q.q3 + q.q0 * hz + q.q1 * hy - q.q2 * hx;
+  float norm = sqrtf(r.q0 * r.q0 + r.q1 * r.q1 + r.q2 * r.q2 + r.q3 * r.q3);
+  r.q0 /= norm;
+  r.q1 /= norm;
+  r.q2 /= norm;
+  r.q3 /= norm;
+  return r;
+}  // end RotateByBodyRates()
+
+/**
+ * @brief Spherical linear interpolation between two attitudes.
+ *
+ * Follows the shorter arc between a and b at constant angular rate,
+ * so interpolated attitudes lie on the path the vessel actually took
+ * (assuming constant rotation rate between the two samples).
+ *
+ * @param a Attitude at fraction 0.
+ * @param b Attitude at fraction 1.
+ * @param fraction Position between a and b, in range [0..1].
+ */
+inline UnitQuaternion Slerp(const UnitQuaternion& a, const UnitQuaternion& b,
+                            float fraction) {
+  float dot = a.q0 * b.q0 + a.q1 * b.q1 + a.q2 * b.q2 + a.q3 * b.q3;
+  float sign = 1.0f;
+  if (dot < 0.0f) {
+    // q and -q are the same rotation; use the one nearer to a
+    dot = -dot;
+    sign = -1.0f;
+  }
+  float weight_a, weight_b;
+  if (dot > 0.9995f) {
+    // nearly parallel: linear interpolation is accurate and avoids 0/0
+    weight_a = 1.0f - fraction;
+    weight_b = fraction;
+  } else {
+    float theta = acosf(dot);
+    float sin_theta = sinf(theta);
+    weight_a = sinf((1.0f - fraction) * theta) / sin_theta;
+    weight_b = sinf(fraction * theta) / sin_theta;
+  }
+  weight_b *= sign;
+  UnitQuaternion r;
+  r.q0 = weight_a * a.q0 + weight_b * b.q0;
+  r.q1 = weight_a * a.q1 + weight_b * b.q1;
+  r.q2 = weight_a * a.q2 + weight_b * b.q2;
+  r.q3 = weight_a * a.q3 + weight_b * b.q3;
+  float norm = sqrtf(r.q0 * r.q0 + r.q1 * r.q1 + r.q2 * r.q2 + r.q3 * r.q3);
+  r.q0 /= norm;
+  r.q1 /= norm;
+  r.q2 /= norm;
+  r.q3 /= norm;
+  return r;
+}  // end Slerp()
+
+}  // namespace sensesp
+
+#endif  // orientation_math_H_
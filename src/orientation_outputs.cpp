@@ -0,0 +1,227 @@
+/** @file orientation_outputs.cpp
+ *  @brief Many single-value orientation outputs sharing one object.
+ */
+
+#include "orientation_outputs.h"
+
+#include "config_schema.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+/**
+ * @brief Constructor sets up the shared timer interval.
+ *
+ * @param orientation_sensor Pointer to the physical sensor's interface
+ * @param tick_interval_ms Interval of the shared timer. Report intervals
+ * of the outputs are rounded to multiples of this.
+ * @param config_path RESTful path by which the tick interval can be
+ * configured.
+ */
+OrientationOutputs::OrientationOutputs(OrientationSensor* orientation_sensor,
+                                       uint tick_interval_ms,
+                                       String config_path)
+    : Configurable(config_path),
+      orientation_sensor_{orientation_sensor},
+      tick_interval_ms_{tick_interval_ms > 0 ? tick_interval_ms : 1},
+      save_mag_cal_{0},
+      heap_used_{0},
+      scheduler_{orientation_sensor} {
+  HEAP_COUNTER_NAME(heap_counter_, "OrientationOutputs");
+  load_configuration();
+  applied_tick_ms_ = tick_interval_ms_;
+  save_mag_cal_ = 0;
+}  // end OrientationOutputs()
+
+/**
+ * @brief Adds an output of one orientation parameter.
+ *
+ * @param value_type The type of orientation parameter to be output
+ * @param report_interval_ms Interval between output reports
+ * @param deadband Reports are suppressed while the parameter differs from
+ * the last reported value by no more than this. Zero reports every time.
+ * @return The producer of the parameter, to connect consumers to.
+ */
+ValueProducer<float>* OrientationOutputs::Add(
+    OrientationValues::OrientationValType value_type, uint report_interval_ms,
+    float deadband) {
+  uint32_t free_before = ESP.getFreeHeap();
+  Output* out = new Output();
+  out->deadband = deadband;
+  uint ticks = (report_interval_ms + tick_interval_ms_ / 2) / tick_interval_ms_;
+  out->interval_ticks = (ticks < 1) ? 1 : ((ticks > 0xFFFF) ? 0xFFFF : ticks);
+  // stagger the first reports so that outputs added together don't all
+  // fall on the same tick
+  out->ticks_left = 1 + (outputs_.size() % out->interval_ticks);
+  out->value_type = value_type;
+  out->suppressed = kMaxSuppressedReports;  // first report is always sent
+  outputs_.push_back(out);
+  heap_used_ += free_before - ESP.getFreeHeap();
+  return &out->producer;
+}  // end Add()
+
+/**
+ * @brief Starts the timer shared by all outputs.
+ *
+ * The start() function is inherited from sensesp::Startable, and is
+ * automatically called when the SensESP app starts.
+ */
+void OrientationOutputs::start() {
+  scheduler_.Start(tick_interval_ms_, [this]() { this->Update(); });
+}  // end start()
+
+/**
+ * @brief Reports the memory used by the outputs, and for comparison
+ * what the same number of OrientationValues would need.
+ *
+ * OrientationValues' heap use is estimated from the sizes of the object
+ * and its timer reaction; its config path String and configuration
+ * registration come on top of that.
+ */
+void OrientationOutputs::LogFootprint(void) const {
+  size_t count = outputs_.size();
+  if (0 == count) {
+    return;
+  }
+  size_t values_bytes =
+      sizeof(OrientationValues) + sizeof(reactesp::RepeatReaction);
+  debugI("OrientationOutputs: %u outputs, %u bytes object + %u bytes heap "
+         "(%u per output, sizeof(Output) %u)",
+         (unsigned)count, (unsigned)sizeof(OrientationOutputs),
+         (unsigned)heap_used_, (unsigned)(heap_used_ / count),
+         (unsigned)sizeof(Output));
+  debugI("OrientationValues: at least %u bytes per output, %u for %u",
+         (unsigned)values_bytes, (unsigned)(values_bytes * count),
+         (unsigned)count);
+}  // end LogFootprint()
+
+/**
+ * @brief Tests whether value is close enough to the last one reported to
+ * be skipped. Differences in heading are taken the short way around.
+ */
+bool OrientationOutputs::IsWithinDeadband(const Output& out,
+                                          float value) const {
+  if ((out.deadband <= 0.0) || (out.suppressed >= kMaxSuppressedReports)) {
+    return false;
+  }
+  float difference = value - out.producer.get();
+  if ((OrientationValues::kCompassHeading == out.value_type) ||
+      (OrientationValues::kYaw == out.value_type)) {
+    difference = remainderf(difference, 2.0 * PI);
+  }
+  return fabsf(difference) <= out.deadband;
+}  // end IsWithinDeadband()
+
+/**
+ * @brief Converts each output's interval in ticks to the new tick
+ * interval, keeping its interval in ms as close as possible.
+ */
+void OrientationOutputs::RescaleIntervals(void) {
+  uint new_tick_ms = scheduler_.get_interval_ms();
+  for (Output* out : outputs_) {
+    uint32_t interval_ms = (uint32_t)out->interval_ticks * applied_tick_ms_;
+    uint32_t ticks = (interval_ms + new_tick_ms / 2) / new_tick_ms;
+    out->interval_ticks =
+        (ticks < 1) ? 1 : ((ticks > 0xFFFF) ? 0xFFFF : ticks);
+    if (out->ticks_left > out->interval_ticks) {
+      out->ticks_left = out->interval_ticks;
+    }
+  }
+  applied_tick_ms_ = new_tick_ms;
+}  // end RescaleIntervals()
+
+/**
+ * @brief Reads and reports each output that is due on this tick.
+ *
+ * The magnetic calibration save/erase request is handled first, as in
+ * OrientationValues::Update().
+ */
+void OrientationOutputs::Update(void) {
+  HEAP_SCOPE(heap_counter_);
+  SensorFusion* fusion = orientation_sensor_->sensor_interface_;
+  if (1 == save_mag_cal_) {
+    fusion->InjectCommand("SVMC");
+  } else if (-1 == save_mag_cal_) {
+    fusion->InjectCommand("ERMC");
+  }
+  save_mag_cal_ = 0;  // set flag back to zero so we don't repeat save/delete
+  if (scheduler_.get_interval_ms() != applied_tick_ms_) {
+    RescaleIntervals();
+  }
+  if (!fusion->IsDataValid() || orientation_sensor_->IsFusionSuspended()) {
+    return;  // only pass on the data if it is valid and fresh
+  }
+  for (Output* out : outputs_) {
+    if (--out->ticks_left > 0) {
+      continue;
+    }
+    out->ticks_left = out->interval_ticks;
+    float value;
+    if (!OrientationValues::GetValue(
+            orientation_sensor_,
+            (OrientationValues::OrientationValType)out->value_type,
+            &value)) {
+      continue;
+    }
+    if (IsWithinDeadband(*out, value)) {
+      out->suppressed++;
+      continue;
+    }
+    out->suppressed = 0;
+    out->producer.emit(value);
+  }
+}  // end Update()
+
+/**
+ * @brief Define the format for the OrientationOutputs configuration.
+ */
+static const char SCHEMA_OUTPUTS[] PROGMEM = SCHEMA_OBJECT(
+    SCHEMA_NUMBER(CONFIG_KEY_TICK_INTERVAL, "Tick Interval",
+                  "Milliseconds between checks for outputs that are due")
+    ", " SCHEMA_SAVE_MAG_CAL);
+
+/// Keys that a configuration of OrientationOutputs holds
+static const char* const kConfigKeysOutputs[] = {CONFIG_KEY_TICK_INTERVAL,
+                                                 CONFIG_KEY_SAVE_MAG_CAL};
+
+/**
+ * @brief Get the current configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void OrientationOutputs::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_TICK_INTERVAL] = tick_interval_ms_;
+  doc[CONFIG_KEY_SAVE_MAG_CAL] = save_mag_cal_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String OrientationOutputs::get_config_schema() {
+  return FPSTR(SCHEMA_OUTPUTS);
+}
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found.
+ */
+bool OrientationOutputs::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysOutputs)) {
+    return false;
+  }
+  uint tick_interval_ms = config[CONFIG_KEY_TICK_INTERVAL];
+  if (tick_interval_ms > 0) {
+    tick_interval_ms_ = tick_interval_ms;
+    scheduler_.SetInterval(tick_interval_ms_);  // re-arms if running
+  }
+  save_mag_cal_ = config[CONFIG_KEY_SAVE_MAG_CAL];
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
@@ -0,0 +1,83 @@
+/** @file orientation_outputs.h
+ *  @brief Many single-value orientation outputs sharing one object.
+ */
+
+#ifndef orientation_outputs_H_
+#define orientation_outputs_H_
+
+#include <vector>
+
+#include "heap_telemetry.h"
+#include "orientation_sensor.h"
+#include "report_scheduler.h"
+#include "sensesp/system/configurable.h"
+#include "sensesp/system/startable.h"
+#include "sensesp/system/valueproducer.h"
+
+namespace sensesp {
+
+/**
+ * @brief OrientationOutputs provides any number of orientation
+ * parameters, each as its own ValueProducer<float>, from one object.
+ *
+ * It is a lighter-weight alternative to creating an OrientationValues
+ * for each parameter. Each OrientationValues is a full FloatSensor with
+ * its own vtables, config path String, configuration entry and timer.
+ * Here each parameter is a small Output record - its producer (which
+ * holds the consumer list), type, interval, and deadband - and all of
+ * them are serviced by a single timer.
+ *
+ * Report intervals are rounded to a multiple of the tick interval. A
+ * non-zero deadband suppresses reports that differ from the previously
+ * sent value by no more than the deadband, though the value is still
+ * sent at least every kMaxSuppressedReports intervals so that Signal K
+ * doesn't consider it stale.
+ *
+ * Add all outputs before the app is started. The configuration holds
+ * the tick interval and the save_mag_cal flag, applied as for
+ * OrientationValues.
+ */
+class OrientationOutputs : public Configurable, public Startable {
+ public:
+  OrientationOutputs(OrientationSensor* orientation_sensor,
+                     uint tick_interval_ms = 100, String config_path = "");
+  ValueProducer<float>* Add(OrientationValues::OrientationValType value_type,
+                            uint report_interval_ms = 100,
+                            float deadband = 0.0);
+  void start() override;  ///< starts the timer shared by all outputs
+  void LogFootprint(void) const;  ///< logs memory used, vs OrientationValues
+  OrientationSensor*
+      orientation_sensor_;  ///< Pointer to the orientation sensor
+
+ private:
+  /// Per-parameter state. The producer must not move once consumers
+  /// are connected, hence outputs_ holds pointers.
+  struct Output {
+    ValueProducer<float> producer;  ///< value and consumers of this output
+    float deadband;          ///< minimum change worth reporting; 0 for none
+    uint16_t interval_ticks;  ///< ticks between reports
+    uint16_t ticks_left;      ///< ticks until next report
+    uint8_t value_type;       ///< an OrientationValues::OrientationValType
+    uint8_t suppressed;       ///< consecutive reports skipped by deadband
+  };
+  static const uint8_t kMaxSuppressedReports = 10;
+
+  void Update(void);  ///< runs each tick, reporting outputs that are due
+  void RescaleIntervals(void);  ///< adapts outputs to a new tick interval
+  bool IsWithinDeadband(const Output& out, float value) const;
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  std::vector<Output*> outputs_;  ///< all outputs, in order added
+  uint tick_interval_ms_;    ///< interval of the shared timer
+  uint applied_tick_ms_;     ///< tick interval that interval_ticks assume
+  int8_t save_mag_cal_;      ///< Flag for saving current magnetic calibration
+  uint32_t heap_used_;       ///< heap bytes allocated by Add()
+  ReportScheduler scheduler_;  ///< runs Update() every tick_interval_ms_
+  HEAP_COUNTER(heap_counter_)  ///< allocations made by Update()
+
+};  // end class OrientationOutputs
+
+}  // namespace sensesp
+
+#endif  // orientation_outputs_H_
@@ -0,0 +1,80 @@
+/** @file orientation_sample.cpp
+ *  @brief Compact fixed-point format for storing orientation samples.
+ */
+
+#include "orientation_sample.h"
+
+#include <math.h>
+
+namespace sensesp {
+
+namespace {
+
+const float kCentiDegPerRad = 18000.0f / (float)M_PI;
+const float kMilliGPerMPerSS = 1000.0f / 9.80665f;
+
+/// Rounds to the nearest int16, saturating at the limits of the range
+int16_t SaturateToInt16(float value) {
+  if (value >= 32767.0f) {
+    return 32767;
+  } else if (value <= -32768.0f) {
+    return -32768;
+  }
+  return (int16_t)lroundf(value);
+}
+
+}  // namespace
+
+/**
+ * @brief Packs a sample into fixed-point form.
+ *
+ * Values outside the range of a field are saturated, and heading is
+ * wrapped into [0..360) degrees.
+ *
+ * @param sample The full-precision sample.
+ * @param packed Receives the packed sample.
+ */
+void EncodeOrientationSample(const OrientationSample& sample,
+                             PackedOrientationSample* packed) {
+  long yaw = lroundf(sample.yaw * kCentiDegPerRad) % 36000;
+  packed->yaw_cdeg = (uint16_t)((yaw < 0) ? yaw + 36000 : yaw);
+  packed->pitch_cdeg = SaturateToInt16(sample.pitch * kCentiDegPerRad);
+  packed->roll_cdeg = SaturateToInt16(sample.roll * kCentiDegPerRad);
+  packed->rate_of_turn_cdeg_s =
+      SaturateToInt16(sample.rate_of_turn * kCentiDegPerRad);
+  packed->rate_of_pitch_cdeg_s =
+      SaturateToInt16(sample.rate_of_pitch * kCentiDegPerRad);
+  packed->rate_of_roll_cdeg_s =
+      SaturateToInt16(sample.rate_of_roll * kCentiDegPerRad);
+  packed->accel_x_mg = SaturateToInt16(sample.accel_x * kMilliGPerMPerSS);
+  packed->accel_y_mg = SaturateToInt16(sample.accel_y * kMilliGPerMPerSS);
+  packed->accel_z_mg = SaturateToInt16(sample.accel_z * kMilliGPerMPerSS);
+  float dt_ms = sample.dt * 1000.0f;
+  packed->dt_ms = (dt_ms >= 255.0f) ? 255
+                  : (dt_ms <= 0.0f) ? 0
+                                    : (uint8_t)lroundf(dt_ms);
+  packed->flags = sample.is_data_valid ? kSampleFlagValid : 0;
+}  // end EncodeOrientationSample()
+
+/**
+ * @brief Unpacks a fixed-point sample.
+ *
+ * @param packed The packed sample.
+ * @param sample Receives the sample in SI units.
+ */
+void DecodeOrientationSample(const PackedOrientationSample& packed,
+                             OrientationSample* sample) {
+  sample->is_data_valid = (packed.flags & kSampleFlagValid) != 0;
+  sample->yaw = packed.yaw_cdeg / kCentiDegPerRad;
+  sample->pitch = packed.pitch_cdeg / kCentiDegPerRad;
+  sample->roll = packed.roll_cdeg / kCentiDegPerRad;
+  sample->rate_of_turn = packed.rate_of_turn_cdeg_s / kCentiDegPerRad;
+  sample->rate_of_pitch = packed.rate_of_pitch_cdeg_s / kCentiDegPerRad;
+  sample->rate_of_roll = packed.rate_of_roll_cdeg_s / kCentiDegPerRad;
+  sample->accel_x = packed.accel_x_mg / kMilliGPerMPerSS;
+  sample->accel_y = packed.accel_y_mg / kMilliGPerMPerSS;
+  sample->accel_z = packed.accel_z_mg / kMilliGPerMPerSS;
+  sample->dt = packed.dt_ms / 1000.0f;
+}  // end DecodeOrientationSample()
+
+}  // namespace sensesp
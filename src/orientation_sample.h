@@ -0,0 +1,68 @@
+/** @file orientation_sample.h
+ *  @brief Compact fixed-point format for storing orientation samples.
+ *
+ * This file does not depend on Arduino or SensESP, so that the same
+ * encoding and decoding can be used by host-side tools, and tested on a
+ * host (see tools/orientation_sample_test.cpp).
+ */
+
+#ifndef orientation_sample_H_
+#define orientation_sample_H_
+
+#include <stdint.h>
+
+namespace sensesp {
+
+/**
+ * OrientationSample holds one full-precision orientation sample, in the
+ * same SI units as reported to Signal K.
+ */
+struct OrientationSample {
+  bool is_data_valid;   ///< whether the fusion result was valid
+  float yaw;            ///< compass heading in radians [0..2Pi)
+  float pitch;          ///< pitch in radians, bow up is positive
+  float roll;           ///< roll in radians, starboard down is positive
+  float rate_of_turn;   ///< rate of change of heading, in rad/s
+  float rate_of_pitch;  ///< rate of change of pitch, in rad/s
+  float rate_of_roll;   ///< rate of change of roll, in rad/s
+  float accel_x;        ///< acceleration stern-to-bow, in m/s^2
+  float accel_y;        ///< acceleration starboard-to-port, in m/s^2
+  float accel_z;        ///< acceleration down-to-up, in m/s^2
+  float dt;             ///< time since previous sample, in s
+};
+
+/**
+ * PackedOrientationSample holds an OrientationSample in 20 bytes rather
+ * than 44, with resolution matched to what the sensor can deliver:
+ * angles in 0.01 degree, rates in 0.01 degree/s (range +/-327 degree/s),
+ * and acceleration in milli-g (range +/-32 g). The time since the
+ * previous sample is in whole milliseconds, saturating at 255 ms.
+ * All fields are little-endian when stored or sent by the ESP32.
+ */
+struct PackedOrientationSample {
+  uint16_t yaw_cdeg;             ///< heading in 0.01 degree [0..35999]
+  int16_t pitch_cdeg;            ///< pitch in 0.01 degree
+  int16_t roll_cdeg;             ///< roll in 0.01 degree
+  int16_t rate_of_turn_cdeg_s;   ///< turn rate in 0.01 degree/s
+  int16_t rate_of_pitch_cdeg_s;  ///< pitch rate in 0.01 degree/s
+  int16_t rate_of_roll_cdeg_s;   ///< roll rate in 0.01 degree/s
+  int16_t accel_x_mg;            ///< acceleration stern-to-bow in milli-g
+  int16_t accel_y_mg;            ///< acceleration starboard-to-port in milli-g
+  int16_t accel_z_mg;            ///< acceleration down-to-up in milli-g
+  uint8_t dt_ms;                 ///< ms since previous sample, max 255
+  uint8_t flags;                 ///< bit 0 set if data are valid
+};
+
+static_assert(sizeof(PackedOrientationSample) == 20,
+              "PackedOrientationSample must have no padding");
+
+const uint8_t kSampleFlagValid = 0x01;  ///< PackedOrientationSample::flags
+
+void EncodeOrientationSample(const OrientationSample& sample,
+                             PackedOrientationSample* packed);
+void DecodeOrientationSample(const PackedOrientationSample& packed,
+                             OrientationSample* sample);
+
+}  // namespace sensesp
+
+#endif  // orientation_sample_H_
@@ -4,6 +4,11 @@
 
 #include "orientation_sensor.h"
 
+#include <sys/time.h>
+
+#include "boot_profiler.h"
+#include "config_schema.h"
+#include "magnetic_disturbance_detector.h"
 #include "sensesp.h"
 
 namespace sensesp {
@@ -20,7 +25,10 @@ namespace sensesp {
  */
 OrientationSensor::OrientationSensor(uint8_t pin_i2c_sda, uint8_t pin_i2c_scl,
                                      uint8_t accel_mag_i2c_addr,
-                                     uint8_t gyro_i2c_addr) {
+                                     uint8_t gyro_i2c_addr)
+    : fusion_epoch_{0, 0, 0},
+      disturbance_detector_{NULL},
+      is_fusion_suspended_{false} {
   sensor_interface_ = new SensorFusion();  // create our fusion engine instance
 
   bool success;
@@ -41,6 +49,7 @@ OrientationSensor::OrientationSensor(uint8_t pin_i2c_sda, uint8_t pin_i2c_scl,
     debugE("Trouble installing sensors.");
   } else {
     sensor_interface_->Begin(pin_i2c_sda, pin_i2c_scl);
+    BootProfiler::Mark(kBootSensorInstalled);
     debugI("Sensors connected & Fusion ready");
 
     // The Fusion Library, in build.h, defines how fast the ICs generate new
@@ -57,13 +66,128 @@ OrientationSensor::OrientationSensor(uint8_t pin_i2c_sda, uint8_t pin_i2c_scl,
 
 /**
  * @brief Read the Sensors and calculate orientation parameters
+ *
+ * The time of reading is recorded in fusion_epoch_ so that values derived
+ * from this fusion run can be stamped with when they were measured.
  */
 void OrientationSensor::ReadAndProcessSensors(void) {
+  if (is_fusion_suspended_) {
+    return;  // e.g. a VibrationMonitor has the accelerometer
+  }
+  // Wall-clock time earlier than this means the clock hasn't been set yet
+  // (e.g. by NTP), so the epoch gets no wall-clock time.
+  const time_t kEarliestValidTime = 1577836800;  // 2020-01-01T00:00:00Z
+  struct timeval now;
+  fusion_epoch_.monotonic_us = micros();
+  gettimeofday(&now, NULL);
+  if (now.tv_sec >= kEarliestValidTime) {
+    fusion_epoch_.sk_time_ms =
+        (uint64_t)now.tv_sec * 1000 + (uint64_t)(now.tv_usec / 1000);
+  } else {
+    fusion_epoch_.sk_time_ms = 0;
+  }
+  fusion_epoch_.sequence++;
   sensor_interface_->ReadSensors();
   sensor_interface_->RunFusion();
+  BootProfiler::Mark(kBootFirstFusion);
+  if (sensor_interface_->IsDataValid()) {
+    BootProfiler::Mark(kBootHeadingValid);
+  }
+  if (disturbance_detector_) {
+    disturbance_detector_->Update(fusion_epoch_);  // before any observer
+  }
+  notify();  // let observers see every fusion result
 
 }  // end ReadAndProcessSensors()
 
+/**
+ * @brief Fills a sample with the results of the most recent fusion run.
+ *
+ * The dt member is set to 0, since the time from the previous sample
+ * depends on what the caller is sampling for.
+ *
+ * @param sample The sample to be filled.
+ */
+void OrientationSensor::GetOrientationSample(OrientationSample* sample) {
+  sample->is_data_valid = sensor_interface_->IsDataValid();
+  sample->yaw = GetHeadingRadians();
+  sample->pitch = sensor_interface_->GetPitchRadians();
+  sample->roll = sensor_interface_->GetRollRadians();
+  sample->rate_of_turn = sensor_interface_->GetTurnRateRadPerS();
+  sample->rate_of_pitch = sensor_interface_->GetPitchRateRadPerS();
+  sample->rate_of_roll = sensor_interface_->GetRollRateRadPerS();
+  sample->accel_x = sensor_interface_->GetAccelXMPerSS();
+  sample->accel_y = sensor_interface_->GetAccelYMPerSS();
+  sample->accel_z = sensor_interface_->GetAccelZMPerSS();
+  sample->dt = 0.0;
+}  // end GetOrientationSample()
+
+/**
+ * @brief Gives the heading from the most recent fusion run.
+ *
+ * While a MagneticDisturbanceDetector finds the magnetic field
+ * disturbed, this is its gyro-propagated heading rather than the fusion
+ * library's, which is being pulled off by the disturbance.
+ *
+ * @return Heading, in radians.
+ */
+float OrientationSensor::GetHeadingRadians(void) const {
+  if (IsMagneticallyDisturbed()) {
+    return disturbance_detector_->get_heading();
+  }
+  return sensor_interface_->GetHeadingRadians();
+}  // end GetHeadingRadians()
+
+/**
+ * @brief Estimates the uncertainty of the heading from GetHeadingRadians().
+ *
+ * The fusion library doesn't expose its filter covariance, so this is
+ * built from what it does expose, combined as independent errors:
+ * - the magnetic noise: the departure of readings from the calibrated
+ *   field (square root of the noise covariance) as a fraction of the
+ *   field's horizontal component, which is what heading is taken from;
+ * - the calibration's fit error, as a fraction; and
+ * - a floor for the sensor's residual error.
+ * While the field is disturbed the magnetometer isn't used, so the noise
+ * term is replaced by the gyro drift accumulated since the disturbance
+ * began.
+ *
+ * @return Estimated 1-sigma heading error, in radians, at most Pi.
+ */
+float OrientationSensor::GetHeadingUncertaintyRadians(void) const {
+  const float kFloor = 0.5 * DEG_TO_RAD;  // sensor's best heading accuracy
+  const float kGyroDrift = 0.05 * DEG_TO_RAD;  // per second, after fusion's
+                                               // bias estimate
+  float fit = sensor_interface_->GetMagneticFitError() / 100.0;
+  float variance = kFloor * kFloor + fit * fit;
+  if (IsMagneticallyDisturbed()) {
+    float seconds = (fusion_epoch_.monotonic_us -
+                     disturbance_detector_->get_disturbed_since_us()) *
+                    1e-6;
+    float drift = kGyroDrift * seconds;
+    variance += drift * drift;
+  } else {
+    float horizontal = sensor_interface_->GetMagneticBMag() *
+                       cosf(sensor_interface_->GetMagneticInclinationRad());
+    float covariance = sensor_interface_->GetMagneticNoiseCovariance();
+    if (horizontal <= 0.0) {
+      return PI;  // no calibrated field yet
+    }
+    float noise = sqrtf(covariance > 0.0 ? covariance : 0.0) / horizontal;
+    variance += noise * noise;
+  }
+  float sigma = sqrtf(variance);
+  return sigma < PI ? sigma : PI;
+}  // end GetHeadingUncertaintyRadians()
+
+/**
+ * @brief Returns true if a MagneticDisturbanceDetector finds the
+ * magnetic field disturbed.
+ */
+bool OrientationSensor::IsMagneticallyDisturbed(void) const {
+  return disturbance_detector_ && disturbance_detector_->is_disturbed();
+}  // end IsMagneticallyDisturbed()
+
 /**
  * @brief Constructor sets up the frequency of output and the Signal K path.
  *
@@ -76,7 +200,9 @@ AttitudeValues::AttitudeValues(OrientationSensor* orientation_sensor,
                                uint report_interval_ms, String config_path)
     : Sensor(config_path),
       orientation_sensor_{orientation_sensor},
-      report_interval_ms_{report_interval_ms} {
+      report_interval_ms_{report_interval_ms},
+      scheduler_{orientation_sensor} {
+  HEAP_COUNTER_NAME(heap_counter_, "AttitudeValues");
   load_configuration();
   save_mag_cal_ = 0;
 }  // end AttitudeValues()
@@ -88,7 +214,7 @@ AttitudeValues::AttitudeValues(OrientationSensor* orientation_sensor,
  * automatically called when the SensESP app starts.
  */
 void AttitudeValues::start() {
-  ReactESP::app->onRepeat(report_interval_ms_, [this]() { this->Update(); });
+  scheduler_.Start(report_interval_ms_, [this]() { this->Update(); });
 }
 
 /**
@@ -98,10 +224,12 @@ void AttitudeValues::start() {
  * and assigned to the output variable that passes data from Producers
  * to Consumers. Consumers of the attitude data are then informed
  * by the call to notify(). If data are not valid (e.g. sensor not
- * functioning), a struct member is set to false so when the Signal K
- * message contents are assembled by as_signalk(),they can reflect that. 
+ * functioning, or fusion suspended so the result is stale), a struct
+ * member is set to false so when the Signal K message contents are
+ * assembled by as_signalk(),they can reflect that.
  */
 void AttitudeValues::Update() {
+  HEAP_SCOPE(heap_counter_);
   //check whether magnetic calibration has been requested to be saved or deleted
   if( 1 == save_mag_cal_ ) {
     orientation_sensor_->sensor_interface_->InjectCommand("SVMC");
@@ -110,12 +238,14 @@ void AttitudeValues::Update() {
   }
   save_mag_cal_ = 0;  // set flag back to zero so we don't repeat save/delete
   attitude_.is_data_valid =
-      orientation_sensor_->sensor_interface_->IsDataValid();
-  attitude_.yaw = orientation_sensor_->sensor_interface_->GetHeadingRadians();
+      orientation_sensor_->sensor_interface_->IsDataValid() &&
+      !orientation_sensor_->IsFusionSuspended();
+  attitude_.yaw = orientation_sensor_->GetHeadingRadians();
   attitude_.roll =
       orientation_sensor_->sensor_interface_->GetRollRadians();
   attitude_.pitch =
       orientation_sensor_->sensor_interface_->GetPitchRadians();
+  attitude_.epoch = orientation_sensor_->GetFusionEpoch();
 
   output = attitude_;
   notify();
@@ -128,21 +258,12 @@ void AttitudeValues::Update() {
  * (OrientationValues objects) and the attitude parameter producers
  * (AttitudeValues objects).
  */
-static const char SCHEMA[] PROGMEM = R"###({
-    "type": "object",
-    "properties": {
-        "report_interval": { 
-          "title": "Report Interval", 
-          "type": "number", 
-          "description": "Milliseconds between outputs of this parameter" 
-        },
-        "save_mag_cal": { 
-          "title": "Save Magnetic Cal", 
-          "type": "number", 
-          "description": "Set to 1 to save current magnetic calibration" 
-        }
-    }
-  })###";
+static const char SCHEMA[] PROGMEM =
+    SCHEMA_OBJECT(SCHEMA_REPORT_INTERVAL ", " SCHEMA_SAVE_MAG_CAL);
+
+/// Keys that a configuration of AttitudeValues or OrientationValues holds
+static const char* const kConfigKeys[] = {CONFIG_KEY_REPORT_INTERVAL,
+                                          CONFIG_KEY_SAVE_MAG_CAL};
 
 /**
  * @brief Get the current sensor configuration and place it in a JSON
@@ -152,8 +273,8 @@ static const char SCHEMA[] PROGMEM = R"###({
  * to be updated.
  */
 void AttitudeValues::get_configuration(JsonObject& doc) {
-  doc["report_interval"] = report_interval_ms_;
-  doc["save_mag_cal"] = save_mag_cal_;
+  doc[CONFIG_KEY_REPORT_INTERVAL] = report_interval_ms_;
+  doc[CONFIG_KEY_SAVE_MAG_CAL] = save_mag_cal_;
 }  // end get_configuration()
 
 /**
@@ -170,14 +291,12 @@ String AttitudeValues::get_config_schema() { return FPSTR(SCHEMA); }
  * @return True if successful; False if a parameter could not be found.
  */
 bool AttitudeValues::set_configuration(const JsonObject& config) {
-  String expected[] = {"report_interval", "save_mag_cal"};
-  for (auto str : expected) {
-    if (!config.containsKey(str)) {
-      return false;
-    }
+  if (!ContainsAllKeys(config, kConfigKeys)) {
+    return false;
   }
-  report_interval_ms_ = config["report_interval"];
-  save_mag_cal_ = config["save_mag_cal"];
+  report_interval_ms_ = config[CONFIG_KEY_REPORT_INTERVAL];
+  scheduler_.SetInterval(report_interval_ms_);  // re-arms if running
+  save_mag_cal_ = config[CONFIG_KEY_SAVE_MAG_CAL];
   return true;
 }  // end set_configuration()
 
@@ -193,7 +312,9 @@ MagCalValues::MagCalValues(OrientationSensor* orientation_sensor,
                                uint report_interval_ms, String config_path)
     : Sensor(config_path),
       orientation_sensor_{orientation_sensor},
-      report_interval_ms_{report_interval_ms} {
+      report_interval_ms_{report_interval_ms},
+      scheduler_{orientation_sensor} {
+  HEAP_COUNTER_NAME(heap_counter_, "MagCalValues");
   load_configuration();
 }  // end MagCalValues()
 
@@ -204,7 +325,7 @@ MagCalValues::MagCalValues(OrientationSensor* orientation_sensor,
  * automatically called when the SensESP app starts.
  */
 void MagCalValues::start() {
-  ReactESP::app->onRepeat(report_interval_ms_, [this]() { this->Update(); });
+  scheduler_.Start(report_interval_ms_, [this]() { this->Update(); });
 }
 
 /**
@@ -218,6 +339,7 @@ void MagCalValues::start() {
  * message contents are assembled by as_signalk(),they can reflect that. 
  */
 void MagCalValues::Update() {
+  HEAP_SCOPE(heap_counter_);
   mag_cal_.is_data_valid =
       orientation_sensor_->sensor_interface_->IsDataValid();
   mag_cal_.cal_fit_error = orientation_sensor_->sensor_interface_->GetMagneticFitError() / 100.0;
@@ -227,6 +349,7 @@ void MagCalValues::Update() {
   mag_cal_.mag_noise_covariance = orientation_sensor_->sensor_interface_->GetMagneticNoiseCovariance();
   mag_cal_.mag_solver = orientation_sensor_->sensor_interface_->GetMagneticCalSolver();
   mag_cal_.magnetic_inclination = orientation_sensor_->sensor_interface_->GetMagneticInclinationRad();
+  mag_cal_.epoch = orientation_sensor_->GetFusionEpoch();
 
   output = mag_cal_;
   notify();
@@ -236,16 +359,11 @@ void MagCalValues::Update() {
  * @brief Define the format for the MagCal value producer.
  *
  */
-static const char SCHEMA_MAGCAL[] PROGMEM = R"###({
-    "type": "object",
-    "properties": {
-        "report_interval": { 
-          "title": "Report Interval", 
-          "type": "number", 
-          "description": "Milliseconds between outputs of this parameter" 
-        }
-    }
-  })###";
+static const char SCHEMA_MAGCAL[] PROGMEM =
+    SCHEMA_OBJECT(SCHEMA_REPORT_INTERVAL);
+
+/// Keys that a configuration of MagCalValues holds
+static const char* const kConfigKeysMagCal[] = {CONFIG_KEY_REPORT_INTERVAL};
 
 /**
  * @brief Get the current sensor configuration and place it in a JSON
@@ -255,7 +373,7 @@ static const char SCHEMA_MAGCAL[] PROGMEM = R"###({
  * to be updated.
  */
 void MagCalValues::get_configuration(JsonObject& doc) {
-  doc["report_interval"] = report_interval_ms_;
+  doc[CONFIG_KEY_REPORT_INTERVAL] = report_interval_ms_;
 }  // end get_configuration()
 
 /**
@@ -272,13 +390,11 @@ String MagCalValues::get_config_schema() { return FPSTR(SCHEMA_MAGCAL); }
  * @return True if successful; False if a parameter could not be found.
  */
 bool MagCalValues::set_configuration(const JsonObject& config) {
-  String expected[] = {"report_interval"};
-  for (auto str : expected) {
-    if (!config.containsKey(str)) {
-      return false;
-    }
+  if (!ContainsAllKeys(config, kConfigKeysMagCal)) {
+    return false;
   }
-  report_interval_ms_ = config["report_interval"];
+  report_interval_ms_ = config[CONFIG_KEY_REPORT_INTERVAL];
+  scheduler_.SetInterval(report_interval_ms_);  // re-arms if running
   return true;
 }  // end set_configuration()
 
@@ -298,7 +414,10 @@ OrientationValues::OrientationValues(OrientationSensor* orientation_sensor,
     : FloatSensor(config_path),
       orientation_sensor_{orientation_sensor},
       value_type_{val_type},
-      report_interval_ms_{report_interval_ms} {
+      report_interval_ms_{report_interval_ms},
+      scheduler_{orientation_sensor} {
+  HEAP_COUNTER_NAME(heap_counter_,
+                    (String("OrientationValues ") + val_type).c_str());
   load_configuration();
   save_mag_cal_ = 0;
 
@@ -311,7 +430,7 @@ OrientationValues::OrientationValues(OrientationSensor* orientation_sensor,
  * automatically called when the SensESP app starts.
  */
 void OrientationValues::start() {
-  ReactESP::app->onRepeat(report_interval_ms_, [this]() { this->Update(); });
+  scheduler_.Start(report_interval_ms_, [this]() { this->Update(); });
 }
 
 /**
@@ -324,6 +443,7 @@ void OrientationValues::start() {
  * by the call to notify()
  */
 void OrientationValues::Update() {
+  HEAP_SCOPE(heap_counter_);
   //check whether magnetic calibration has been requested to be saved or deleted
   if( 1 == save_mag_cal_ ) {
     orientation_sensor_->sensor_interface_->InjectCommand("SVMC");
@@ -332,103 +452,127 @@ void OrientationValues::Update() {
   }
   save_mag_cal_ = 0;  // set flag back to zero so we don't repeat save/delete
   //check which type of parameter is requested, and pass it on
-  switch (value_type_) {
+  if (!GetValue(orientation_sensor_, value_type_, &output)) {
+    return; //skip the notify(), due to unrecognized value type
+  }
+  if (orientation_sensor_->sensor_interface_->IsDataValid() &&
+      !orientation_sensor_->IsFusionSuspended()) {
+    notify();  // only pass on the data if it is valid and fresh
+  }
+}  // end Update()
+
+/**
+ * @brief Get the current sensor configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void OrientationValues::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_REPORT_INTERVAL] = report_interval_ms_;
+  doc[CONFIG_KEY_SAVE_MAG_CAL] = save_mag_cal_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String OrientationValues::get_config_schema() { return FPSTR(SCHEMA); }
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found.
+ */
+bool OrientationValues::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeys)) {
+    return false;
+  }
+  report_interval_ms_ = config[CONFIG_KEY_REPORT_INTERVAL];
+  scheduler_.SetInterval(report_interval_ms_);  // re-arms if running
+  save_mag_cal_ = config[CONFIG_KEY_SAVE_MAG_CAL];
+  return true;
+}
+
+
+/**
+ * @brief Reads one orientation parameter from the sensor fusion library.
+ *
+ * Shared by OrientationValues and OrientationOutputs so that both
+ * report the same parameters in the same units.
+ *
+ * @param orientation_sensor The sensor whose fusion results are read
+ * @param value_type The type of orientation parameter to be read
+ * @param value Receives the parameter's current value
+ * @return True if successful; False if value_type is not recognized.
+ */
+bool OrientationValues::GetValue(OrientationSensor* orientation_sensor,
+                                 OrientationValType value_type,
+                                 float* value) {
+  SensorFusion* fusion = orientation_sensor->sensor_interface_;
+  switch (value_type) {
     case (kCompassHeading):
-      output = orientation_sensor_->sensor_interface_->GetHeadingRadians();
+      *value = orientation_sensor->GetHeadingRadians();
       break;
     case (kRoll):
-      output = orientation_sensor_->sensor_interface_->GetRollRadians();
+      *value = fusion->GetRollRadians();
       break;
     case (kPitch):
-      output = orientation_sensor_->sensor_interface_->GetPitchRadians();
+      *value = fusion->GetPitchRadians();
       break;
     case (kAccelerationX):
-      output = orientation_sensor_->sensor_interface_->GetAccelXMPerSS();
+      *value = fusion->GetAccelXMPerSS();
       break;
     case (kAccelerationY):
-      output = orientation_sensor_->sensor_interface_->GetAccelYMPerSS();
+      *value = fusion->GetAccelYMPerSS();
       break;
     case (kAccelerationZ):
-      output = orientation_sensor_->sensor_interface_->GetAccelZMPerSS();
+      *value = fusion->GetAccelZMPerSS();
       break;
     case (kRateOfTurn):
-      output = orientation_sensor_->sensor_interface_->GetTurnRateRadPerS();
+      *value = fusion->GetTurnRateRadPerS();
       break;
     case (kRateOfPitch):
-      output = orientation_sensor_->sensor_interface_->GetPitchRateRadPerS();
+      *value = fusion->GetPitchRateRadPerS();
       break;
     case (kRateOfRoll):
-      output = orientation_sensor_->sensor_interface_->GetRollRateRadPerS();
+      *value = fusion->GetRollRateRadPerS();
       break;
     case (kTemperature):
-      output = orientation_sensor_->sensor_interface_->GetTemperatureK();
+      *value = fusion->GetTemperatureK();
       break;
     case (kMagCalFitInUse):
-      output = orientation_sensor_->sensor_interface_->GetMagneticFitError();
+      *value = fusion->GetMagneticFitError();
       break;
     case (kMagCalFitTrial):
-      output = orientation_sensor_->sensor_interface_->GetMagneticFitErrorTrial();
+      *value = fusion->GetMagneticFitErrorTrial();
       break;
     case (kMagCalAlgorithmSolver):
-      output = orientation_sensor_->sensor_interface_->GetMagneticCalSolver();
+      *value = fusion->GetMagneticCalSolver();
       break;
     case (kMagInclination):
-      output = orientation_sensor_->sensor_interface_->GetMagneticInclinationRad();
+      *value = fusion->GetMagneticInclinationRad();
       break;
     case (kMagFieldMagnitude):
       //TODO report in T rather than uT, however need widget to be able to display
-      output = orientation_sensor_->sensor_interface_->GetMagneticBMag();
+      *value = fusion->GetMagneticBMag();
       break;
     case (kMagFieldMagnitudeTrial):
       //TODO report in T rather than uT, however need widget to be able to display
-      output = orientation_sensor_->sensor_interface_->GetMagneticBMagTrial();
+      *value = fusion->GetMagneticBMagTrial();
       break;
     case (kMagNoiseCovariance):
-      output = orientation_sensor_->sensor_interface_->GetMagneticNoiseCovariance();
+      *value = fusion->GetMagneticNoiseCovariance();
+      break;
+    case (kHeadingUncertainty):
+      *value = orientation_sensor->GetHeadingUncertaintyRadians();
       break;
     default:
-      return; //skip the notify(), due to unrecognized value type
-  }
-  if (orientation_sensor_->sensor_interface_->IsDataValid()) {
-    notify();  // only pass on the data if it is valid
-  }
-}  // end Update()
-
-/**
- * @brief Get the current sensor configuration and place it in a JSON
- * object that can then be stored in non-volatile memory.
- *
- * @param doc JSON object to contain the configuration parameters
- * to be updated.
- */
-void OrientationValues::get_configuration(JsonObject& doc) {
-  doc["report_interval"] = report_interval_ms_;
-  doc["save_mag_cal"] = save_mag_cal_;
-}  // end get_configuration()
-
-/**
- * @brief Fetch the JSON format used for holding the configuration.
- */
-String OrientationValues::get_config_schema() { return FPSTR(SCHEMA); }
-
-/**
- * @brief Use the values stored in JSON object config to update
- * the appropriate member variables.
- *
- * @param config JSON object containing the configuration parameters
- * to be updated.
- * @return True if successful; False if a parameter could not be found.
- */
-bool OrientationValues::set_configuration(const JsonObject& config) {
-  String expected[] = {"report_interval", "save_mag_cal"};
-  for (auto str : expected) {
-    if (!config.containsKey(str)) {
       return false;
-    }
   }
-  report_interval_ms_ = config["report_interval"];
-  save_mag_cal_ = config["save_mag_cal"];
   return true;
-}
+}  // end GetValue()
 
-} //namespace sensesp
\ No newline at end of file
+} //namespace sensesp
@@ -10,10 +10,18 @@
 
 #include "sensor_fusion_class.h"  // for OrientationSensorFusion-ESP library
 
+#include "heap_telemetry.h"
+#include "latency_monitor.h"
+#include "orientation_sample.h"
+#include "report_scheduler.h"
 #include "sensesp/sensors/sensor.h"
+#include "sensesp/system/observable.h"
 #include "signalk_orientation.h"
 
 namespace sensesp {
+
+class MagneticDisturbanceDetector;
+
 /**
  * @brief OrientationSensor represents a 9-Degrees-of-Freedom sensor
  * (magnetometer, accelerometer, and gyroscope).
@@ -31,15 +39,38 @@ namespace sensesp {
  * orientation_sensor->sensor_interface_->GetOrientationQuaternion();
  * The OrientationSensorFusion-ESP library has details:
  * @see https://github.com/BjarneBitscrambler/OrientationSensorFusion-ESP.git
+ *
+ * Observers attached with attach() are notified after every fusion run,
+ * for classes that need each fusion result rather than periodic samples.
   */
-class OrientationSensor {
+class OrientationSensor : public Observable {
  public:
   OrientationSensor(uint8_t pin_i2c_sda, uint8_t pin_i2c_scl,
                     uint8_t accel_mag_i2c_addr, uint8_t gyro_i2c_addr);
   SensorFusion* sensor_interface_;  ///< sensor's Fusion Library interface
 
+  /// Returns the epoch of the most recent fusion run
+  const FusionEpoch& GetFusionEpoch(void) const { return fusion_epoch_; }
+  void GetOrientationSample(OrientationSample* sample);
+  /// Sets the detector of magnetic disturbances, or NULL for none
+  void set_disturbance_detector(MagneticDisturbanceDetector* detector) {
+    disturbance_detector_ = detector;
+  }
+  /// Pauses or resumes fusion runs, while the sensor ICs are lent out
+  void set_fusion_suspended(bool is_suspended) {
+    is_fusion_suspended_ = is_suspended;
+  }
+  /// Returns true while fusion runs are skipped, so results are stale
+  bool IsFusionSuspended(void) const { return is_fusion_suspended_; }
+  float GetHeadingRadians(void) const;
+  float GetHeadingUncertaintyRadians(void) const;
+  bool IsMagneticallyDisturbed(void) const;
+
  private:
   void ReadAndProcessSensors(void);  ///< reads sensor and runs fusion algorithm
+  FusionEpoch fusion_epoch_;  ///< timestamp and sequence of latest fusion run
+  MagneticDisturbanceDetector* disturbance_detector_;  ///< optional, or NULL
+  bool is_fusion_suspended_;  ///< true while fusion runs are skipped
 };
 
 /**
@@ -65,6 +96,8 @@ class AttitudeValues : public AttitudeProducer, public sensesp::Sensor {
   Attitude attitude_;  ///< struct storing the current yaw,pitch,roll values
   uint report_interval_ms_;  ///< interval between attitude updates to Signal K
   int8_t save_mag_cal_;      ///< Flag for saving current magnetic calibration
+  ReportScheduler scheduler_;  ///< runs Update() every report_interval_ms_
+  HEAP_COUNTER(heap_counter_)  ///< allocations made by Update()
 
 };  // end class AttitudeValues
 
@@ -92,6 +125,8 @@ class MagCalValues : public MagCalProducer, public sensesp::Sensor {
   virtual String get_config_schema() override;
   MagCal mag_cal_;  ///< struct storing the current magnetic calibration parameters
   uint report_interval_ms_;  ///< interval between attitude updates to Signal K
+  ReportScheduler scheduler_;  ///< runs Update() every report_interval_ms_
+  HEAP_COUNTER(heap_counter_)  ///< allocations made by Update()
 
 };  // end class MagCalValues
 
@@ -126,7 +161,8 @@ class OrientationValues : public FloatSensor {
     kMagInclination,      ///< geomagnetic inclination based on current readings
     kMagFieldMagnitude,   ///< geomagnetic magnitude of current calibration
     kMagFieldMagnitudeTrial,  ///< geomagnetic magnitude based on current readings
-    kMagNoiseCovariance   ///< deviation of current reading from calibrated geomag sphere
+    kMagNoiseCovariance,  ///< deviation of current reading from calibrated geomag sphere
+    kHeadingUncertainty   ///< estimated 1-sigma error of compass heading
   };
   OrientationValues(OrientationSensor* orientation_sensor,
                     OrientationValType value_type = kCompassHeading,
@@ -135,6 +171,8 @@ class OrientationValues : public FloatSensor {
   void start() override final;  ///< starts periodic outputs of Attitude
   OrientationSensor*
       orientation_sensor_;  ///< Pointer to the orientation sensor
+  static bool GetValue(OrientationSensor* orientation_sensor,
+                       OrientationValType value_type, float* value);
 
  private:
   void Update(
@@ -146,6 +184,8 @@ class OrientationValues : public FloatSensor {
       value_type_;  ///< Particular type of orientation parameter supplied
   uint report_interval_ms_;  ///< Interval between data outputs via Signal K
   int8_t save_mag_cal_;      ///< Flag for saving current magnetic calibration
+  ReportScheduler scheduler_;  ///< runs Update() every report_interval_ms_
+  HEAP_COUNTER(heap_counter_)  ///< allocations made by Update()
 
 };  // end class OrientationValues
 
@@ -0,0 +1,130 @@
+/** @file report_scheduler.cpp
+ *  @brief Periodic report timer that can be re-armed at a new interval.
+ */
+
+#include "report_scheduler.h"
+
+#include "orientation_sensor.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+std::vector<ReportScheduler*> ReportScheduler::schedulers_;
+volatile bool ReportScheduler::is_any_pending_ = false;
+
+/**
+ * @brief Constructor.
+ *
+ * @param orientation_sensor Sensor whose fusion runs the reports are
+ * aligned with, or NULL for no alignment.
+ */
+ReportScheduler::ReportScheduler(OrientationSensor* orientation_sensor)
+    : orientation_sensor_{orientation_sensor},
+      repeat_{NULL},
+      delay_{NULL},
+      interval_ms_{0},
+      pending_interval_ms_{0},
+      is_pending_{false},
+      is_started_{false},
+      start_us_{0} {}
+
+/**
+ * @brief Starts periodic calls of callback. Call once, from start().
+ *
+ * @param interval_ms Interval between calls. If SetInterval() has been
+ * called already (e.g. by a configuration loaded in the constructor),
+ * that interval is used instead.
+ * @param callback Function called for each report.
+ */
+void ReportScheduler::Start(uint interval_ms,
+                            std::function<void()> callback) {
+  if (is_started_) {
+    return;
+  }
+  is_started_ = true;
+  callback_ = callback;
+  interval_ms_ = is_pending_ ? pending_interval_ms_ : interval_ms;
+  is_pending_ = false;
+  if (schedulers_.empty()) {
+    ReactESP::app->onTick(
+        []() { ReportScheduler::ApplyPendingIntervals(); });
+  }
+  schedulers_.push_back(this);
+  Arm();
+}  // end Start()
+
+/**
+ * @brief Changes the interval between reports.
+ *
+ * May be called from any task, e.g. from set_configuration(). Takes
+ * effect on the next pass of the main loop, or at Start() if not yet
+ * started.
+ *
+ * @param interval_ms New interval between reports.
+ */
+void ReportScheduler::SetInterval(uint interval_ms) {
+  if (0 == interval_ms) {
+    return;
+  }
+  pending_interval_ms_ = interval_ms;
+  is_pending_ = true;
+  is_any_pending_ = true;
+}  // end SetInterval()
+
+/**
+ * @brief Removes the current reaction, if any, and arms a new one at
+ * interval_ms_.
+ *
+ * The first report is delayed until 1 ms after the next fusion run is
+ * due, when aligning to a sensor whose fusion has started.
+ */
+void ReportScheduler::Arm(void) {
+  if (repeat_ != NULL) {
+    repeat_->remove();
+    repeat_ = NULL;
+  }
+  if (delay_ != NULL) {
+    delay_->remove();
+    delay_ = NULL;
+  }
+  uint32_t delay_ms = 0;
+  if (orientation_sensor_ != NULL) {
+    const FusionEpoch& epoch = orientation_sensor_->GetFusionEpoch();
+    if (epoch.sequence > 0) {
+      const uint32_t kFusionIntervalUs = 1000000 / FUSION_HZ;
+      uint32_t since_us = (micros() - epoch.monotonic_us) % kFusionIntervalUs;
+      delay_ms = (kFusionIntervalUs - since_us + 999) / 1000 + 1;
+    }
+  }
+  delay_ = ReactESP::app->onDelay(delay_ms, [this]() {
+    delay_ = NULL;  // ReactESP deletes the delay reaction once it has run
+    start_us_ = micros();
+    repeat_ = ReactESP::app->onRepeat(interval_ms_, callback_);
+    callback_();
+  });
+}  // end Arm()
+
+/**
+ * @brief Re-arms every scheduler whose interval has been changed.
+ *
+ * Runs on every pass of the main loop, but only loops through the
+ * schedulers when a change is pending.
+ */
+void ReportScheduler::ApplyPendingIntervals(void) {
+  if (!is_any_pending_) {
+    return;
+  }
+  is_any_pending_ = false;
+  for (auto scheduler : schedulers_) {
+    if (!scheduler->is_pending_) {
+      continue;
+    }
+    scheduler->is_pending_ = false;
+    if (scheduler->pending_interval_ms_ != scheduler->interval_ms_) {
+      scheduler->interval_ms_ = scheduler->pending_interval_ms_;
+      scheduler->Arm();
+    }
+  }
+}  // end ApplyPendingIntervals()
+
+}  // namespace sensesp
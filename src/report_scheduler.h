@@ -0,0 +1,64 @@
+/** @file report_scheduler.h
+ *  @brief Periodic report timer that can be re-armed at a new interval.
+ */
+
+#ifndef report_scheduler_H_
+#define report_scheduler_H_
+
+#include <functional>
+#include <vector>
+
+#include <ReactESP.h>
+
+namespace sensesp {
+
+class OrientationSensor;
+
+/**
+ * @brief ReportScheduler runs a producer's report callback periodically,
+ * and lets the interval be changed while running.
+ *
+ * Producers used to register an onRepeat() reaction once, in start(), so
+ * a report interval changed through the web UI had no effect until the
+ * next restart. SetInterval() instead removes the existing reaction and
+ * arms a new one, so there is never more than one reaction per producer.
+ *
+ * Configuration changes arrive on the web server's task, whereas
+ * reactions may only be added or removed from the main loop. So
+ * SetInterval() just records the new interval, and a single onTick()
+ * reaction shared by all schedulers applies it on the next loop pass.
+ *
+ * If given an OrientationSensor, the first report of each schedule is
+ * delayed until just after the next fusion run, so reports carry fresh
+ * fusion results rather than ones up to a fusion period old.
+ */
+class ReportScheduler {
+ public:
+  explicit ReportScheduler(OrientationSensor* orientation_sensor = NULL);
+  void Start(uint interval_ms, std::function<void()> callback);
+  void SetInterval(uint interval_ms);
+  /// Returns the interval of the current schedule, in ms
+  uint get_interval_ms(void) const { return interval_ms_; }
+  /// Returns micros() at the first report of the current schedule
+  uint32_t get_start_us(void) const { return start_us_; }
+
+ private:
+  void Arm(void);  ///< replaces any existing reaction with a new schedule
+  static void ApplyPendingIntervals(void);
+  OrientationSensor* orientation_sensor_;  ///< for alignment, or NULL
+  std::function<void()> callback_;  ///< the producer's report function
+  reactesp::RepeatReaction* repeat_;  ///< current periodic reaction, or NULL
+  reactesp::DelayReaction* delay_;    ///< pending first report, or NULL
+  uint interval_ms_;                  ///< interval of current schedule
+  volatile uint pending_interval_ms_;  ///< interval set by SetInterval()
+  volatile bool is_pending_;           ///< true if not yet applied
+  bool is_started_;                    ///< true once Start() has been called
+  uint32_t start_us_;                  ///< micros() at first report
+
+  static std::vector<ReportScheduler*> schedulers_;  ///< all started ones
+  static volatile bool is_any_pending_;  ///< true if any is_pending_
+};
+
+}  // namespace sensesp
+
+#endif  // report_scheduler_H_
@@ -0,0 +1,108 @@
+/** @file serialization_arena.cpp
+ *  @brief Bump allocator for the JSON documents built by SKOutput.
+ */
+
+#include "serialization_arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace sensesp {
+
+namespace {
+
+/// Each allocation is preceded by its size, and both are kept aligned
+const size_t kAlignment = 8;
+const size_t kHeaderSize = kAlignment;
+
+inline size_t RoundUp(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+inline size_t BlockSize(const void* ptr) {
+  size_t size;
+  memcpy(&size, (const uint8_t*)ptr - kHeaderSize, sizeof(size));
+  return size;
+}
+
+}  // namespace
+
+alignas(8) uint8_t SerializationArena::buffer_[SerializationArena::kSize];
+size_t SerializationArena::used_ = 0;
+uint16_t SerializationArena::live_count_ = 0;
+uint32_t SerializationArena::fallback_count_ = 0;
+size_t SerializationArena::high_water_mark_ = 0;
+
+bool SerializationArena::Contains(const void* ptr) {
+  return ((const uint8_t*)ptr >= buffer_) &&
+         ((const uint8_t*)ptr < buffer_ + kSize);
+}
+
+/**
+ * @brief Allocates size bytes from the arena, or from the heap if the
+ * arena is full.
+ */
+void* SerializationArena::Allocate(size_t size) {
+  size_t needed = kHeaderSize + RoundUp(size);
+  if (needed > kSize - used_) {
+    fallback_count_++;
+    return malloc(size);
+  }
+  uint8_t* block = buffer_ + used_;
+  memcpy(block, &size, sizeof(size));
+  used_ += needed;
+  live_count_++;
+  if (used_ > high_water_mark_) {
+    high_water_mark_ = used_;
+  }
+  return block + kHeaderSize;
+}  // end Allocate()
+
+/**
+ * @brief Releases an allocation. Arena memory is reclaimed all at once,
+ * when the last live allocation is released.
+ */
+void SerializationArena::Deallocate(void* ptr) {
+  if (NULL == ptr) {
+    return;
+  }
+  if (!Contains(ptr)) {
+    free(ptr);
+    return;
+  }
+  if (--live_count_ == 0) {
+    used_ = 0;
+  }
+}  // end Deallocate()
+
+/**
+ * @brief Resizes an allocation, in place if it is the most recent one
+ * in the arena and still fits.
+ */
+void* SerializationArena::Reallocate(void* ptr, size_t size) {
+  if (NULL == ptr) {
+    return Allocate(size);
+  }
+  if (!Contains(ptr)) {
+    return realloc(ptr, size);
+  }
+  size_t old_size = BlockSize(ptr);
+  size_t old_end = ((uint8_t*)ptr - buffer_) + RoundUp(old_size);
+  if ((old_end == used_) &&
+      (RoundUp(size) <= kSize - (used_ - RoundUp(old_size)))) {
+    used_ = used_ - RoundUp(old_size) + RoundUp(size);
+    memcpy((uint8_t*)ptr - kHeaderSize, &size, sizeof(size));
+    if (used_ > high_water_mark_) {
+      high_water_mark_ = used_;
+    }
+    return ptr;
+  }
+  void* moved = Allocate(size);
+  if (moved != NULL) {
+    memcpy(moved, ptr, (old_size < size) ? old_size : size);
+    Deallocate(ptr);
+  }
+  return moved;
+}  // end Reallocate()
+
+}  // namespace sensesp
@@ -0,0 +1,64 @@
+/** @file serialization_arena.h
+ *  @brief Bump allocator for the JSON documents built by SKOutput.
+ *
+ * This file does not depend on Arduino or SensESP, so that it can be
+ * benchmarked on a host (see tools/arena_benchmark.cpp).
+ */
+
+#ifndef serialization_arena_H_
+#define serialization_arena_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sensesp {
+
+/**
+ * @brief SerializationArena hands out memory for JSON documents from one
+ * static buffer, in place of a malloc()/free() pair per document.
+ *
+ * Allocation just advances a pointer, and freeing does nothing until no
+ * allocation is live, when the whole arena is rewound at once. Each
+ * as_signalk() destroys its document before returning, so the arena is
+ * rewound after every serialization and needs to hold only the largest
+ * document, not all those of an emission cycle. Requests that don't fit
+ * fall back to malloc(), and are counted.
+ *
+ * Not thread-safe: use only from the main loop.
+ */
+class SerializationArena {
+ public:
+  static const size_t kSize = 1536;  ///< bytes of arena storage
+
+  static void* Allocate(size_t size);
+  static void Deallocate(void* ptr);
+  static void* Reallocate(void* ptr, size_t size);
+  /// Returns the number of allocations that didn't fit in the arena
+  static uint32_t get_fallback_count(void) { return fallback_count_; }
+  /// Returns the most arena bytes ever in use at once
+  static size_t get_high_water_mark(void) { return high_water_mark_; }
+
+ private:
+  static bool Contains(const void* ptr);
+  static uint8_t buffer_[kSize];  ///< arena storage
+  static size_t used_;            ///< bytes handed out since last rewind
+  static uint16_t live_count_;    ///< allocations not yet deallocated
+  static uint32_t fallback_count_;  ///< allocations passed on to malloc()
+  static size_t high_water_mark_;   ///< largest value of used_
+};
+
+/**
+ * @brief ArenaAllocator adapts SerializationArena to the allocator
+ * interface of ArduinoJson's BasicJsonDocument.
+ */
+struct ArenaAllocator {
+  void* allocate(size_t size) { return SerializationArena::Allocate(size); }
+  void deallocate(void* ptr) { SerializationArena::Deallocate(ptr); }
+  void* reallocate(void* ptr, size_t size) {
+    return SerializationArena::Reallocate(ptr, size);
+  }
+};
+
+}  // namespace sensesp
+
+#endif  // serialization_arena_H_
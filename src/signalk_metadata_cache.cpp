@@ -0,0 +1,147 @@
+/** @file signalk_metadata_cache.cpp
+ *  @brief Sends Signal K path metadata once per server connection.
+ */
+
+#include "signalk_metadata_cache.h"
+
+#include "heap_telemetry.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp_app.h"
+
+namespace sensesp {
+
+char SKMetadataCache::rendered_[SKMetadataCache::kBufferSize];
+std::vector<SKMetadataCache::Entry> SKMetadataCache::entries_;
+bool SKMetadataCache::is_rendered_ = false;
+bool SKMetadataCache::is_sent_ = false;
+bool SKMetadataCache::was_connected_ = false;
+bool SKMetadataCache::is_send_scheduled_ = false;
+
+/**
+ * @brief Sets, replaces, or removes the metadata of an output.
+ *
+ * The first call connects to the websocket client's connection state,
+ * so that the metadata are sent as soon as a new connection is made.
+ *
+ * @param emitter The output whose Signal K path the metadata describe.
+ * @param meta The metadata, or NULL to remove any existing metadata.
+ */
+void SKMetadataCache::Set(SKEmitter* emitter, SKMetadata* meta) {
+  static bool is_started = false;
+  if (!is_started) {
+    // The websocket client exists once the app has been set up
+    ReactESP::app->onDelay(0, []() {
+      sensesp_app->get_ws_client()->connect_to(
+          new LambdaConsumer<SKWSConnectionState>(
+              [](SKWSConnectionState state) {
+                bool is_connected =
+                    (SKWSConnectionState::kSKWSConnected == state);
+                if (is_connected && !was_connected_) {
+                  is_sent_ = false;  // new connection: server needs them
+                  SendIfNeeded();
+                }
+                was_connected_ = is_connected;
+              }));
+    });
+    is_started = true;
+  }
+  bool is_changed = false;
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->emitter == emitter) {
+      entries_.erase(it);
+      is_changed = true;
+      break;
+    }
+  }
+  if (meta) {
+    entries_.push_back({emitter, meta});
+    is_changed = true;
+  }
+  if (is_changed) {
+    MarkChanged();
+  }
+}  // end Set()
+
+/**
+ * @brief Marks the metadata as changed, e.g. when an output's Signal K
+ * path is reconfigured, so they are rendered and sent again.
+ */
+void SKMetadataCache::MarkChanged(void) {
+  is_rendered_ = false;
+  is_sent_ = false;
+  ScheduleSend();
+}  // end MarkChanged()
+
+/**
+ * @brief Sends the metadata once the current setup or reaction is done,
+ * so that many changes in a row result in one send.
+ */
+void SKMetadataCache::ScheduleSend(void) {
+  if (is_send_scheduled_) {
+    return;
+  }
+  is_send_scheduled_ = true;
+  ReactESP::app->onDelay(0, []() {
+    is_send_scheduled_ = false;
+    SendIfNeeded();
+  });
+}  // end ScheduleSend()
+
+/**
+ * @brief Renders the metadata of some outputs into one meta delta.
+ *
+ * @param first Index in entries_ of the first output to render.
+ * @param last Index in entries_ one past the last output to render.
+ * @return True if rendered; False if the delta doesn't fit the buffer,
+ * in which case rendered_ must not be sent.
+ */
+bool SKMetadataCache::Render(size_t first, size_t last) {
+  DynamicJsonDocument json_doc(kBufferSize);
+  JsonArray updates = json_doc.createNestedArray("updates");
+  JsonArray meta = updates.createNestedObject().createNestedArray("meta");
+  for (size_t i = first; i < last; i++) {
+    entries_[i].meta->add_entry(entries_[i].emitter->get_sk_path(), meta);
+  }
+  // If insufficient memory is available, then trailing elements of
+  // JsonDoc are omitted, and the delta would be incomplete.
+  if (json_doc.overflowed()) {
+    return false;
+  }
+  return serializeJson(json_doc, rendered_, kBufferSize) < kBufferSize - 1;
+}  // end Render()
+
+/**
+ * @brief Sends the metadata if a new connection has been made, or if
+ * they have changed since they were last sent.
+ *
+ * If the metadata of all outputs don't fit in one delta, each output's
+ * are sent in a delta of their own.
+ */
+void SKMetadataCache::SendIfNeeded(void) {
+  HEAP_SCOPE_STATIC("SKMetadataCache");
+  if (!sensesp_app->get_ws_client()->is_connected() || is_sent_ ||
+      entries_.empty()) {
+    return;
+  }
+  if (!is_rendered_) {
+    is_rendered_ = Render(0, entries_.size());
+  }
+  if (is_rendered_) {
+    String delta(rendered_);
+    sensesp_app->get_ws_client()->sendTXT(delta);
+  } else {
+    debugE("Metadata exceed pre-rendered buffer size; sending per path");
+    for (size_t i = 0; i < entries_.size(); i++) {
+      if (!Render(i, i + 1)) {
+        debugE("Metadata of %s too large to send",
+               entries_[i].emitter->get_sk_path().c_str());
+        continue;
+      }
+      String delta(rendered_);
+      sensesp_app->get_ws_client()->sendTXT(delta);
+    }
+  }
+  is_sent_ = true;
+}  // end SendIfNeeded()
+
+}  // namespace sensesp
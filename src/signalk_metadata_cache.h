@@ -0,0 +1,52 @@
+/** @file signalk_metadata_cache.h
+ *  @brief Sends Signal K path metadata once per server connection.
+ */
+
+#ifndef signalk_metadata_cache_H_
+#define signalk_metadata_cache_H_
+
+#include <vector>
+
+#include "sensesp/signalk/signalk_emitter.h"
+#include "sensesp/signalk/signalk_metadata.h"
+
+namespace sensesp {
+
+/**
+ * @brief SKMetadataCache holds the metadata of all SKOutputs, pre-rendered
+ * into one Signal K meta delta, and sends it once per server connection.
+ *
+ * Metadata (units, display names, ...) are static, so there is no need to
+ * serialize them again each time the server reconnects, or to carry them
+ * in the value deltas. The delta is rendered into a static buffer the
+ * first time it is needed, and again only when an output's metadata or
+ * path changes, in which case it is also re-sent. The SKOutput classes
+ * register their metadata here, and return none to the delta queue.
+ * Metadata too large for one delta are sent as one delta per path.
+ */
+class SKMetadataCache {
+ public:
+  static void Set(SKEmitter* emitter, SKMetadata* meta);
+  static void MarkChanged(void);  ///< re-renders and re-sends metadata
+
+ private:
+  /// One output's metadata and the emitter whose path it describes
+  struct Entry {
+    SKEmitter* emitter;
+    SKMetadata* meta;
+  };
+  static bool Render(size_t first, size_t last);  ///< renders to buffer
+  static void SendIfNeeded(void);  ///< sends on connection or change
+  static void ScheduleSend(void);  ///< sends soon, once setup is done
+  static const size_t kBufferSize = 2048;
+  static char rendered_[kBufferSize];  ///< pre-rendered meta delta
+  static std::vector<Entry> entries_;  ///< registered metadata
+  static bool is_rendered_;     ///< true if rendered_ is up to date
+  static bool is_sent_;         ///< true if sent on current connection
+  static bool was_connected_;   ///< connection state at previous change
+  static bool is_send_scheduled_;  ///< true if a send is due soon
+};
+
+}  // namespace sensesp
+
+#endif  // signalk_metadata_cache_H_
@@ -8,6 +8,22 @@
 #include "sensesp/system/valueproducer.h"
 
 namespace sensesp {
+
+/**
+ * FusionEpoch identifies one run of the sensor-fusion algorithm. It is
+ * captured by OrientationSensor when the sensors are read, and copied
+ * into every snapshot derived from that fusion result. This lets the
+ * consumer know when a value was measured, rather than when it happened
+ * to be sent, so that values can be aligned and their age measured.
+ */
+struct FusionEpoch {
+  uint32_t sequence;      ///< Count of fusion runs since boot. 0 = no data yet.
+  uint32_t monotonic_us;  ///< micros() when the sensors were read. Wraps
+                          ///< after ~71 minutes; use unsigned differences.
+  uint64_t sk_time_ms;    ///< Wall-clock time (ms since Unix epoch) when the
+                          ///< sensors were read, or 0 if clock is not set.
+};
+
 /**
  * Attitude struct contains the yaw, pitch, and roll values from
  * the orientation sensor-fusion algorithm. Additionally,
@@ -26,6 +42,7 @@ struct Attitude {
                        ///< positive.
   float roll;  ///< Rotation about longitudinal axis in radians. Starboard roll
                ///< is positive.
+  FusionEpoch epoch;  ///< Fusion run from which yaw,pitch,roll were taken.
 };
 
 typedef ValueProducer<Attitude> AttitudeProducer;
@@ -55,10 +72,113 @@ struct MagCal {
                                     ///< reading  TODO check units
   int mag_solver;  ///< solver used for current magnetic calibration. Unitless,
                    ///< in set [0,4,7,10]
+  FusionEpoch epoch;  ///< Fusion run from which the values were taken.
 };
 
 typedef ValueProducer<MagCal> MagCalProducer;
 
+/**
+ * LatencyStats struct summarizes how old orientation data are when
+ * they leave the device. Two stages are measured, both starting from
+ * when the sensors were read: until the value has been serialized into
+ * a Signal K delta, and until the queued delta has been handed to the
+ * websocket for sending. Times are in seconds and cover the samples
+ * recorded since the previous report.
+ */
+struct LatencyStats {
+  bool is_data_valid;     ///< False if no samples were recorded in period.
+  uint32_t sample_count;  ///< Number of samples in the period.
+  float serialize_p50;    ///< Median sensor-to-serialization latency, in s.
+  float serialize_p99;    ///< 99th percentile sensor-to-serialization, in s.
+  float serialize_max;    ///< Maximum sensor-to-serialization latency, in s.
+  float send_p50;         ///< Median sensor-to-send latency, in s.
+  float send_p99;         ///< 99th percentile sensor-to-send latency, in s.
+  float send_max;         ///< Maximum sensor-to-send latency, in s.
+};
+
+typedef ValueProducer<LatencyStats> LatencyStatsProducer;
+
+/**
+ * HeapStats struct summarizes the state of the heap and how fast it is
+ * being allocated from. Allocation rates are only counted when built
+ * with HEAP_TELEMETRY (see heap_telemetry.h), otherwise they are zero.
+ */
+struct HeapStats {
+  uint32_t free_bytes;          ///< Total free heap, in bytes.
+  uint32_t largest_free_block;  ///< Largest allocatable block, in bytes.
+  float fragmentation;          ///< 1 - largest block / free. 0 is best.
+  float allocations_per_s;      ///< Heap allocations per second.
+  float bytes_per_s;            ///< Bytes allocated per second.
+};
+
+typedef ValueProducer<HeapStats> HeapStatsProducer;
+
+/**
+ * BootProfile struct holds when each phase of startup was reached, in
+ * seconds since power-on. Phases that weren't reached before the profile
+ * was reported are negative.
+ */
+struct BootProfile {
+  float setup_start;       ///< setup() entered.
+  float app_built;         ///< SensESP app created, filesystem mounted.
+  float sensor_installed;  ///< Orientation sensor ICs installed.
+  float state_restored;    ///< Saved fusion state restored (warm start).
+  float app_started;       ///< End of setup(): all producers configured.
+  float first_fusion;      ///< First fusion run completed.
+  float heading_valid;     ///< Fusion first reported valid orientation.
+  float wifi_connected;    ///< WiFi connected.
+  float sk_connected;      ///< Signal K server websocket connected.
+};
+
+typedef ValueProducer<BootProfile> BootProfileProducer;
+
+/// Number of frequency bands in a VibrationSpectrum
+const int kVibrationBandCount = 4;
+
+/**
+ * VibrationSpectrum struct summarizes the spectrum of one burst of
+ * accelerometer samples, taken at a high rate. Accelerations are RMS
+ * values in m/s^2 of the vector sum of the three axes, with the mean
+ * (gravity and any steady tilt) removed.
+ */
+struct VibrationSpectrum {
+  bool is_data_valid;      ///< False if the burst couldn't be captured.
+  float sample_rate;       ///< Sampling rate of the burst, in Hz.
+  float rms;               ///< RMS acceleration at all frequencies.
+  float peak_frequency;    ///< Frequency of the strongest component, Hz.
+  float peak_rms;          ///< RMS acceleration of the strongest component.
+  float band_edges[kVibrationBandCount + 1];  ///< Band limits, in Hz.
+  float band_rms[kVibrationBandCount];        ///< RMS acceleration per band.
+};
+
+typedef ValueProducer<VibrationSpectrum> VibrationSpectrumProducer;
+
+/**
+ * AnchorSwing struct summarizes how a vessel at anchor swung during one
+ * window: its mean bearing, and the amplitude and period of the heading's
+ * oscillation about it. Angles are in radians, the period in seconds.
+ */
+struct AnchorSwing {
+  bool is_data_valid;    ///< True for every completed window.
+  float mean_bearing;    ///< Circular mean of heading, [0, 2Pi).
+  float amplitude;       ///< Half the peak-to-peak swing about the mean.
+  float period;          ///< Time of a full swing; NaN if it didn't swing.
+  bool is_alert;         ///< True if the swing changed abnormally.
+};
+
+typedef ValueProducer<AnchorSwing> AnchorSwingProducer;
+
+/**
+ * AlertNotification struct holds a Signal K notification: whether the
+ * condition is raised, and a message describing it.
+ */
+struct AlertNotification {
+  bool is_alert;      ///< True for state "alert", false for "normal".
+  char message[96];   ///< Human-readable description.
+};
+
+typedef ValueProducer<AlertNotification> AlertNotificationProducer;
+
 } // namespace sensesp
 
 #endif  // _signalk_orientation_H_
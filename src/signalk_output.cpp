@@ -0,0 +1,58 @@
+/** @file signalk_output.cpp
+ *  @brief Sends the SKOutput deltas that carry their own timestamp.
+ */
+
+#include "signalk_output.h"
+
+#include <sys/time.h>
+
+#include "sensesp_app.h"
+
+namespace sensesp {
+
+/**
+ * @brief Formats a wall-clock time as a Signal K timestamp (ISO 8601,
+ * UTC, millisecond resolution).
+ *
+ * @param sk_time_ms Time in ms since the Unix epoch, or 0 if unknown.
+ * @param buffer Destination; at least 25 characters long.
+ * @param buffer_size Size of buffer in bytes.
+ * @return True if a timestamp was written; False if the time is unknown.
+ */
+bool FormatSKTimestamp(uint64_t sk_time_ms, char* buffer,
+                       size_t buffer_size) {
+  if (0 == sk_time_ms) {
+    return false;
+  }
+  time_t seconds = sk_time_ms / 1000;
+  struct tm utc;
+  gmtime_r(&seconds, &utc);
+  size_t len = strftime(buffer, buffer_size, "%Y-%m-%dT%H:%M:%S", &utc);
+  if (0 == len) {
+    return false;
+  }
+  snprintf(buffer + len, buffer_size - len, ".%03uZ",
+           (unsigned)(sk_time_ms % 1000));
+  return true;
+}  // end FormatSKTimestamp()
+
+/**
+ * @brief Sends a complete delta to the server over the websocket,
+ * bypassing the delta queue.
+ *
+ * @param delta The delta, with its "updates" array.
+ * @return True if sent; False if there is no connection to the server,
+ * in which case the delta is discarded.
+ */
+bool SendSKDelta(const JsonDocument& delta) {
+  if (!sensesp_app->get_ws_client()->is_connected()) {
+    return false;
+  }
+  String json;
+  json.reserve(measureJson(delta));  // one allocation for the text
+  serializeJson(delta, json);
+  sensesp_app->get_ws_client()->sendTXT(json);
+  return true;
+}  // end SendSKDelta()
+
+}  // namespace sensesp
@@ -10,12 +10,26 @@
 #define _signalk_output_H_
 
 
+#include "heap_telemetry.h"
+#include "latency_monitor.h"
+#include "serialization_arena.h"
+#include "signalk_metadata_cache.h"
 #include "signalk_orientation.h"
 #include "sensesp/signalk/signalk_emitter.h"
 #include "sensesp/transforms/transform.h"
 
 namespace sensesp {
 
+/**
+ * JSON document whose memory pool comes from the SerializationArena
+ * rather than a separate heap allocation for each as_signalk().
+ */
+typedef BasicJsonDocument<ArenaAllocator> ArenaJsonDocument;
+
+bool FormatSKTimestamp(uint64_t sk_time_ms, char* buffer,
+                       size_t buffer_size);
+bool SendSKDelta(const JsonDocument& delta);
+
 static const char SIGNALKOUTPUT_SCHEMA[] PROGMEM = R"({
       "type": "object",
       "properties": {
@@ -41,14 +55,20 @@ class SKOutput : public SKEmitter, public SymmetricTransform<T> {
    * more information.
    * @param meta Optional metadata that is associated with the value output by
    * this class A value specified here will cause the path's metadata to be
-   * emitted on the first delta sent to the server. Use NULL if this path has no
+   * sent once each time a connection is made to the server. Use NULL if this path has no
    * metadata to report (or if the path is already an official part of the
    * Signal K specification)
    */
   SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
-      : SKEmitter(sk_path), SymmetricTransform<T>(config_path), meta_{meta} {
+      : SKEmitter(sk_path),
+        SymmetricTransform<T>(config_path),
+        meta_{meta},
+        latency_monitor_{NULL},
+        latency_epoch_{NULL} {
     Startable::set_start_priority(-5);
     this->load_configuration();
+    HEAP_COUNTER_NAME(heap_counter_, this->get_sk_path().c_str());
+    SKMetadataCache::Set(this, meta_);
   }
 
   SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
@@ -58,15 +78,20 @@ class SKOutput : public SKEmitter, public SymmetricTransform<T> {
   }
 
   virtual String as_signalk() override {
-    DynamicJsonDocument json_doc(1024);
+    HEAP_SCOPE(heap_counter_);
+    ArenaJsonDocument json_doc(1024);
     String json;
     json_doc["path"] = this->get_sk_path();
     json_doc["value"] = ValueProducer<T>::output;
     // confirm JsonDoc size was adequate
     if (json_doc.overflowed()) {
-      debugE("DynamicJsonDocument size too small");
+      debugE("ArenaJsonDocument size too small");
     }
+    json.reserve(measureJson(json_doc));  // one allocation for the text
     serializeJson(json_doc, json);
+    if (latency_monitor_) {
+      latency_monitor_->RecordSerialized(*latency_epoch_);
+    }
     return json;
   }
 
@@ -81,6 +106,8 @@ class SKOutput : public SKEmitter, public SymmetricTransform<T> {
       return false;
     }
     this->set_sk_path(config["sk_path"].as<String>());
+    HEAP_COUNTER_NAME(heap_counter_, this->get_sk_path().c_str());
+    SKMetadataCache::MarkChanged();  // metadata must name the new path
     return true;
   }
 
@@ -90,28 +117,51 @@ class SKOutput : public SKEmitter, public SymmetricTransform<T> {
    * method of setting the metadata (the first being a parameter
    * to the constructor).
    */
-  virtual void set_metadata(SKMetadata* meta) { this->meta_ = meta; }
+  virtual void set_metadata(SKMetadata* meta) {
+    this->meta_ = meta;
+    SKMetadataCache::Set(this, meta);
+  }
 
-  virtual SKMetadata* get_metadata() override { return meta_; }
+  // Metadata are sent by SKMetadataCache once per connection, so none
+  // are given to the delta queue.
+  virtual SKMetadata* get_metadata() override { return NULL; }
+
+  /**
+   * Sets the monitor that records the latency of this output, or NULL
+   * for none. A plain value carries no epoch, so the fusion run it was
+   * taken from is given too, e.g. &orientation_sensor->GetFusionEpoch().
+   */
+  void set_latency_monitor(LatencyMonitor* monitor,
+                           const FusionEpoch* epoch) {
+    latency_monitor_ = monitor;
+    latency_epoch_ = epoch;
+  }
 
   protected:
     SKMetadata* meta_;
+    HEAP_COUNTER(heap_counter_)  ///< allocations by as_signalk()
+    LatencyMonitor* latency_monitor_;  ///< Optional latency instrumentation
+    const FusionEpoch* latency_epoch_;  ///< fusion run of the values
 };
 
 /**
- * @brief SKOutput:: template specialization for sending
- * attitude values to the Signal K server.
+ * @brief Base of the SKOutput specializations for structs, whose value
+ * is a JSON object of several members.
  *
- * When SKOutput is called with the output variable of type
- * struct Attitude, the overridden as_signalk() method writes the
- * three attitude values (yaw, pitch, roll) contained in the struct.
+ * It holds what all of them share: the path and its configuration, the
+ * metadata, and the serialization into a document from the
+ * SerializationArena. A specialization gives the document size and
+ * writes the members of the value in FillValue().
+ *
+ * If a specialization's GetEpoch() gives the fusion run the value was
+ * taken from, and the wall clock was set then, the value is sent in a
+ * delta of its own whose update has that time as its "timestamp". An
+ * SKEmitter only gives the delta queue a path and value, which the
+ * queue puts in an update of its own, stamped by the server on arrival.
  */
-template <>
-class SKOutput<Attitude> : public SKEmitter,
-                           public SymmetricTransform<Attitude> {
+template <typename T>
+class SKOutputStruct : public SKEmitter, public SymmetricTransform<T> {
  public:
-  SKOutput() : SKOutput("") { this->load_configuration(); }
-
   /**
    * @brief The constructor.
    *
@@ -121,56 +171,57 @@ class SKOutput<Attitude> : public SKEmitter,
    * more information.
    * @param meta Optional metadata that is associated with the value output by
    * this class. A value specified here will cause the path's metadata to be
-   * emitted on the first delta sent to the server. Use NULL if this path has no
+   * sent once each time a connection is made to the server. Use NULL if this path has no
    * metadata to report, or if the path is already an official part of the
    * Signal K specification.
+   * @param document_size Size of the JSON document holding the path and
+   * value, estimated using https://arduinojson.org/v6/assistant/
    */
-  SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
+  SKOutputStruct(String sk_path, String config_path, SKMetadata* meta,
+                 size_t document_size)
       : SKEmitter(sk_path),
-        SymmetricTransform<Attitude>(config_path),
-        meta_{meta} {
+        SymmetricTransform<T>(config_path),
+        meta_{meta},
+        document_size_{document_size},
+        latency_monitor_{NULL} {
     Startable::set_start_priority(-5);
     this->load_configuration();
+    HEAP_COUNTER_NAME(heap_counter_, this->get_sk_path().c_str());
+    SKMetadataCache::Set(this, meta_);
   }
 
-  // Constructor used when no config path is specified.
-  SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
-
-  // ValueProducer<Attitude>::emit is used to output an attitude
-  virtual void set_input(Attitude new_value,
-                         uint8_t input_channel = 0) override {
-    this->ValueProducer<Attitude>::emit(new_value);
+  // Values with a wall-clock time are sent with it; all others go to
+  // the delta queue through ValueProducer<T>::emit.
+  virtual void set_input(T new_value, uint8_t input_channel = 0) override {
+    this->output = new_value;
+    const FusionEpoch* epoch = GetEpoch();
+    char timestamp[32];
+    if (epoch &&
+        FormatSKTimestamp(epoch->sk_time_ms, timestamp, sizeof(timestamp))) {
+      SendTimestamped(*epoch, timestamp);
+    } else {
+      this->notify();
+    }
   }
 
-  // When as_signalk() is dealing with an Attitude, it customizes
-  // the JSON container for the three enclosed float values
   virtual String as_signalk() override {
-    DynamicJsonDocument json_doc(
-        128);  // size estimated using https://arduinojson.org/v6/assistant/
+    HEAP_SCOPE(heap_counter_);
+    ArenaJsonDocument json_doc(document_size_);
     String json;
     json_doc["path"] = this->get_sk_path();
     JsonObject value = json_doc.createNestedObject("value");
-    if (ValueProducer<Attitude>::output.is_data_valid) {
-      value["yaw"] = ValueProducer<Attitude>::output.yaw;
-      value["pitch"] = ValueProducer<Attitude>::output.pitch;
-      value["roll"] = ValueProducer<Attitude>::output.roll;
-    } else {
-      /** Show that valid values are not available. The Signal K spec
-       * indicates this is done by sending a JSON null for the value key.
-       * Note that this is *not* the same as an empty string, the string "null",
-       * or the value 0, which one gets by value["yaw"] = "" or "null" or NULL,
-       * respectively.
-       */
-      value["yaw"] = (char*)0;  // send JSON null. Signal K displays -.----
-      value["pitch"] = (char*)0;
-      value["roll"] = (char*)0;
-    }
+    FillValue(value);
     // Confirm JsonDoc size was adequate. If insufficient memory is
     // available, then trailing elements of JsonDoc are omitted.
     if (json_doc.overflowed()) {
-      debugE("DynamicJsonDocument size too small");
+      debugE("ArenaJsonDocument size too small");
     }
+    json.reserve(measureJson(json_doc));  // one allocation for the text
     serializeJson(json_doc, json);
+    const FusionEpoch* epoch = GetEpoch();
+    if (latency_monitor_ && epoch) {
+      latency_monitor_->RecordSerialized(*epoch);
+    }
     return json;
   }
 
@@ -185,6 +236,8 @@ class SKOutput<Attitude> : public SKEmitter,
       return false;
     }
     this->set_sk_path(config["sk_path"].as<String>());
+    HEAP_COUNTER_NAME(heap_counter_, this->get_sk_path().c_str());
+    SKMetadataCache::MarkChanged();  // metadata must name the new path
     return true;
   }
 
@@ -192,16 +245,105 @@ class SKOutput<Attitude> : public SKEmitter,
    * Used to set the optional metadata that is associated with
    * the Signal K path this transform emits. This is a second
    * method of setting the metadata (the first being a parameter
-   * to the constructor). Note that since an Attitude 
-   * consisting of yaw, pitch and roll in radians is defined
-   * in the Signal K spec, usually we would not send metadata.
+   * to the constructor).
    */
-  virtual void set_metadata(SKMetadata* meta) { this->meta_ = meta; }
+  virtual void set_metadata(SKMetadata* meta) {
+    this->meta_ = meta;
+    SKMetadataCache::Set(this, meta);
+  }
 
-  virtual SKMetadata* get_metadata() override { return meta_; }
+  // Metadata are sent by SKMetadataCache once per connection, so none
+  // are given to the delta queue.
+  virtual SKMetadata* get_metadata() override { return NULL; }
+
+  /**
+   * Sets the monitor that records the latency of this output, or NULL
+   * for none. Only outputs whose values carry an epoch (see GetEpoch())
+   * are recorded.
+   */
+  void set_latency_monitor(LatencyMonitor* monitor) {
+    latency_monitor_ = monitor;
+  }
 
  protected:
+  /// Writes the members of the output into the value object
+  virtual void FillValue(JsonObject& value) = 0;
+  /// Fusion run the output was taken from, or NULL if it carries none
+  virtual const FusionEpoch* GetEpoch(void) { return NULL; }
   SKMetadata* meta_;
+  HEAP_COUNTER(heap_counter_)  ///< allocations by as_signalk()
+  size_t document_size_;  ///< size of the JSON document, in bytes
+  LatencyMonitor* latency_monitor_;  ///< Optional latency instrumentation
+
+ private:
+  /// Room for the update, its timestamp and the values array, in bytes
+  static const size_t kUpdateSize = 128;
+
+  // Sends the output in a delta with one update, stamped with the time
+  // the value was measured rather than the time it arrives.
+  void SendTimestamped(const FusionEpoch& epoch, const char* timestamp) {
+    HEAP_SCOPE(heap_counter_);
+    ArenaJsonDocument json_doc(document_size_ + kUpdateSize);
+    JsonObject update =
+        json_doc.createNestedArray("updates").createNestedObject();
+    update["timestamp"] = (char*)timestamp;  // copied into the document
+    JsonObject entry = update.createNestedArray("values").createNestedObject();
+    entry["path"] = this->get_sk_path();
+    JsonObject value = entry.createNestedObject("value");
+    FillValue(value);
+    if (json_doc.overflowed()) {
+      debugE("ArenaJsonDocument size too small");
+    }
+    if (SendSKDelta(json_doc) && latency_monitor_) {
+      latency_monitor_->RecordSent(epoch);
+    }
+  }
+
+};  // end class SKOutputStruct
+
+/**
+ * @brief SKOutput:: template specialization for sending
+ * attitude values to the Signal K server.
+ *
+ * When SKOutput is called with the output variable of type
+ * struct Attitude, FillValue() writes the three attitude values
+ * (yaw, pitch, roll) contained in the struct.
+ */
+template <>
+class SKOutput<Attitude> : public SKOutputStruct<Attitude> {
+ public:
+  /**
+   * @brief The constructor. Note that since an Attitude consisting of
+   * yaw, pitch and roll in radians is defined in the Signal K spec,
+   * usually no metadata would be given.
+   */
+  SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
+      : SKOutputStruct<Attitude>(sk_path, config_path, meta, 192) {}
+  SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
+
+ protected:
+  virtual void FillValue(JsonObject& value) override {
+    const Attitude& attitude = ValueProducer<Attitude>::output;
+    if (attitude.is_data_valid) {
+      value["yaw"] = attitude.yaw;
+      value["pitch"] = attitude.pitch;
+      value["roll"] = attitude.roll;
+    } else {
+      /** Show that valid values are not available. The Signal K spec
+       * indicates this is done by sending a JSON null for the value key.
+       * Note that this is *not* the same as an empty string, the string "null",
+       * or the value 0, which one gets by value["yaw"] = "" or "null" or NULL,
+       * respectively.
+       */
+      value["yaw"] = (char*)0;  // send JSON null. Signal K displays -.----
+      value["pitch"] = (char*)0;
+      value["roll"] = (char*)0;
+    }
+  }
+
+  virtual const FusionEpoch* GetEpoch(void) override {
+    return &ValueProducer<Attitude>::output.epoch;
+  }
 
 };  // end SKOutput<Attitude> template specialization
 
@@ -216,62 +358,28 @@ typedef SKOutput<Attitude> SKOutputAttitude;
  * magnetic calibration parameters to the Signal K server.
  *
  * When SKOutput is called with the output variable of type
- * struct MagCal, the overridden as_signalk() method writes the
- * various calibration values contained in the struct.
+ * struct MagCal, FillValue() writes the various calibration values
+ * contained in the struct.
  */
 template <>
-class SKOutput<MagCal> : public SKEmitter,
-                           public SymmetricTransform<MagCal> {
+class SKOutput<MagCal> : public SKOutputStruct<MagCal> {
  public:
-  SKOutput() : SKOutput("") { this->load_configuration(); }
-
-  /**
-   * @brief The constructor.
-   *
-   * @param sk_path The Signal K path the output value is sent on.
-   * @param config_path The optional configuration path that allows an end user
-   * to change the configuration of this object. See the Configurable class for
-   * more information.
-   * @param meta Optional metadata that is associated with the value output by
-   * this class. A value specified here will cause the path's metadata to be
-   * emitted on the first delta sent to the server. Use NULL if this path has no
-   * metadata to report, or if the path is already an official part of the
-   * Signal K specification.
-   */
   SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
-      : SKEmitter(sk_path),
-        SymmetricTransform<MagCal>(config_path),
-        meta_{meta} {
-    Startable::set_start_priority(-6);
-    this->load_configuration();
-  }
-
-  // Constructor used when no config path is specified.
+      : SKOutputStruct<MagCal>(sk_path, config_path, meta, 320) {}
   SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
 
-  // ValueProducer<MagCal>::emit is used to output a MagCal struct
-  virtual void set_input(MagCal new_value,
-                         uint8_t input_channel = 0) override {
-    this->ValueProducer<MagCal>::emit(new_value);
-  }
-
-  // When as_signalk() is dealing with a MagCal struct, it customizes
-  // the JSON container for the enclosed values
+ protected:
   // TODO sort out the units
-  virtual String as_signalk() override {
-    DynamicJsonDocument json_doc(
-        256);  // size estimated using https://arduinojson.org/v6/assistant/
-    String json;
-    json_doc["path"] = this->get_sk_path();
-    JsonObject value = json_doc.createNestedObject("value");
-    if (ValueProducer<MagCal>::output.is_data_valid) {
-      value["incl"] = ValueProducer<MagCal>::output.magnetic_inclination;
-      value["ferr"] = ValueProducer<MagCal>::output.cal_fit_error;
-      value["ferrt"] = ValueProducer<MagCal>::output.cal_fit_error_trial;
-      value["bmag"] = ValueProducer<MagCal>::output.mag_field_magnitude;
-      value["bmagt"] = ValueProducer<MagCal>::output.mag_field_magnitude_trial;
-      value["noise"] = ValueProducer<MagCal>::output.mag_noise_covariance;
-      value["solver"] = ValueProducer<MagCal>::output.mag_solver;
+  virtual void FillValue(JsonObject& value) override {
+    const MagCal& mag_cal = ValueProducer<MagCal>::output;
+    if (mag_cal.is_data_valid) {
+      value["incl"] = mag_cal.magnetic_inclination;
+      value["ferr"] = mag_cal.cal_fit_error;
+      value["ferrt"] = mag_cal.cal_fit_error_trial;
+      value["bmag"] = mag_cal.mag_field_magnitude;
+      value["bmagt"] = mag_cal.mag_field_magnitude_trial;
+      value["noise"] = mag_cal.mag_noise_covariance;
+      value["solver"] = mag_cal.mag_solver;
     } else {
       /** Show that valid values are not available for the parameters that
        * are based on recent readings (ones based on stored cal should be OK).
@@ -281,58 +389,281 @@ class SKOutput<MagCal> : public SKEmitter,
        * value["yaw"] = "" or "null" or NULL, respectively.
        */
       value["incl"] = (char*)0;  // send JSON null. Signal K displays -.----
-      value["ferr"] = ValueProducer<MagCal>::output.cal_fit_error;
+      value["ferr"] = mag_cal.cal_fit_error;
       value["ferrt"] = (char*)0;  // send JSON null. Signal K displays -.----
-      value["bmag"] = ValueProducer<MagCal>::output.mag_field_magnitude;
+      value["bmag"] = mag_cal.mag_field_magnitude;
       value["bmagt"] = (char*)0;  // send JSON null. Signal K displays -.----
       value["noise"] = (char*)0;  // send JSON null. Signal K displays -.----
-      value["solver"] = ValueProducer<MagCal>::output.mag_solver;
+      value["solver"] = mag_cal.mag_solver;
     }
-    // Confirm JsonDoc size was adequate. If insufficient memory is
-    // available, then trailing elements of JsonDoc are omitted.
-    if (json_doc.overflowed()) {
-      debugE("DynamicJsonDocument size too small");
+  }
+
+  virtual const FusionEpoch* GetEpoch(void) override {
+    return &ValueProducer<MagCal>::output.epoch;
+  }
+
+};  // end SKOutput<MagCal> template specialization
+
+/**
+ * @brief The SKOutput<MagCal> specialization can be invoked using
+ * the Class<Typename> format, or using this typedef.
+ */
+typedef SKOutput<MagCal> SKOutputMagCal;
+
+/**
+ * @brief SKOutput:: template specialization for sending
+ * output latency statistics to the Signal K server.
+ *
+ * When SKOutput is called with the output variable of type
+ * struct LatencyStats, FillValue() writes the percentiles and maxima
+ * contained in the struct, in seconds.
+ */
+template <>
+class SKOutput<LatencyStats> : public SKOutputStruct<LatencyStats> {
+ public:
+  SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
+      : SKOutputStruct<LatencyStats>(sk_path, config_path, meta, 256) {}
+  SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
+
+ protected:
+  virtual void FillValue(JsonObject& value) override {
+    const LatencyStats& stats = ValueProducer<LatencyStats>::output;
+    value["samples"] = stats.sample_count;
+    if (stats.is_data_valid) {
+      value["serializeP50"] = stats.serialize_p50;
+      value["serializeP99"] = stats.serialize_p99;
+      value["serializeMax"] = stats.serialize_max;
+      value["sendP50"] = stats.send_p50;
+      value["sendP99"] = stats.send_p99;
+      value["sendMax"] = stats.send_max;
+    } else {
+      // No samples in the period: send JSON null. Signal K displays -.----
+      value["serializeP50"] = (char*)0;
+      value["serializeP99"] = (char*)0;
+      value["serializeMax"] = (char*)0;
+      value["sendP50"] = (char*)0;
+      value["sendP99"] = (char*)0;
+      value["sendMax"] = (char*)0;
     }
-    serializeJson(json_doc, json);
-    return json;
   }
 
-  virtual void get_configuration(JsonObject& root) override {
-    root["sk_path"] = this->get_sk_path();
+};  // end SKOutput<LatencyStats> template specialization
+
+/**
+ * @brief The SKOutput<LatencyStats> specialization can be invoked using
+ * the Class<Typename> format, or using this typedef.
+ */
+typedef SKOutput<LatencyStats> SKOutputLatencyStats;
+
+/**
+ * @brief SKOutput:: template specialization for sending
+ * heap statistics to the Signal K server.
+ *
+ * When SKOutput is called with the output variable of type
+ * struct HeapStats, FillValue() writes the heap sizes in bytes, and
+ * allocation rates per second.
+ */
+template <>
+class SKOutput<HeapStats> : public SKOutputStruct<HeapStats> {
+ public:
+  SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
+      : SKOutputStruct<HeapStats>(sk_path, config_path, meta, 256) {}
+  SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
+
+ protected:
+  virtual void FillValue(JsonObject& value) override {
+    const HeapStats& stats = ValueProducer<HeapStats>::output;
+    value["free"] = stats.free_bytes;
+    value["largestFreeBlock"] = stats.largest_free_block;
+    value["fragmentation"] = stats.fragmentation;
+    value["allocationsPerSecond"] = stats.allocations_per_s;
+    value["bytesPerSecond"] = stats.bytes_per_s;
   }
 
-  String get_config_schema() override { return FPSTR(SIGNALKOUTPUT_SCHEMA); }
+};  // end SKOutput<HeapStats> template specialization
 
-  virtual bool set_configuration(const JsonObject& config) override {
-    if (!config.containsKey("sk_path")) {
-      return false;
+/**
+ * @brief The SKOutput<HeapStats> specialization can be invoked using
+ * the Class<Typename> format, or using this typedef.
+ */
+typedef SKOutput<HeapStats> SKOutputHeapStats;
+
+/**
+ * @brief SKOutput:: template specialization for sending
+ * the startup profile to the Signal K server.
+ *
+ * When SKOutput is called with the output variable of type
+ * struct BootProfile, FillValue() writes the time each startup phase
+ * was reached, in seconds since power-on. Phases that weren't reached
+ * are sent as null.
+ */
+template <>
+class SKOutput<BootProfile> : public SKOutputStruct<BootProfile> {
+ public:
+  SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
+      : SKOutputStruct<BootProfile>(sk_path, config_path, meta, 256) {}
+  SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
+
+ protected:
+  virtual void FillValue(JsonObject& value) override {
+    const BootProfile& profile = ValueProducer<BootProfile>::output;
+    SetPhase(value, "setupStart", profile.setup_start);
+    SetPhase(value, "appBuilt", profile.app_built);
+    SetPhase(value, "sensorInstalled", profile.sensor_installed);
+    SetPhase(value, "stateRestored", profile.state_restored);
+    SetPhase(value, "appStarted", profile.app_started);
+    SetPhase(value, "firstFusion", profile.first_fusion);
+    SetPhase(value, "headingValid", profile.heading_valid);
+    SetPhase(value, "wifiConnected", profile.wifi_connected);
+    SetPhase(value, "skConnected", profile.sk_connected);
+  }
+
+ private:
+  // Writes the time of one phase, or null if it wasn't reached
+  static void SetPhase(JsonObject& value, const char* name, float seconds) {
+    if (seconds < 0.0) {
+      value[name] = (char*)0;  // sends null
+    } else {
+      value[name] = seconds;
     }
-    this->set_sk_path(config["sk_path"].as<String>());
-    return true;
   }
 
-  /**
-   * Used to set the optional metadata that is associated with
-   * the Signal K path this transform emits. This is a second
-   * method of setting the metadata (the first being a parameter
-   * to the constructor). Note that since an Attitude 
-   * consisting of yaw, pitch and roll in radians is defined
-   * in the Signal K spec, usually we would not send metadata.
-   */
-  virtual void set_metadata(SKMetadata* meta) { this->meta_ = meta; }
+};  // end SKOutput<BootProfile> template specialization
 
-  virtual SKMetadata* get_metadata() override { return meta_; }
+/**
+ * @brief The SKOutput<BootProfile> specialization can be invoked using
+ * the Class<Typename> format, or using this typedef.
+ */
+typedef SKOutput<BootProfile> SKOutputBootProfile;
+
+/**
+ * @brief SKOutput:: template specialization for sending
+ * vibration spectra to the Signal K server.
+ *
+ * When SKOutput is called with the output variable of type
+ * struct VibrationSpectrum, FillValue() writes the overall and peak RMS
+ * accelerations, the peak frequency, and an array of bands each with its
+ * limits and RMS acceleration. If the data are not valid, null values
+ * are sent.
+ */
+template <>
+class SKOutput<VibrationSpectrum> : public SKOutputStruct<VibrationSpectrum> {
+ public:
+  SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
+      : SKOutputStruct<VibrationSpectrum>(sk_path, config_path, meta, 640) {}
+  SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
 
  protected:
-  SKMetadata* meta_;
+  virtual void FillValue(JsonObject& value) override {
+    const VibrationSpectrum& spectrum =
+        ValueProducer<VibrationSpectrum>::output;
+    if (spectrum.is_data_valid) {
+      value["sampleRate"] = spectrum.sample_rate;
+      value["rms"] = spectrum.rms;
+      value["peakFrequency"] = spectrum.peak_frequency;
+      value["peakRms"] = spectrum.peak_rms;
+      JsonArray bands = value.createNestedArray("bands");
+      for (int i = 0; i < kVibrationBandCount; i++) {
+        JsonObject band = bands.createNestedObject();
+        band["from"] = spectrum.band_edges[i];
+        band["to"] = spectrum.band_edges[i + 1];
+        band["rms"] = spectrum.band_rms[i];
+      }
+    } else {
+      value["rms"] = (char*)0;  // sends null
+      value["peakFrequency"] = (char*)0;
+    }
+  }
 
-};  // end SKOutput<MagCal> template specialization
+};  // end SKOutput<VibrationSpectrum> template specialization
 
 /**
- * @brief The SKOutput<MagCal> specialization can be invoked using
+ * @brief The SKOutput<VibrationSpectrum> specialization can be invoked
+ * using the Class<Typename> format, or using this typedef.
+ */
+typedef SKOutput<VibrationSpectrum> SKOutputVibrationSpectrum;
+
+/**
+ * @brief SKOutput:: template specialization for sending
+ * anchor swing statistics to the Signal K server.
+ *
+ * When SKOutput is called with the output variable of type
+ * struct AnchorSwing, FillValue() writes the mean bearing and swing
+ * amplitude in radians, the period in seconds, and whether the swing
+ * changed abnormally. Values that aren't known are sent as null.
+ */
+template <>
+class SKOutput<AnchorSwing> : public SKOutputStruct<AnchorSwing> {
+ public:
+  SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
+      : SKOutputStruct<AnchorSwing>(sk_path, config_path, meta, 256) {}
+  SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
+
+ protected:
+  virtual void FillValue(JsonObject& value) override {
+    const AnchorSwing& swing = ValueProducer<AnchorSwing>::output;
+    if (swing.is_data_valid) {
+      value["meanBearing"] = swing.mean_bearing;
+      value["amplitude"] = swing.amplitude;
+      if (isnan(swing.period)) {
+        value["period"] = (char*)0;  // sends null: no swing seen
+      } else {
+        value["period"] = swing.period;
+      }
+    } else {
+      value["meanBearing"] = (char*)0;
+      value["amplitude"] = (char*)0;
+      value["period"] = (char*)0;
+    }
+    value["alert"] = swing.is_alert;
+  }
+
+};  // end SKOutput<AnchorSwing> template specialization
+
+/**
+ * @brief The SKOutput<AnchorSwing> specialization can be invoked using
  * the Class<Typename> format, or using this typedef.
  */
-typedef SKOutput<MagCal> SKOutputMagCal;
+typedef SKOutput<AnchorSwing> SKOutputAnchorSwing;
+
+/**
+ * @brief SKOutput:: template specialization for sending
+ * notifications to the Signal K server.
+ *
+ * When SKOutput is called with the output variable of type
+ * struct AlertNotification, FillValue() writes the notification's state
+ * ("alert" or "normal"), the methods by which it should be shown, and
+ * its message. The path should be under "notifications.".
+ */
+template <>
+class SKOutput<AlertNotification> : public SKOutputStruct<AlertNotification> {
+ public:
+  SKOutput(String sk_path, String config_path = "", SKMetadata* meta = NULL)
+      : SKOutputStruct<AlertNotification>(sk_path, config_path, meta, 384) {}
+  SKOutput(String sk_path, SKMetadata* meta) : SKOutput(sk_path, "", meta) {}
+
+ protected:
+  virtual void FillValue(JsonObject& value) override {
+    const AlertNotification& notification =
+        ValueProducer<AlertNotification>::output;
+    JsonArray method = value.createNestedArray("method");
+    if (notification.is_alert) {
+      value["state"] = "alert";
+      method.add("visual");
+      method.add("sound");
+    } else {
+      value["state"] = "normal";
+    }
+    value["message"] = (const char*)notification.message;
+  }
+
+};  // end SKOutput<AlertNotification> template specialization
+
+/**
+ * @brief The SKOutput<AlertNotification> specialization can be invoked
+ * using the Class<Typename> format, or using this typedef.
+ */
+typedef SKOutput<AlertNotification> SKOutputNotification;
 
 
 /**
@@ -0,0 +1,288 @@
+/** @file true_heading.cpp
+ *  @brief Converts magnetic heading to true, using a magnetic variation
+ *  grid stored on the device.
+ */
+
+#include "true_heading.h"
+
+#include <SPIFFS.h>
+#include <time.h>
+
+#include "config_schema.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+#define CONFIG_KEY_LATITUDE "latitude"
+#define CONFIG_KEY_LONGITUDE "longitude"
+#define CONFIG_KEY_VARIATION "variation"
+
+/// Earliest time() taken as a set clock: 2020-01-01
+static const time_t kClockSetTime = 1577836800;
+
+/**
+ * @brief Constructor.
+ *
+ * The grid file isn't opened until the first heading arrives, by which
+ * time SensESP has mounted the filesystem.
+ *
+ * @param variation_deg Variation used when there is no position or no
+ * grid, in degrees, east positive, or kNoVariation to output nothing
+ * then.
+ * @param grid_path Name of the grid file in SPIFFS.
+ * @param config_path RESTful path by which the fixed position and the
+ * fallback variation can be configured.
+ */
+TrueHeading::TrueHeading(float variation_deg, String grid_path,
+                         String config_path)
+    : SymmetricTransform<float>(config_path),
+      grid_path_{grid_path},
+      is_grid_checked_{false},
+      is_grid_valid_{false},
+      is_cell_loaded_{false},
+      has_position_{false},
+      latitude_{0.0},
+      longitude_{0.0},
+      fixed_latitude_{kNoLatitude},
+      fixed_longitude_{0.0},
+      fallback_variation_deg_{variation_deg},
+      is_variation_known_{false},
+      variation_rad_{0.0},
+      is_update_needed_{true} {
+  load_configuration();
+}  // end TrueHeading()
+
+/**
+ * @brief Converts a magnetic heading to true.
+ *
+ * @param input Magnetic heading, in radians.
+ */
+void TrueHeading::set_input(float input, uint8_t input_channel) {
+  if (isnan(input)) {
+    return;
+  }
+  if (is_update_needed_) {
+    UpdateVariation();  // here rather than in set_configuration(), on the loop task
+  }
+  if (!is_variation_known_) {
+    return;
+  }
+  float heading = input + variation_rad_;
+  while (heading < 0.0) {
+    heading += 2.0 * PI;
+  }
+  while (heading >= 2.0 * PI) {
+    heading -= 2.0 * PI;
+  }
+  this->emit(heading);
+}  // end set_input()
+
+/**
+ * @brief Sets the vessel's position and recalculates the variation.
+ *
+ * @param latitude Latitude in degrees, north positive.
+ * @param longitude Longitude in degrees, east positive.
+ */
+void TrueHeading::SetPosition(float latitude, float longitude) {
+  if (isnan(latitude) || isnan(longitude) || fabs(latitude) > 90.0) {
+    return;
+  }
+  latitude_ = latitude;
+  longitude_ = longitude;
+  has_position_ = true;
+  UpdateVariation();
+}  // end SetPosition()
+
+/**
+ * @brief Opens the grid file and checks its header.
+ */
+void TrueHeading::OpenGrid(void) {
+  is_grid_checked_ = true;
+  if (!SPIFFS.exists(grid_path_)) {
+    debugI("TrueHeading: no variation grid at %s", grid_path_.c_str());
+    return;
+  }
+  File file = SPIFFS.open(grid_path_, "r");
+  size_t size = file.size();
+  size_t count = file.read((uint8_t*)&grid_, sizeof(grid_));
+  file.close();
+  if (count != sizeof(grid_) || !IsValidVariationGrid(grid_, size)) {
+    debugE("TrueHeading: %s is not a variation grid", grid_path_.c_str());
+    return;
+  }
+  is_grid_valid_ = true;
+  debugI("TrueHeading: variation grid %ux%u, epoch %.1f",
+         grid_.lat_count, grid_.lon_count, grid_.epoch);
+}  // end OpenGrid()
+
+/**
+ * @brief Reads the four corner points of a cell from the grid file.
+ *
+ * @param cell The cell, as found by FindVariationGridCell().
+ * @return True if the points were read into corners_.
+ */
+bool TrueHeading::LoadCell(const VariationGridCell& cell) {
+  File file = SPIFFS.open(grid_path_, "r");
+  if (!file) {
+    return false;
+  }
+  bool is_read = true;
+  for (int corner = 0; corner < 4 && is_read; corner += 2) {
+    // each row's pair of points are adjacent in the file
+    uint16_t row = cell.row + corner / 2;
+    is_read = file.seek(VariationGridPointOffset(grid_, row, cell.col)) &&
+              file.read((uint8_t*)&corners_[corner],
+                        2 * sizeof(VariationGridPoint)) ==
+                  2 * sizeof(VariationGridPoint);
+  }
+  file.close();
+  return is_read;
+}  // end LoadCell()
+
+/**
+ * @brief Returns the current decimal year, or the grid's epoch if the
+ * clock hasn't been set.
+ */
+float TrueHeading::CurrentYear(void) {
+  time_t now = time(NULL);
+  if (now < kClockSetTime) {
+    return grid_.epoch;
+  }
+  struct tm utc;
+  gmtime_r(&now, &utc);
+  return 1900.0 + utc.tm_year + utc.tm_yday / 365.25;
+}  // end CurrentYear()
+
+/**
+ * @brief Recalculates the variation for the latest position, and passes
+ * it on if it is known.
+ */
+void TrueHeading::UpdateVariation(void) {
+  is_update_needed_ = false;
+  if (!is_grid_checked_) {
+    OpenGrid();
+  }
+  float latitude = latitude_;
+  float longitude = longitude_;
+  if (!has_position_) {
+    latitude = fixed_latitude_;
+    longitude = fixed_longitude_;
+  }
+  float variation_deg = fallback_variation_deg_;
+  bool is_known = (kNoVariation != fallback_variation_deg_);
+  VariationGridCell cell;
+  if (is_grid_valid_ && fabs(latitude) <= 90.0 &&
+      FindVariationGridCell(grid_, latitude, longitude, &cell)) {
+    if (!is_cell_loaded_ || cell.row != cell_.row || cell.col != cell_.col) {
+      is_cell_loaded_ = LoadCell(cell);
+    }
+    cell_ = cell;
+    if (is_cell_loaded_) {
+      float years = CurrentYear() - grid_.epoch;
+      float corners[4];
+      for (int i = 0; i < 4; i++) {
+        corners[i] = (corners_[i].variation_cdeg +
+                      years * corners_[i].annual_change_cdeg) /
+                     100.0;
+      }
+      variation_deg = InterpolateVariation(corners, cell.fx, cell.fy);
+      is_known = true;
+    }
+  }
+  is_variation_known_ = is_known;
+  if (!is_known) {
+    return;
+  }
+  variation_rad_ = variation_deg * DEG_TO_RAD;
+  variation_.emit(variation_rad_);
+}  // end UpdateVariation()
+
+/**
+ * @brief Define the format for the TrueHeading configuration.
+ */
+static const char SCHEMA_TRUE_HEADING[] PROGMEM = SCHEMA_OBJECT(
+    SCHEMA_NUMBER(CONFIG_KEY_LATITUDE, "Fixed Latitude",
+                  "Degrees, used until a position arrives. 99 for none")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_LONGITUDE, "Fixed Longitude", "Degrees")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_VARIATION, "Variation",
+                       "Degrees east, used without a position or grid. "
+                       "999 for none"));
+
+/// Keys that a configuration of TrueHeading holds
+static const char* const kConfigKeysTrueHeading[] = {
+    CONFIG_KEY_LATITUDE, CONFIG_KEY_LONGITUDE, CONFIG_KEY_VARIATION};
+
+/**
+ * @brief Get the current configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void TrueHeading::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_LATITUDE] = fixed_latitude_;
+  doc[CONFIG_KEY_LONGITUDE] = fixed_longitude_;
+  doc[CONFIG_KEY_VARIATION] = fallback_variation_deg_;
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String TrueHeading::get_config_schema() {
+  return FPSTR(SCHEMA_TRUE_HEADING);
+}
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * The variation is recalculated at the next input.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found
+ * or the variation is outside [-180, 180] and isn't kNoVariation.
+ */
+bool TrueHeading::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysTrueHeading)) {
+    return false;
+  }
+  float variation = config[CONFIG_KEY_VARIATION];
+  if ((variation < -180.0 || variation > 180.0) &&
+      kNoVariation != variation) {
+    return false;
+  }
+  fallback_variation_deg_ = variation;
+  fixed_latitude_ = config[CONFIG_KEY_LATITUDE];
+  fixed_longitude_ = config[CONFIG_KEY_LONGITUDE];
+  is_update_needed_ = true;
+  return true;
+}  // end set_configuration()
+
+/**
+ * @brief Constructor subscribes to the vessel's position.
+ *
+ * @param true_heading The TrueHeading to be given the position.
+ * @param sk_path Signal K path of the position.
+ * @param listen_delay Minimum interval between position updates, in ms.
+ * Variation changes slowly with position, so this can be long.
+ */
+PositionListener::PositionListener(TrueHeading* true_heading, String sk_path,
+                                   int listen_delay)
+    : SKListener(sk_path, listen_delay, ""), true_heading_{true_heading} {}
+
+/**
+ * @brief Passes a received position to the TrueHeading.
+ *
+ * @param json The update, whose value holds latitude and longitude.
+ */
+void PositionListener::parse_value(const JsonObject& json) {
+  JsonObject value = json["value"];
+  if (value.isNull() || !value.containsKey("latitude") ||
+      !value.containsKey("longitude")) {
+    return;
+  }
+  true_heading_->SetPosition(value["latitude"], value["longitude"]);
+}  // end parse_value()
+
+}  // namespace sensesp
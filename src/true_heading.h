@@ -0,0 +1,96 @@
+/** @file true_heading.h
+ *  @brief Converts magnetic heading to true, using a magnetic variation
+ *  grid stored on the device.
+ */
+
+#ifndef true_heading_H_
+#define true_heading_H_
+
+#include "sensesp/signalk/signalk_listener.h"
+#include "sensesp/transforms/transform.h"
+#include "variation_grid.h"
+
+namespace sensesp {
+
+/**
+ * @brief TrueHeading adds the local magnetic variation to a magnetic
+ * heading, giving true heading.
+ *
+ * The variation is interpolated from a grid made from the World Magnetic
+ * Model by tools/wmm_grid.cpp and uploaded to the SPIFFS filesystem,
+ * then advanced by the grid's annual change to the current year (or to
+ * the grid's epoch, until the clock is set). Only the four points around
+ * the vessel are read from flash, and again only when it moves into
+ * another cell of the grid.
+ *
+ * Position comes from SetPosition(), usually fed with navigation.position
+ * by a PositionListener. Until a position arrives the configured fixed
+ * position is used, if there is one. If there is no position, or no
+ * usable grid, the configured variation is used instead. If no variation
+ * is configured either, nothing is output: a magnetic heading sent as
+ * true, or a variation of 0 overwriting one from the GPS, would be worse
+ * than no value.
+ *
+ * The input and output are in radians; the output is within [0, 2Pi).
+ * The variation in use is available from variation_, in radians, east
+ * positive, and is passed on whenever it is recalculated and known.
+ */
+class TrueHeading : public SymmetricTransform<float> {
+ public:
+  TrueHeading(float variation_deg = kNoVariation,
+              String grid_path = "/variation.bin", String config_path = "");
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+  void SetPosition(float latitude, float longitude);
+  ValueProducer<float> variation_;  ///< radians, east positive
+
+  /// Fixed latitude meaning that no fixed position is configured
+  static constexpr float kNoLatitude = 99.0;
+  /// Fallback variation meaning that none is configured
+  static constexpr float kNoVariation = 999.0;
+
+ private:
+  void OpenGrid(void);
+  bool LoadCell(const VariationGridCell& cell);
+  void UpdateVariation(void);
+  float CurrentYear(void);
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  String grid_path_;             ///< file holding the variation grid
+  bool is_grid_checked_;         ///< true once the grid file has been opened
+  bool is_grid_valid_;           ///< true if grid_ can be used
+  VariationGridHeader grid_;     ///< header of the grid file
+  bool is_cell_loaded_;          ///< true if corners_ holds cell_'s points
+  VariationGridCell cell_;       ///< cell whose corners are in corners_
+  VariationGridPoint corners_[4];  ///< SW, SE, NW, NE points of cell_
+  bool has_position_;            ///< true once SetPosition() has been called
+  float latitude_;               ///< latest position, in degrees
+  float longitude_;
+  float fixed_latitude_;         ///< configured position; kNoLatitude if none
+  float fixed_longitude_;
+  float fallback_variation_deg_;  ///< used without a position or grid
+  bool is_variation_known_;      ///< true if variation_rad_ can be used
+  float variation_rad_;          ///< variation in use
+  volatile bool is_update_needed_;  ///< set when configuration changes
+
+};  // end class TrueHeading
+
+/**
+ * @brief PositionListener passes the vessel's position from Signal K to
+ * a TrueHeading.
+ */
+class PositionListener : public SKListener {
+ public:
+  PositionListener(TrueHeading* true_heading,
+                   String sk_path = "navigation.position",
+                   int listen_delay = 10000);
+  virtual void parse_value(const JsonObject& json) override;
+
+ private:
+  TrueHeading* true_heading_;
+
+};  // end class PositionListener
+
+}  // namespace sensesp
+
+#endif  // true_heading_H_
@@ -0,0 +1,115 @@
+/** @file variation_grid.cpp
+ *  @brief Format of the magnetic variation grid, and interpolation in it.
+ */
+
+#include "variation_grid.h"
+
+#include <string.h>
+
+namespace sensesp {
+
+namespace {
+
+const char kGridMagic[4] = {'M', 'V', 'G', '1'};
+const uint16_t kGridVersion = 1;
+
+/// Wraps an angle in degrees into (-180, 180]
+inline float WrapDegrees(float degrees) {
+  while (degrees > 180.0f) {
+    degrees -= 360.0f;
+  }
+  while (degrees <= -180.0f) {
+    degrees += 360.0f;
+  }
+  return degrees;
+}
+
+}  // namespace
+
+/**
+ * @brief Checks that a grid's header is recognized and consistent with
+ * the size of the file.
+ *
+ * @param header The header, as read from the start of the file.
+ * @param file_size Size of the whole file, in bytes.
+ * @return True if the grid can be used.
+ */
+bool IsValidVariationGrid(const VariationGridHeader& header,
+                          size_t file_size) {
+  if (memcmp(header.magic, kGridMagic, sizeof(kGridMagic)) != 0 ||
+      header.version != kGridVersion || header.lat_count < 2 ||
+      header.lon_count < 2 || 0 == header.step_deg) {
+    return false;
+  }
+  size_t points = (size_t)header.lat_count * header.lon_count;
+  return file_size >=
+         sizeof(VariationGridHeader) + points * sizeof(VariationGridPoint);
+}  // end IsValidVariationGrid()
+
+/**
+ * @brief Finds the cell of the grid containing a position.
+ *
+ * @param header Header of the grid.
+ * @param latitude Latitude in degrees, north positive.
+ * @param longitude Longitude in degrees, east positive, -180 to 180.
+ * @param cell Receives the cell and the position within it.
+ * @return False if the position is outside the grid.
+ */
+bool FindVariationGridCell(const VariationGridHeader& header,
+                           float latitude, float longitude,
+                           VariationGridCell* cell) {
+  float y = (latitude - header.lat_min_deg) / header.step_deg;
+  float x = (longitude - header.lon_min_deg) / header.step_deg;
+  if (!(y >= 0.0f && x >= 0.0f && y <= header.lat_count - 1 &&
+        x <= header.lon_count - 1)) {
+    return false;  // also rejects NaN
+  }
+  // on the last row or column, use the cell before it
+  int row = (int)y;
+  int col = (int)x;
+  if (row > header.lat_count - 2) {
+    row = header.lat_count - 2;
+  }
+  if (col > header.lon_count - 2) {
+    col = header.lon_count - 2;
+  }
+  cell->row = row;
+  cell->col = col;
+  cell->fy = y - row;
+  cell->fx = x - col;
+  return true;
+}  // end FindVariationGridCell()
+
+/**
+ * @brief Returns where a point is stored in the grid file.
+ */
+size_t VariationGridPointOffset(const VariationGridHeader& header,
+                                uint16_t row, uint16_t col) {
+  return sizeof(VariationGridHeader) +
+         ((size_t)row * header.lon_count + col) * sizeof(VariationGridPoint);
+}  // end VariationGridPointOffset()
+
+/**
+ * @brief Interpolates bilinearly between the variations at the corners
+ * of a cell.
+ *
+ * Near the magnetic poles the corners can differ by more than 180
+ * degrees, so they are taken relative to the first corner, by the
+ * shorter way round.
+ *
+ * @param corners Variations in degrees at the south-west, south-east,
+ * north-west and north-east corners.
+ * @param fx Fraction of the way east across the cell.
+ * @param fy Fraction of the way north across the cell.
+ * @return Variation in degrees, within (-180, 180].
+ */
+float InterpolateVariation(const float corners[4], float fx, float fy) {
+  float se = WrapDegrees(corners[1] - corners[0]);
+  float nw = WrapDegrees(corners[2] - corners[0]);
+  float ne = WrapDegrees(corners[3] - corners[0]);
+  float south = se * fx;
+  float north = nw + (ne - nw) * fx;
+  return WrapDegrees(corners[0] + south + (north - south) * fy);
+}  // end InterpolateVariation()
+
+}  // namespace sensesp
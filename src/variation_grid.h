@@ -0,0 +1,64 @@
+/** @file variation_grid.h
+ *  @brief Format of the magnetic variation grid, and interpolation in it.
+ *
+ * This file does not depend on Arduino or SensESP, so that the same
+ * definitions are used by the on-device TrueHeading and by the host
+ * tool that generates grids from World Magnetic Model coefficients.
+ */
+
+#ifndef variation_grid_H_
+#define variation_grid_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sensesp {
+
+/**
+ * A variation grid holds the magnetic variation (declination) at points
+ * spaced step_deg apart in latitude and longitude, at the model epoch,
+ * and its annual rate of change. It is written by tools/wmm_grid.cpp and
+ * read from the filesystem on the device.
+ *
+ * Layout, little-endian: a VariationGridHeader, then lat_count rows of
+ * lon_count VariationGridPoint, starting at (lat_min_deg, lon_min_deg),
+ * latitude increasing by row and longitude by column. A 5 degree global
+ * grid is 37 x 73 points, about 11 kB.
+ */
+struct VariationGridHeader {
+  char magic[4];         ///< "MVG1"
+  uint16_t version;      ///< format version, currently 1
+  uint16_t lat_count;    ///< number of rows
+  uint16_t lon_count;    ///< number of columns
+  int16_t lat_min_deg;   ///< latitude of the first row
+  int16_t lon_min_deg;   ///< longitude of the first column
+  uint16_t step_deg;     ///< spacing of rows and columns, in degrees
+  float epoch;           ///< decimal year the variations are for
+};
+
+/// Variation at one point of the grid
+struct VariationGridPoint {
+  int16_t variation_cdeg;      ///< east positive, in 0.01 degree
+  int16_t annual_change_cdeg;  ///< change per year, in 0.01 degree
+};
+
+/// Location of a position within the grid
+struct VariationGridCell {
+  uint16_t row;  ///< row of the cell's south-west corner
+  uint16_t col;  ///< column of the cell's south-west corner
+  float fy;      ///< fraction of the way north across the cell, 0 to 1
+  float fx;      ///< fraction of the way east across the cell, 0 to 1
+};
+
+bool IsValidVariationGrid(const VariationGridHeader& header,
+                          size_t file_size);
+bool FindVariationGridCell(const VariationGridHeader& header,
+                           float latitude, float longitude,
+                           VariationGridCell* cell);
+size_t VariationGridPointOffset(const VariationGridHeader& header,
+                                uint16_t row, uint16_t col);
+float InterpolateVariation(const float corners[4], float fx, float fy);
+
+}  // namespace sensesp
+
+#endif  // variation_grid_H_
@@ -0,0 +1,444 @@
+/** @file vibration_monitor.cpp
+ *  @brief Captures bursts of accelerometer samples at a high rate, and
+ *  reports their spectrum.
+ */
+
+#include "vibration_monitor.h"
+
+#include <Wire.h>
+
+#include "config_schema.h"
+#include "fft_radix2.h"
+#include "sensesp.h"
+
+namespace sensesp {
+
+#define CONFIG_KEY_INTERVAL "interval"
+#define CONFIG_KEY_BAND_EDGE_1 "band_edge_1"
+#define CONFIG_KEY_BAND_EDGE_2 "band_edge_2"
+#define CONFIG_KEY_BAND_EDGE_3 "band_edge_3"
+
+// FXOS8700 registers and bits used for a burst
+static const uint8_t kRegStatus = 0x00;  ///< F_STATUS while FIFO is on
+static const uint8_t kRegOutXMsb = 0x01;
+static const uint8_t kRegFSetup = 0x09;
+static const uint8_t kRegXyzDataCfg = 0x0E;
+static const uint8_t kRegCtrlReg1 = 0x2A;
+static const uint8_t kRegMCtrlReg1 = 0x5B;
+static const uint8_t kCtrlReg1Active = 0x01;
+static const uint8_t kCtrlReg1LowNoise = 0x04;
+static const uint8_t kMCtrlReg1Hms = 0x03;   ///< 0 for accelerometer only
+static const uint8_t kFSetupCircular = 0x40;
+static const uint8_t kFStatusOverflow = 0x80;
+static const uint8_t kFStatusCount = 0x3F;
+
+/// Most samples read per I2C transaction, within the Wire buffer
+static const uint kSamplesPerRead = 20;
+/// Samples dropped after switching rate, while the output settles
+static const uint kSettlingSamples = 8;
+/// Slack allowed beyond the burst's nominal duration before giving up
+static const uint32_t kCaptureSlackMs = 250;
+/// Mean square of the Hann window, by which windowed power is scaled
+static const float kHannPower = 0.375;
+
+/**
+ * @brief Constructor allocates the buffers for a burst.
+ *
+ * @param orientation_sensor Pointer to the physical sensor's interface.
+ * @param accel_i2c_addr I2C address of the FXOS8700.
+ * @param sample_count Samples per burst. Rounded down to a power of two,
+ * at least 16. Each sample takes 16 bytes of buffers.
+ * @param sample_rate_hz Sampling rate of a burst: 800, 400, 200 or 100.
+ * Other rates are rounded down to one of these. The highest frequency
+ * resolved is half of this.
+ * @param interval_s Interval between bursts, in seconds.
+ * @param config_path RESTful path by which the interval and bands can
+ * be configured.
+ */
+VibrationMonitor::VibrationMonitor(OrientationSensor* orientation_sensor,
+                                   uint8_t accel_i2c_addr, uint sample_count,
+                                   uint sample_rate_hz, uint interval_s,
+                                   String config_path)
+    : Sensor(config_path),
+      orientation_sensor_{orientation_sensor},
+      i2c_addr_{accel_i2c_addr},
+      interval_s_{interval_s},
+      count_{0},
+      discard_{0},
+      accel_per_count_{0.0},
+      saved_ctrl_reg1_{0},
+      saved_m_ctrl_reg1_{0},
+      saved_f_setup_{0},
+      is_capture_requested_{false},
+      is_capturing_{false},
+      capture_start_ms_{0},
+      poll_{NULL},
+      scheduler_{NULL} {
+  sample_count_ = 16;
+  while (sample_count_ * 2 <= sample_count) {
+    sample_count_ *= 2;
+  }
+  // CTRL_REG1 DR field, accelerometer only: 0 is 800 Hz, halving per step
+  rate_bits_ = 0;
+  sample_rate_hz_ = 800;
+  while (sample_rate_hz_ > sample_rate_hz && rate_bits_ < 3) {
+    sample_rate_hz_ /= 2;
+    rate_bits_++;
+  }
+  band_edges_[0] = 0.0;
+  band_edges_[1] = sample_rate_hz_ / 80.0;  // 10 Hz at 800 Hz
+  band_edges_[2] = sample_rate_hz_ / 16.0;  // 50 Hz
+  band_edges_[3] = sample_rate_hz_ * 3 / 16.0;  // 150 Hz
+  band_edges_[kVibrationBandCount] = sample_rate_hz_ / 2.0;
+  load_configuration();
+
+  samples_.assign(3 * sample_count_, 0);
+  re_.assign(sample_count_, 0.0);
+  im_.assign(sample_count_, 0.0);
+  power_.assign(sample_count_ / 2 + 1, 0.0);
+  memset(&spectrum_, 0, sizeof(spectrum_));
+  orientation_sensor_->attach([this]() { this->OnFusion(); });
+}  // end VibrationMonitor()
+
+/**
+ * @brief Starts periodic bursts.
+ *
+ * The start() function is inherited from sensesp::Sensor, and is
+ * automatically called when the SensESP app starts.
+ */
+void VibrationMonitor::start() {
+  scheduler_.Start(interval_s_ * 1000, [this]() { this->RequestCapture(); });
+}
+
+/**
+ * @brief Asks for a burst to start just after the next fusion run.
+ */
+void VibrationMonitor::RequestCapture(void) { is_capture_requested_ = true; }
+
+/**
+ * @brief Starts a requested burst. Called after every fusion run, so
+ * the burst has the whole time until the next one to get going.
+ */
+void VibrationMonitor::OnFusion(void) {
+  if (!is_capture_requested_ || is_capturing_) {
+    return;
+  }
+  is_capture_requested_ = false;
+  if (!BeginCapture()) {
+    debugE("Vibration: could not set up the accelerometer for a burst");
+    EndCapture(false);
+  }
+}  // end OnFusion()
+
+/**
+ * @brief Suspends fusion and switches the FXOS8700 to a fast,
+ * accelerometer-only rate with its FIFO on.
+ *
+ * @return True if the chip is capturing.
+ */
+bool VibrationMonitor::BeginCapture(void) {
+  orientation_sensor_->set_fusion_suspended(true);
+  uint8_t data_cfg;
+  if (!ReadRegisters(kRegCtrlReg1, &saved_ctrl_reg1_, 1) ||
+      !ReadRegisters(kRegMCtrlReg1, &saved_m_ctrl_reg1_, 1) ||
+      !ReadRegisters(kRegFSetup, &saved_f_setup_, 1) ||
+      !ReadRegisters(kRegXyzDataCfg, &data_cfg, 1)) {
+    return false;  // nothing changed yet
+  }
+  is_capturing_ = true;  // from here, the registers must be restored
+  capture_start_ms_ = millis();
+  count_ = 0;
+  discard_ = kSettlingSamples;
+  // 14-bit counts: 0.244 mg at +-2 g, doubling with each range step
+  accel_per_count_ = 0.000244 * 9.80665 * (1 << (data_cfg & 0x03));
+
+  // registers may only be changed in standby
+  uint8_t ctrl_reg1 = (rate_bits_ << 3) |
+                      (saved_ctrl_reg1_ & kCtrlReg1LowNoise) | kCtrlReg1Active;
+  if (!WriteRegister(kRegCtrlReg1, saved_ctrl_reg1_ & ~kCtrlReg1Active) ||
+      !WriteRegister(kRegMCtrlReg1, saved_m_ctrl_reg1_ & ~kMCtrlReg1Hms) ||
+      !WriteRegister(kRegFSetup, kFSetupCircular) ||
+      !WriteRegister(kRegCtrlReg1, ctrl_reg1)) {
+    return false;
+  }
+  poll_ = ReactESP::app->onTick([this]() { this->PollFifo(); });
+  return true;
+}  // end BeginCapture()
+
+/**
+ * @brief Moves the samples waiting in the FIFO into the burst, ending
+ * the burst when it is full, or abandoning it if samples were lost.
+ *
+ * Called on every pass of the main loop while capturing. The FIFO holds
+ * 32 samples, 40 ms at 800 Hz, which the loop must come round within.
+ */
+void VibrationMonitor::PollFifo(void) {
+  uint8_t status;
+  if (!ReadRegisters(kRegStatus, &status, 1)) {
+    EndCapture(false);
+    return;
+  }
+  if (status & kFStatusOverflow) {
+    debugE("Vibration: FIFO overflowed, burst abandoned");
+    EndCapture(false);
+    return;
+  }
+  uint waiting = status & kFStatusCount;
+  uint8_t raw[kSamplesPerRead * 6];
+  while (waiting > 0) {
+    uint chunk = waiting < kSamplesPerRead ? waiting : kSamplesPerRead;
+    // reads from OUT_X_MSB wrap round to it after each sample's 6 bytes
+    if (!ReadRegisters(kRegOutXMsb, raw, chunk * 6)) {
+      EndCapture(false);
+      return;
+    }
+    for (uint i = 0; i < chunk; i++) {
+      if (discard_ > 0) {
+        discard_--;
+        continue;
+      }
+      if (count_ >= sample_count_) {
+        break;
+      }
+      for (int axis = 0; axis < 3; axis++) {
+        // 14-bit value, left-justified
+        int16_t value = (int16_t)((raw[i * 6 + axis * 2] << 8) |
+                                  raw[i * 6 + axis * 2 + 1]);
+        samples_[count_ * 3 + axis] = value >> 2;
+      }
+      count_++;
+    }
+    waiting -= chunk;
+  }
+  if (count_ >= sample_count_) {
+    EndCapture(true);
+  } else if (millis() - capture_start_ms_ >
+             (sample_count_ + kSettlingSamples) * 1000 / sample_rate_hz_ +
+                 kCaptureSlackMs) {
+    debugE("Vibration: burst timed out with %u samples", count_);
+    EndCapture(false);
+  }
+}  // end PollFifo()
+
+/**
+ * @brief Puts the FXOS8700 back as fusion had it, resumes fusion, and
+ * reports the burst.
+ *
+ * @param is_complete True if the burst holds sample_count_ samples.
+ */
+void VibrationMonitor::EndCapture(bool is_complete) {
+  if (poll_) {
+    poll_->remove();
+    poll_ = NULL;
+  }
+  if (is_capturing_) {
+    // flush the FIFO by turning it off, before restoring fusion's setup
+    bool is_restored =
+        WriteRegister(kRegCtrlReg1, saved_ctrl_reg1_ & ~kCtrlReg1Active) &&
+        WriteRegister(kRegFSetup, 0) &&
+        WriteRegister(kRegFSetup, saved_f_setup_) &&
+        WriteRegister(kRegMCtrlReg1, saved_m_ctrl_reg1_) &&
+        WriteRegister(kRegCtrlReg1, saved_ctrl_reg1_);
+    if (!is_restored) {
+      debugE("Vibration: could not restore the accelerometer");
+    }
+    is_capturing_ = false;
+  }
+  orientation_sensor_->set_fusion_suspended(false);
+
+  spectrum_.is_data_valid = is_complete;
+  if (is_complete) {
+    Analyze();
+  }
+  output = spectrum_;
+  notify();
+}  // end EndCapture()
+
+/**
+ * @brief Computes the spectrum of the burst.
+ *
+ * The one-sided power of bin k, scaled so that it sums to the mean
+ * square of the signal, is 2|X_k|^2 / (N^2 * kHannPower), except at the
+ * Nyquist bin where it isn't doubled. A Hann window spreads a pure tone
+ * over three bins, so the strongest component's RMS sums those three,
+ * and its frequency is refined by a parabola through their magnitudes.
+ */
+void VibrationMonitor::Analyze(void) {
+  size_t n = sample_count_;
+  size_t half = n / 2;
+  for (size_t k = 0; k <= half; k++) {
+    power_[k] = 0.0;
+  }
+  for (int axis = 0; axis < 3; axis++) {
+    float mean = 0.0;
+    for (size_t i = 0; i < n; i++) {
+      re_[i] = samples_[i * 3 + axis] * accel_per_count_;
+      mean += re_[i];
+    }
+    mean /= n;
+    for (size_t i = 0; i < n; i++) {
+      re_[i] -= mean;  // remove gravity and tilt
+      im_[i] = 0.0;
+    }
+    ApplyHannWindow(re_.data(), n);
+    FftInPlace(re_.data(), im_.data(), n);
+    for (size_t k = 0; k <= half; k++) {
+      power_[k] += re_[k] * re_[k] + im_[k] * im_[k];
+    }
+  }
+
+  float scale = 2.0 / ((float)n * n * kHannPower);
+  power_[0] = 0.0;        // the mean was removed
+  power_[half] *= 0.5;    // Nyquist bin isn't mirrored
+  float bin_hz = (float)sample_rate_hz_ / n;
+  float total = 0.0;
+  float band_total[kVibrationBandCount] = {};
+  size_t peak = 1;
+  for (size_t k = 1; k <= half; k++) {
+    float p = power_[k] * scale;
+    power_[k] = p;
+    total += p;
+    float frequency = k * bin_hz;
+    for (int b = 0; b < kVibrationBandCount; b++) {
+      if (frequency >= band_edges_[b] && frequency < band_edges_[b + 1]) {
+        band_total[b] += p;
+        break;
+      }
+    }
+    if (p > power_[peak]) {
+      peak = k;
+    }
+  }
+  if (half * bin_hz >= band_edges_[kVibrationBandCount]) {
+    band_total[kVibrationBandCount - 1] += power_[half];  // upper edge
+  }
+
+  float offset = 0.0;
+  float peak_power = power_[peak];
+  if (peak > 1 && peak < half) {
+    float left = sqrtf(power_[peak - 1]);
+    float centre = sqrtf(power_[peak]);
+    float right = sqrtf(power_[peak + 1]);
+    float curvature = left - 2 * centre + right;
+    if (curvature < 0.0) {
+      offset = 0.5 * (left - right) / curvature;
+    }
+    peak_power += power_[peak - 1] + power_[peak + 1];
+  }
+
+  spectrum_.sample_rate = sample_rate_hz_;
+  spectrum_.rms = sqrtf(total);
+  spectrum_.peak_frequency = (peak + offset) * bin_hz;
+  spectrum_.peak_rms = sqrtf(peak_power);
+  for (int b = 0; b < kVibrationBandCount; b++) {
+    spectrum_.band_edges[b] = band_edges_[b];
+    spectrum_.band_rms[b] = sqrtf(band_total[b]);
+  }
+  spectrum_.band_edges[kVibrationBandCount] =
+      band_edges_[kVibrationBandCount];
+}  // end Analyze()
+
+/**
+ * @brief Reads consecutive registers of the FXOS8700.
+ *
+ * @return True if all count bytes were read.
+ */
+bool VibrationMonitor::ReadRegisters(uint8_t reg, uint8_t* values,
+                                     size_t count) {
+  Wire.beginTransmission(i2c_addr_);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) {  // repeated start
+    return false;
+  }
+  if (Wire.requestFrom(i2c_addr_, (uint8_t)count) != count) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    values[i] = Wire.read();
+  }
+  return true;
+}  // end ReadRegisters()
+
+/**
+ * @brief Writes one register of the FXOS8700.
+ *
+ * @return True if the write was acknowledged.
+ */
+bool VibrationMonitor::WriteRegister(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(i2c_addr_);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}  // end WriteRegister()
+
+/**
+ * @brief Define the format for the VibrationMonitor configuration.
+ */
+static const char SCHEMA_VIBRATION[] PROGMEM = SCHEMA_OBJECT(
+    SCHEMA_NUMBER(CONFIG_KEY_INTERVAL, "Interval",
+                  "Seconds between bursts. Fusion pauses during each")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_BAND_EDGE_1, "Band Edge 1",
+                       "Top of the first band, Hz")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_BAND_EDGE_2, "Band Edge 2",
+                       "Top of the second band, Hz")
+    ", " SCHEMA_NUMBER(CONFIG_KEY_BAND_EDGE_3, "Band Edge 3",
+                       "Top of the third band, Hz. The fourth band goes "
+                       "up to half the sampling rate"));
+
+/// Keys that a configuration of VibrationMonitor holds
+static const char* const kConfigKeysVibration[] = {
+    CONFIG_KEY_INTERVAL, CONFIG_KEY_BAND_EDGE_1, CONFIG_KEY_BAND_EDGE_2,
+    CONFIG_KEY_BAND_EDGE_3};
+
+/**
+ * @brief Get the current configuration and place it in a JSON
+ * object that can then be stored in non-volatile memory.
+ *
+ * @param doc JSON object to contain the configuration parameters
+ * to be updated.
+ */
+void VibrationMonitor::get_configuration(JsonObject& doc) {
+  doc[CONFIG_KEY_INTERVAL] = interval_s_;
+  doc[CONFIG_KEY_BAND_EDGE_1] = band_edges_[1];
+  doc[CONFIG_KEY_BAND_EDGE_2] = band_edges_[2];
+  doc[CONFIG_KEY_BAND_EDGE_3] = band_edges_[3];
+}  // end get_configuration()
+
+/**
+ * @brief Fetch the JSON format used for holding the configuration.
+ */
+String VibrationMonitor::get_config_schema() {
+  return FPSTR(SCHEMA_VIBRATION);
+}
+
+/**
+ * @brief Use the values stored in JSON object config to update
+ * the appropriate member variables.
+ *
+ * @param config JSON object containing the configuration parameters
+ * to be updated.
+ * @return True if successful; False if a parameter could not be found,
+ * the interval is 0, or the band edges don't increase within
+ * (0, half the sampling rate).
+ */
+bool VibrationMonitor::set_configuration(const JsonObject& config) {
+  if (!ContainsAllKeys(config, kConfigKeysVibration)) {
+    return false;
+  }
+  uint interval_s = config[CONFIG_KEY_INTERVAL];
+  float edges[3] = {config[CONFIG_KEY_BAND_EDGE_1],
+                    config[CONFIG_KEY_BAND_EDGE_2],
+                    config[CONFIG_KEY_BAND_EDGE_3]};
+  if (0 == interval_s || edges[0] <= 0.0 || edges[1] <= edges[0] ||
+      edges[2] <= edges[1] || edges[2] >= band_edges_[kVibrationBandCount]) {
+    return false;
+  }
+  for (int b = 0; b < 3; b++) {
+    band_edges_[b + 1] = edges[b];
+  }
+  interval_s_ = interval_s;
+  scheduler_.SetInterval(interval_s_ * 1000);  // re-arms if running
+  return true;
+}  // end set_configuration()
+
+}  // namespace sensesp
@@ -0,0 +1,98 @@
+/** @file vibration_monitor.h
+ *  @brief Captures bursts of accelerometer samples at a high rate, and
+ *  reports their spectrum.
+ */
+
+#ifndef vibration_monitor_H_
+#define vibration_monitor_H_
+
+#include <vector>
+
+#include <ReactESP.h>
+
+#include "orientation_sensor.h"
+#include "report_scheduler.h"
+#include "sensesp/sensors/sensor.h"
+#include "signalk_orientation.h"
+
+namespace sensesp {
+
+/**
+ * @brief VibrationMonitor watches for changes in vibration, e.g. of an
+ * engine whose mounts or shaft are wearing, from the FXOS8700
+ * accelerometer.
+ *
+ * Fusion samples the accelerometer far too slowly to see engine
+ * vibration, so every interval_s seconds the monitor borrows the
+ * FXOS8700 for one burst:
+ * - just after a fusion run, fusion is suspended and the chip's
+ *   registers are saved;
+ * - the chip is switched to accelerometer-only at sample_rate_hz, with
+ *   its FIFO on;
+ * - the FIFO is emptied on each pass of the main loop until sample_count
+ *   samples are in, so the rest of the program keeps running;
+ * - the registers are restored and fusion resumed.
+ * Fusion and the burst never run at once. A burst of 256 samples at
+ * 800 Hz suspends fusion for about 0.35 s. The periodic outputs send
+ * nothing, or attitude marked invalid, until fusion resumes. The gyro
+ * isn't read during the gap either, so a turn made in it is only taken
+ * up as the filter's magnetometer correction catches up afterwards.
+ *
+ * Each axis has its mean removed, is windowed and transformed in place,
+ * and the power of the three axes is summed. The result gives the
+ * overall RMS acceleration, the frequency and RMS of the strongest
+ * component, and the RMS in each of kVibrationBandCount bands. All
+ * buffers are allocated in the constructor.
+ *
+ * The accelerometer's full-scale range is left as fusion set it.
+ */
+class VibrationMonitor : public VibrationSpectrumProducer,
+                         public sensesp::Sensor {
+ public:
+  VibrationMonitor(OrientationSensor* orientation_sensor,
+                   uint8_t accel_i2c_addr, uint sample_count = 256,
+                   uint sample_rate_hz = 800, uint interval_s = 600,
+                   String config_path = "");
+  void start() override final;  ///< starts periodic captures
+
+ private:
+  void RequestCapture(void);  ///< asks for a burst after the next fusion run
+  void OnFusion(void);        ///< starts a requested burst
+  bool BeginCapture(void);
+  void PollFifo(void);
+  void EndCapture(bool is_complete);
+  void Analyze(void);
+  bool ReadRegisters(uint8_t reg, uint8_t* values, size_t count);
+  bool WriteRegister(uint8_t reg, uint8_t value);
+  virtual void get_configuration(JsonObject& doc) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual String get_config_schema() override;
+  OrientationSensor* orientation_sensor_;  ///< sensor to suspend
+  uint8_t i2c_addr_;        ///< I2C address of the FXOS8700
+  uint sample_count_;       ///< samples per burst, a power of two
+  uint sample_rate_hz_;     ///< 800, 400, 200 or 100
+  uint8_t rate_bits_;       ///< CTRL_REG1 DR bits for sample_rate_hz_
+  uint interval_s_;         ///< interval between bursts
+  float band_edges_[kVibrationBandCount + 1];  ///< in Hz
+  std::vector<int16_t> samples_;  ///< x,y,z of each sample of the burst
+  std::vector<float> re_;         ///< FFT buffer, real parts
+  std::vector<float> im_;         ///< FFT buffer, imaginary parts
+  std::vector<float> power_;      ///< power summed over axes, per bin
+  uint count_;              ///< samples captured so far
+  uint discard_;            ///< samples still to drop while settling
+  float accel_per_count_;   ///< m/s^2 per count at the current range
+  uint8_t saved_ctrl_reg1_;     ///< registers as fusion set them
+  uint8_t saved_m_ctrl_reg1_;
+  uint8_t saved_f_setup_;
+  bool is_capture_requested_;   ///< true if a burst is due
+  bool is_capturing_;           ///< true while the chip is borrowed
+  uint32_t capture_start_ms_;   ///< millis() when the burst began
+  reactesp::TickReaction* poll_;  ///< empties the FIFO while capturing
+  ReportScheduler scheduler_;     ///< runs RequestCapture() every interval_s_
+  VibrationSpectrum spectrum_;  ///< result of the latest burst
+
+};  // end class VibrationMonitor
+
+}  // namespace sensesp
+
+#endif  // vibration_monitor_H_
@@ -0,0 +1,79 @@
+/** @file arena_benchmark.cpp
+ *  @brief Host benchmark of SerializationArena against malloc()/free().
+ *
+ * Build on a desktop machine with e.g.
+ *   g++ -O2 -I../src -o arena_benchmark arena_benchmark.cpp \
+ *       ../src/serialization_arena.cpp
+ *
+ * Replays the document allocations of one emission cycle of the
+ * all-sensors example - one memory pool per as_signalk(), sized as in
+ * signalk_output.h - many times over, first with malloc()/free() as
+ * DynamicJsonDocument does and then with SerializationArena. The text
+ * Strings are left out, as both variants allocate them the same way.
+ * A desktop allocator is much faster than the ESP32's, so the ratio
+ * rather than the absolute times is what carries over.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "serialization_arena.h"
+
+using namespace sensesp;
+
+namespace {
+
+/// Pool sizes requested by the serializers in one cycle
+const size_t kCycle[] = {
+    1024, 1024, 192,  // heading compass and magnetic, attitude
+    192,  192,  192,  // predicted, resampled attitude, and coalesced
+    1024, 1024, 1024, 1024, 1024,  // rates, acceleration, temperature
+    1024, 1024, 1024, 1024, 1024, 1024, 1024,  // calibration values
+    320,  256,  256,  // magnetic calibration, latency, heap
+};
+const size_t kCycleLength = sizeof(kCycle) / sizeof(kCycle[0]);
+const int kCycles = 2000000;
+
+/// Stands in for filling the document, so the memory is really used
+inline void Fill(void* pool, size_t size) {
+  memset(pool, 0x5A, size < 96 ? size : 96);
+}
+
+template <typename Allocate, typename Deallocate>
+double TimeCycles(Allocate allocate, Deallocate deallocate) {
+  volatile uint8_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int cycle = 0; cycle < kCycles; cycle++) {
+    for (size_t i = 0; i < kCycleLength; i++) {
+      void* pool = allocate(kCycle[i]);
+      Fill(pool, kCycle[i]);
+      sink = sink + ((uint8_t*)pool)[0];
+      deallocate(pool);
+    }
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return seconds * 1e9 / kCycles;
+}
+
+}  // namespace
+
+int main() {
+  double heap_ns = TimeCycles([](size_t size) { return malloc(size); },
+                              [](void* ptr) { free(ptr); });
+  double arena_ns =
+      TimeCycles([](size_t size) { return SerializationArena::Allocate(size); },
+                 [](void* ptr) { SerializationArena::Deallocate(ptr); });
+  printf("%zu documents per cycle, %d cycles\n", kCycleLength, kCycles);
+  printf("malloc/free: %.1f ns per cycle\n", heap_ns);
+  printf("arena:       %.1f ns per cycle (%.1fx), %u fallbacks, "
+         "high water mark %zu of %zu bytes\n",
+         arena_ns, heap_ns / arena_ns,
+         (unsigned)SerializationArena::get_fallback_count(),
+         SerializationArena::get_high_water_mark(), SerializationArena::kSize);
+  return 0;
+}
@@ -0,0 +1,152 @@
+/** @file boot_timing.cpp
+ *  @brief Host tool that summarizes startup profiles reported by
+ *  BootProfiler, comparing warm starts with cold ones.
+ *
+ * Build on a desktop machine (Linux or macOS) with e.g.
+ *   g++ -O2 -o boot_timing boot_timing.cpp
+ *
+ * Collect one profile per restart of the sensor from the Signal K
+ * server, e.g. after each power cycle:
+ *   curl -s http://<server>:3000/signalk/v1/api/vessels/self/orientation/diagnostics/boot/value \
+ *       >> boots.jsonl; echo >> boots.jsonl
+ *
+ * Usage:
+ *   boot_timing [boots.jsonl ...]    (reads stdin if no files are given)
+ *
+ * Each line holds one profile's JSON object. A boot is warm if the
+ * profile has a stateRestored time, i.e. FusionStateStore found a saved
+ * state. For each kind of boot the tool prints the count and the median
+ * and maximum, in seconds since power-on, of:
+ *   fusion valid   when fusion first reported a valid orientation
+ *   heading out    when heading was first available for output: when
+ *                  fusion was valid or, on a warm start, when the app
+ *                  started reporting the restored attitude
+ *   sk connected   when the Signal K connection was made
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// Times of interest from one profile; negative if not reported
+struct Boot {
+  float state_restored;
+  float app_started;
+  float heading_valid;
+  float sk_connected;
+};
+
+/// Times of one measure, over several boots
+struct Series {
+  std::vector<float> values;
+  void Add(float value) {
+    if (value >= 0.0) {
+      values.push_back(value);
+    }
+  }
+};
+
+/**
+ * @brief Reads the number following "key": in a JSON object.
+ *
+ * @return The number, or -1 if the key is missing or null.
+ */
+float ReadNumber(const std::string& line, const char* key) {
+  std::string pattern = std::string("\"") + key + "\"";
+  size_t pos = line.find(pattern);
+  if (pos == std::string::npos) {
+    return -1.0;
+  }
+  pos = line.find(':', pos + pattern.size());
+  if (pos == std::string::npos) {
+    return -1.0;
+  }
+  const char* start = line.c_str() + pos + 1;
+  char* end;
+  float value = strtof(start, &end);
+  return (end == start) ? -1.0 : value;  // null isn't a number
+}
+
+void ReadBoots(FILE* file, std::vector<Boot>* boots) {
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), file) != NULL) {
+    std::string line(buffer);
+    if (line.find('{') == std::string::npos) {
+      continue;
+    }
+    Boot boot;
+    boot.state_restored = ReadNumber(line, "stateRestored");
+    boot.app_started = ReadNumber(line, "appStarted");
+    boot.heading_valid = ReadNumber(line, "headingValid");
+    boot.sk_connected = ReadNumber(line, "skConnected");
+    boots->push_back(boot);
+  }
+}
+
+void PrintSeries(const char* name, Series* series, size_t boot_count) {
+  std::vector<float>& v = series->values;
+  if (v.empty()) {
+    printf("  %-14s never reached\n", name);
+    return;
+  }
+  std::sort(v.begin(), v.end());
+  printf("  %-14s median %6.2f s  max %6.2f s", name, v[v.size() / 2],
+         v.back());
+  if (v.size() < boot_count) {
+    printf("  (not reached in %zu)", boot_count - v.size());
+  }
+  printf("\n");
+}
+
+void Summarize(const char* kind, const std::vector<Boot>& boots, bool warm) {
+  Series fusion_valid, heading_out, sk_connected;
+  size_t count = 0;
+  for (const Boot& boot : boots) {
+    if ((boot.state_restored >= 0.0) != warm) {
+      continue;
+    }
+    count++;
+    fusion_valid.Add(boot.heading_valid);
+    float heading = boot.heading_valid;
+    if (warm && boot.app_started >= 0.0 &&
+        (heading < 0.0 || boot.app_started < heading)) {
+      heading = std::max(boot.app_started, boot.state_restored);
+    }
+    heading_out.Add(heading);
+    sk_connected.Add(boot.sk_connected);
+  }
+  printf("%s boots: %zu\n", kind, count);
+  if (0 == count) {
+    return;
+  }
+  PrintSeries("fusion valid", &fusion_valid, count);
+  PrintSeries("heading out", &heading_out, count);
+  PrintSeries("sk connected", &sk_connected, count);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<Boot> boots;
+  if (argc < 2) {
+    ReadBoots(stdin, &boots);
+  }
+  for (int i = 1; i < argc; i++) {
+    FILE* file = fopen(argv[i], "r");
+    if (NULL == file) {
+      fprintf(stderr, "cannot open %s\n", argv[i]);
+      return 1;
+    }
+    ReadBoots(file, &boots);
+    fclose(file);
+  }
+  Summarize("Cold", boots, false);
+  Summarize("Warm", boots, true);
+  return 0;
+}
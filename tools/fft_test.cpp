@@ -0,0 +1,147 @@
+/** @file fft_test.cpp
+ *  @brief Host tests of the radix-2 FFT used by the vibration monitor.
+ *
+ * Build on a desktop machine with e.g.
+ *   g++ -O2 -I../src -o fft_test fft_test.cpp ../src/fft_radix2.cpp
+ *
+ * Checks the transform of random bursts against a direct DFT. Then puts
+ * tones of known amplitude exactly on a bin, through the Hann window and
+ * the one-sided power scaling of VibrationMonitor::Analyze(), and checks
+ * that the strongest bin is the tone's and that both the overall RMS and
+ * the RMS of the three bins around the peak are amplitude / sqrt(2).
+ * Exits with status 1 if any check fails.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "fft_radix2.h"
+
+using namespace sensesp;
+
+namespace {
+
+const float kHannPower = 0.375;  ///< as in vibration_monitor.cpp
+const size_t kBurstLength = 256;
+const float kSampleRateHz = 800.0;
+
+int failures = 0;
+
+/// Reports a failure if value is further than tolerance from expected
+void Check(const char* what, float value, float expected, float tolerance) {
+  if (fabsf(value - expected) > tolerance) {
+    if (failures < 20) {
+      printf("FAIL %s: got %.7f, expected %.7f (tolerance %.7f)\n", what,
+             value, expected, tolerance);
+    }
+    failures++;
+  }
+}
+
+/// Checks IsPowerOfTwo() on either side of the powers of two from 2
+void TestPowerOfTwo(void) {
+  Check("IsPowerOfTwo(0)", IsPowerOfTwo(0), 0, 0);
+  Check("IsPowerOfTwo(1)", IsPowerOfTwo(1), 0, 0);
+  for (size_t n = 2; n <= 4096; n *= 2) {
+    Check("IsPowerOfTwo(n)", IsPowerOfTwo(n), 1, 0);
+    if (n > 2) {
+      Check("IsPowerOfTwo(n - 1)", IsPowerOfTwo(n - 1), 0, 0);
+      Check("IsPowerOfTwo(n + 1)", IsPowerOfTwo(n + 1), 0, 0);
+    }
+  }
+}  // end TestPowerOfTwo()
+
+/// Compares the FFT of random bursts with a direct DFT in double precision
+void TestAgainstDft(void) {
+  for (size_t n = 2; n <= 512; n *= 2) {
+    std::vector<float> re(n), im(n);
+    std::vector<double> input_re(n), input_im(n);
+    for (size_t i = 0; i < n; i++) {
+      re[i] = input_re[i] = (float)rand() / RAND_MAX - 0.5f;
+      im[i] = input_im[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+    FftInPlace(re.data(), im.data(), n);
+    float tolerance = 1e-5f * n;
+    for (size_t k = 0; k < n; k++) {
+      double sum_re = 0.0;
+      double sum_im = 0.0;
+      for (size_t i = 0; i < n; i++) {
+        double angle = -2.0 * M_PI * (double)((k * i) % n) / n;
+        sum_re += input_re[i] * cos(angle) - input_im[i] * sin(angle);
+        sum_im += input_re[i] * sin(angle) + input_im[i] * cos(angle);
+      }
+      Check("FFT real part", re[k], sum_re, tolerance);
+      Check("FFT imaginary part", im[k], sum_im, tolerance);
+    }
+  }
+}  // end TestAgainstDft()
+
+/**
+ * @brief Checks the peak bin and RMS of a tone on the given bin.
+ *
+ * The spectrum is computed as in VibrationMonitor::Analyze() for one
+ * axis, with a DC offset standing in for gravity that is removed first.
+ */
+void TestTone(size_t bin, float amplitude) {
+  const size_t n = kBurstLength;
+  const size_t half = n / 2;
+  std::vector<float> re(n), im(n, 0.0f);
+  float frequency = bin * kSampleRateHz / n;
+  float mean = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    re[i] = 9.80665f + amplitude * sinf(2.0f * (float)M_PI * frequency * i /
+                                        kSampleRateHz + 0.3f);
+    mean += re[i];
+  }
+  mean /= n;
+  for (size_t i = 0; i < n; i++) {
+    re[i] -= mean;
+  }
+  ApplyHannWindow(re.data(), n);
+  FftInPlace(re.data(), im.data(), n);
+
+  std::vector<float> power(half + 1);
+  float scale = 2.0 / ((float)n * n * kHannPower);
+  for (size_t k = 0; k <= half; k++) {
+    power[k] = (re[k] * re[k] + im[k] * im[k]) * scale;
+  }
+  power[0] = 0.0;
+  power[half] *= 0.5;
+  float total = 0.0;
+  size_t peak = 1;
+  for (size_t k = 1; k <= half; k++) {
+    total += power[k];
+    if (power[k] > power[peak]) {
+      peak = k;
+    }
+  }
+  float peak_power = power[peak];
+  if (peak > 1 && peak < half) {
+    peak_power += power[peak - 1] + power[peak + 1];
+  }
+
+  float rms = amplitude / sqrtf(2.0f);
+  Check("tone peak bin", peak, bin, 0);
+  Check("tone RMS", sqrtf(total), rms, 1e-3f * rms);
+  Check("tone peak RMS", sqrtf(peak_power), rms, 1e-3f * rms);
+}  // end TestTone()
+
+}  // namespace
+
+int main() {
+  srand(1);
+  TestPowerOfTwo();
+  TestAgainstDft();
+  const size_t kBins[] = {2, 5, 16, 40, 77, 126};
+  const float kAmplitudes[] = {0.01f, 0.5f, 3.0f};
+  for (size_t bin : kBins) {
+    for (float amplitude : kAmplitudes) {
+      TestTone(bin, amplitude);
+    }
+  }
+  printf("%d failures\n", failures);
+  return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,239 @@
+/** @file heap_soak.cpp
+ *  @brief Host soak test of the heap use of the Signal K serializers.
+ *
+ * Build on a desktop machine with e.g.
+ *   g++ -O2 -I../src -I../.pio/libdeps/<env>/ArduinoJson/src \
+ *       -o heap_soak heap_soak.cpp ../src/serialization_arena.cpp
+ *
+ * Replays a day of the emissions of the all-sensors example (or the
+ * number of hours given as the only argument) through the same steps as
+ * SKOutput::as_signalk(): a copy of the path, a document from the
+ * SerializationArena holding the path and value, and the text reserved
+ * with measureJson() and serialized into it. Outputs whose values carry
+ * a fusion epoch are instead replayed as SKOutputStruct sends them once
+ * the clock is set: a whole delta, whose update has a timestamp. Documents
+ * and their values have the shapes and sizes of those in
+ * signalk_output.h, and are emitted at the example's intervals.
+ *
+ * Memory for documents is counted by an allocator around ArenaAllocator,
+ * and all other heap allocations (the path and the text) by replacing
+ * operator new. The result is the allocations and bytes per day of each
+ * output, the documents that didn't fit in the arena, and the arena's
+ * high water mark. A desktop's std::string keeps short strings inline,
+ * as the ESP32's Arduino String does only up to 11 characters, so real
+ * path copies allocate somewhat more often than here.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <new>
+#include <string>
+
+#include <ArduinoJson.h>
+
+#include "serialization_arena.h"
+
+using namespace sensesp;
+
+namespace {
+
+bool is_counting = false;  ///< true while an output is serialized
+uint64_t heap_allocations = 0;
+uint64_t heap_bytes = 0;
+uint64_t document_allocations = 0;
+uint64_t document_bytes = 0;
+
+/// Counts the memory requested for documents, then passes it on
+struct CountingArenaAllocator {
+  void* allocate(size_t size) {
+    document_allocations++;
+    document_bytes += size;
+    return arena_.allocate(size);
+  }
+  void deallocate(void* ptr) { arena_.deallocate(ptr); }
+  void* reallocate(void* ptr, size_t size) {
+    document_allocations++;
+    document_bytes += size;
+    return arena_.reallocate(ptr, size);
+  }
+  ArenaAllocator arena_;
+};
+
+typedef BasicJsonDocument<CountingArenaAllocator> SoakJsonDocument;
+
+/// Shape of the value of an output
+enum ValueShape {
+  kNumber,     ///< SKOutputFloat, SKOutputInt, SKOutputBool
+  kAttitude,   ///< SKOutputAttitude: yaw, pitch, roll
+  kMembers,    ///< SKOutputStruct: member_count numbers
+  kSpectrum,   ///< SKOutputVibrationSpectrum: numbers and bands
+};
+
+const int kVibrationBandCount = 4;  ///< as in signalk_orientation.h
+const size_t kUpdateSize = 128;     ///< as SKOutputStruct::kUpdateSize
+
+struct Output {
+  const char* path;
+  ValueShape shape;
+  size_t document_size;  ///< as in signalk_output.h
+  int member_count;      ///< numbers in the value, for kMembers
+  uint32_t interval_ms;  ///< interval between emissions
+  bool is_timestamped;   ///< sent in a delta of its own, with a timestamp
+  uint64_t heap_allocations;
+  uint64_t heap_bytes;
+  uint64_t document_allocations;
+};
+
+/// Outputs of the all-sensors example, at its default intervals, with its
+/// optional vibration monitor enabled
+Output outputs[] = {
+    {"navigation.headingCompass", kNumber, 1024, 1, 100, false, 0, 0, 0},
+    {"navigation.headingMagnetic", kNumber, 1024, 1, 100, false, 0, 0, 0},
+    {"orientation.headingUncertainty", kNumber, 1024, 1, 100, false, 0, 0, 0},
+    {"orientation.smoothed.headingMagnetic",
+     kNumber, 1024, 1, 100, false, 0, 0, 0},
+    {"orientation.smoothed.headingVariance",
+     kNumber, 1024, 1, 100, false, 0, 0, 0},
+    {"navigation.headingTrue", kNumber, 1024, 1, 100, false, 0, 0, 0},
+    {"navigation.attitude", kAttitude, 192, 3, 100, true, 0, 0, 0},
+    {"orientation.resampled.attitude", kAttitude, 192, 3, 100, true, 0, 0, 0},
+    {"orientation.predicted.attitude", kAttitude, 192, 3, 100, true, 0, 0, 0},
+    {"orientation.predicted.headingCompass",
+     kNumber, 1024, 1, 100, false, 0, 0, 0},
+    {"navigation.rateOfTurn", kNumber, 1024, 1, 400, false, 0, 0, 0},
+    {"orientation.diagnostics.magneticDisturbance",
+     kNumber, 1024, 1, 1000, false, 0, 0, 0},
+    {"orientation.calibration.magfit", kNumber, 1024, 1, 3900, false, 0, 0, 0},
+    {"orientation.calibration.magfittrial",
+     kNumber, 1024, 1, 1900, false, 0, 0, 0},
+    {"orientation.calibration.magsolver",
+     kNumber, 1024, 1, 9900, false, 0, 0, 0},
+    {"orientation.calibration.maginclination",
+     kNumber, 1024, 1, 1000, false, 0, 0, 0},
+    {"orientation.calibration.magmagnitude",
+     kNumber, 1024, 1, 1000, false, 0, 0, 0},
+    {"orientation.calibration.magmagnitudetrial",
+     kNumber, 1024, 1, 1000, false, 0, 0, 0},
+    {"orientation.calibration.magnoise",
+     kNumber, 1024, 1, 1000, false, 0, 0, 0},
+    {"orientation.calibration.magvalues",
+     kMembers, 320, 7, 1000, true, 0, 0, 0},
+    {"orientation.diagnostics.attitudeLatency",
+     kMembers, 256, 7, 10000, false, 0, 0, 0},
+    {"orientation.diagnostics.heap", kMembers, 256, 5, 10000, false, 0, 0, 0},
+    {"orientation.diagnostics.coalesced",
+     kNumber, 1024, 1, 10000, false, 0, 0, 0},
+    {"orientation.diagnostics.dropped",
+     kNumber, 1024, 1, 10000, false, 0, 0, 0},
+    {"orientation.anchor.swing", kMembers, 256, 4, 10000, false, 0, 0, 0},
+    {"orientation.vibration", kSpectrum, 640, 4, 600000, false, 0, 0, 0},
+};
+const size_t kOutputCount = sizeof(outputs) / sizeof(outputs[0]);
+const uint32_t kTickMs = 100;  ///< shortest interval of the outputs
+
+/// Serializes one emission of an output, as SKOutput::as_signalk() does
+std::string Serialize(const Output& output, uint32_t tick) {
+  std::string path = output.path;  // get_sk_path() returns a copy
+  SoakJsonDocument json_doc(output.document_size +
+                            (output.is_timestamped ? kUpdateSize : 0));
+  std::string json;
+  JsonObject entry = json_doc.to<JsonObject>();
+  if (output.is_timestamped) {
+    JsonObject update =
+        json_doc.createNestedArray("updates").createNestedObject();
+    update["timestamp"] = (char*)"2026-10-17T12:00:00.000Z";
+    entry = update.createNestedArray("values").createNestedObject();
+  }
+  entry["path"] = path;
+  float x = (tick % 6283) / 1000.0f;  // changing values, as at sea
+  if (kNumber == output.shape) {
+    entry["value"] = x;
+  } else {
+    JsonObject value = entry.createNestedObject("value");
+    if (kAttitude == output.shape) {
+      value["yaw"] = x;
+      value["pitch"] = x / 10.0f;
+      value["roll"] = -x / 5.0f;
+    } else {
+      static const char* const kNames[] = {"a", "b", "c", "d",
+                                           "e", "f", "g", "h"};
+      for (int i = 0; i < output.member_count; i++) {
+        value[kNames[i]] = x * i;
+      }
+      if (kSpectrum == output.shape) {
+        JsonArray bands = value.createNestedArray("bands");
+        for (int i = 0; i < kVibrationBandCount; i++) {
+          JsonObject band = bands.createNestedObject();
+          band["from"] = 50.0f * i;
+          band["to"] = 50.0f * (i + 1);
+          band["rms"] = x / (i + 1);
+        }
+      }
+    }
+  }
+  if (json_doc.overflowed()) {
+    printf("FAIL %s: document size too small\n", output.path);
+  }
+  json.reserve(measureJson(json_doc));  // one allocation for the text
+  serializeJson(json_doc, json);
+  return json;
+}  // end Serialize()
+
+}  // namespace
+
+void* operator new(size_t size) {
+  if (is_counting) {
+    heap_allocations++;
+    heap_bytes += size;
+  }
+  void* ptr = malloc(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+int main(int argc, char* argv[]) {
+  double hours = (argc > 1) ? atof(argv[1]) : 24.0;
+  uint32_t ticks = (uint32_t)(hours * 3600000.0 / kTickMs);
+  size_t text_bytes = 0;
+  for (uint32_t tick = 0; tick < ticks; tick++) {
+    for (size_t i = 0; i < kOutputCount; i++) {
+      Output& output = outputs[i];
+      if ((tick * kTickMs) % output.interval_ms != 0) {
+        continue;
+      }
+      uint64_t allocations = heap_allocations;
+      uint64_t bytes = heap_bytes;
+      uint64_t documents = document_allocations;
+      is_counting = true;
+      text_bytes += Serialize(output, tick).size();
+      is_counting = false;
+      output.heap_allocations += heap_allocations - allocations;
+      output.heap_bytes += heap_bytes - bytes;
+      output.document_allocations += document_allocations - documents;
+    }
+  }
+
+  double days = hours / 24.0;
+  printf("%.1f hours replayed, %zu bytes of deltas\n", hours, text_bytes);
+  printf("%-46s %12s %12s %12s\n", "per day", "heap allocs", "heap bytes",
+         "documents");
+  for (size_t i = 0; i < kOutputCount; i++) {
+    const Output& output = outputs[i];
+    printf("%-46s %12.0f %12.0f %12.0f\n", output.path,
+           output.heap_allocations / days, output.heap_bytes / days,
+           output.document_allocations / days);
+  }
+  printf("%-46s %12.0f %12.0f %12.0f\n", "total", heap_allocations / days,
+         heap_bytes / days, document_allocations / days);
+  printf("documents not fitting the arena: %u; high water mark %zu of %zu "
+         "bytes\n",
+         (unsigned)SerializationArena::get_fallback_count(),
+         SerializationArena::get_high_water_mark(), SerializationArena::kSize);
+  return (0 == SerializationArena::get_fallback_count()) ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+/** @file motion_log_decode.cpp
+ *  @brief Host tool that decompresses motion logs recorded by
+ *  MotionLogRecorder into CSV.
+ *
+ * Build on a desktop machine with e.g.
+ *   g++ -O2 -I../src -o motion_log_decode motion_log_decode.cpp \
+ *       ../src/motion_log_codec.cpp ../src/orientation_sample.cpp
+ *
+ * Usage:
+ *   motion_log_decode mlog0.bin [mlog1.bin ...] > passage.csv
+ *   motion_log_decode --benchmark mlog0.bin
+ *
+ * Blocks are located by their sync marker and verified by CRC, so a
+ * damaged region of a file only loses the blocks it touches.
+ * --benchmark decodes the files repeatedly without output and reports
+ * the decoding rate, in MB/s of uncompressed samples.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "motion_log_codec.h"
+
+using namespace sensesp;
+
+namespace {
+
+/// Reads a whole file into memory, returning false on failure.
+bool ReadFile(const char* name, std::vector<uint8_t>* contents) {
+  FILE* file = fopen(name, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Unable to open %s\n", name);
+    return false;
+  }
+  uint8_t buffer[65536];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents->insert(contents->end(), buffer, buffer + length);
+  }
+  fclose(file);
+  return true;
+}  // end ReadFile()
+
+/**
+ * Decodes every valid block in data. If csv is non-NULL, writes one
+ * line per sample to it. Returns the number of samples decoded, and
+ * counts the bytes skipped over as not belonging to a valid block.
+ */
+size_t DecodeLog(const std::vector<uint8_t>& data, FILE* csv,
+                 size_t* skipped) {
+  PackedOrientationSample packed[kMotionLogBlockSamples];
+  size_t total = 0;
+  size_t used = 0;
+  size_t offset = 0;
+  while (offset < data.size()) {
+    MotionLogBlockInfo info;
+    size_t count = DecodeMotionLogBlock(data.data() + offset,
+                                        data.size() - offset, packed,
+                                        kMotionLogBlockSamples, &info);
+    if (0 == count) {
+      offset = FindMotionLogBlock(data.data(), data.size(), offset + 1);
+      continue;
+    }
+    if (csv != NULL) {
+      // Without wall-clock times, fall back on the samples' own dt
+      bool is_timed = (0 != MotionLogSampleTime(info, 0));
+      double time_s = info.first_sk_time_ms / 1000.0;
+      for (size_t i = 0; i < count; i++) {
+        OrientationSample s;
+        DecodeOrientationSample(packed[i], &s);
+        if (is_timed) {
+          time_s = MotionLogSampleTime(info, i) / 1000.0;
+        } else if (i > 0) {
+          time_s += s.dt;
+        }
+        fprintf(csv,
+                "%.3f,%u,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f\n",
+                time_s, (unsigned)MotionLogSampleSequence(info, i),
+                s.is_data_valid ? 1 : 0, s.yaw * 57.29578f,
+                s.pitch * 57.29578f, s.roll * 57.29578f,
+                s.rate_of_turn * 57.29578f, s.rate_of_pitch * 57.29578f,
+                s.rate_of_roll * 57.29578f, s.accel_x, s.accel_y, s.accel_z);
+      }
+    }
+    total += count;
+    used += info.block_size;
+    offset += info.block_size;
+  }
+  if (skipped != NULL) {
+    *skipped = data.size() - used;
+  }
+  return total;
+}  // end DecodeLog()
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool benchmark = (argc > 1) && (0 == strcmp(argv[1], "--benchmark"));
+  int first_file = benchmark ? 2 : 1;
+  if (argc <= first_file) {
+    fprintf(stderr, "usage: %s [--benchmark] log.bin [log.bin ...]\n",
+            argv[0]);
+    return 1;
+  }
+  std::vector<std::vector<uint8_t> > logs;
+  for (int i = first_file; i < argc; i++) {
+    logs.push_back(std::vector<uint8_t>());
+    if (!ReadFile(argv[i], &logs.back())) {
+      return 1;
+    }
+  }
+
+  if (benchmark) {
+    size_t compressed = 0;
+    size_t samples = 0;
+    const int kRepeats = 50;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < kRepeats; r++) {
+      samples = 0;
+      compressed = 0;
+      for (const std::vector<uint8_t>& log : logs) {
+        samples += DecodeLog(log, NULL, NULL);
+        compressed += log.size();
+      }
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    double raw_mb = samples * sizeof(PackedOrientationSample) / 1e6;
+    printf("%zu samples, %zu bytes compressed (%.2f bytes/sample)\n",
+           samples, compressed, samples ? (double)compressed / samples : 0);
+    printf("decoded %.1f MB/s of samples\n", raw_mb * kRepeats / seconds);
+    return 0;
+  }
+
+  printf("time_s,sequence,valid,yaw_deg,pitch_deg,roll_deg,"
+         "yaw_rate_deg_s,pitch_rate_deg_s,roll_rate_deg_s,"
+         "accel_x,accel_y,accel_z\n");
+  for (size_t i = 0; i < logs.size(); i++) {
+    size_t skipped = 0;
+    DecodeLog(logs[i], stdout, &skipped);
+    if (skipped > 0) {
+      fprintf(stderr, "%s: %zu bytes not part of a valid block\n",
+              argv[first_file + i], skipped);
+    }
+  }
+  return 0;
+}
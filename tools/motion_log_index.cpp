@@ -0,0 +1,422 @@
+/** @file motion_log_index.cpp
+ *  @brief Host tool that indexes motion logs recorded by MotionLogRecorder
+ *  and finds the blocks matching time and threshold queries.
+ *
+ * Build on a desktop machine (Linux or macOS) with e.g.
+ *   g++ -O2 -I../src -o motion_log_index motion_log_index.cpp \
+ *       ../src/motion_log_codec.cpp ../src/orientation_sample.cpp
+ *
+ * Usage:
+ *   motion_log_index [options] log.bin [log.bin ...]
+ *
+ * Options:
+ *   --from TIME         only blocks ending at or after TIME
+ *   --to TIME           only blocks starting at or before TIME
+ *   --roll-above DEG    only blocks where |roll| exceeded DEG
+ *   --pitch-above DEG   only blocks where |pitch| exceeded DEG
+ *   --accel-above G     only blocks where any axis' |acceleration|
+ *                       exceeded G (in g, including gravity on z)
+ *   --samples           print the decoded samples of matching blocks as
+ *                       CSV, rather than one line per block
+ *
+ * TIME is seconds since the Unix epoch, or UTC as YYYY-MM-DDTHH:MM:SS.
+ *
+ * Each log gets a sidecar index, log.bin.idx, holding one IndexEntry per
+ * block with its file offset, time span and the min/max of roll, pitch
+ * and acceleration. It is built by decoding the log once, and rebuilt
+ * whenever the log has changed: its size, its modification time, or the
+ * header of its first block differs from when it was indexed. The
+ * recorder's files have a fixed size once full, so a rotated file can't
+ * be told apart by size alone. Queries memory-map the index and
+ * scan only it, so searching weeks of logs doesn't decode them; only the
+ * matching blocks are decoded, and only if --samples is given.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "motion_log_codec.h"
+
+using namespace sensesp;
+
+namespace {
+
+const char kIndexMagic[4] = {'M', 'L', 'I', 'X'};
+const uint32_t kIndexVersion = 3;
+
+/// Start of an index file
+struct IndexHeader {
+  char magic[4];          ///< "MLIX"
+  uint32_t version;       ///< format version, currently 3
+  uint64_t log_size;      ///< size of the log when indexed
+  uint64_t log_mtime_ns;  ///< modification time of the log when indexed
+  uint32_t first_block_hash;  ///< FirstBlockHash() of the log when indexed
+  uint32_t entry_size;    ///< sizeof(IndexEntry)
+  uint32_t entry_count;   ///< number of entries that follow
+  uint32_t reserved;      ///< zero
+};
+
+/// Summary of one block of the log. Angles are in 0.01 degree and
+/// acceleration in milli-g, as in PackedOrientationSample.
+struct IndexEntry {
+  uint64_t offset;          ///< file offset of the block
+  uint64_t start_ms;        ///< wall-clock time of first sample, or 0
+  uint32_t duration_ms;     ///< time from first to last sample
+  uint32_t first_sequence;  ///< fusion sequence number of first sample
+  uint16_t sample_count;    ///< samples in the block
+  int16_t roll_min, roll_max;
+  int16_t pitch_min, pitch_max;
+  int16_t accel_min[3], accel_max[3];
+};
+
+/// A memory-mapped, read-only file
+class MappedFile {
+ public:
+  MappedFile() : data_{NULL}, size_{0}, mtime_ns_{0} {}
+  ~MappedFile() {
+    if (data_ != NULL) {
+      munmap((void*)data_, size_);
+    }
+  }
+  bool Open(const std::string& name) {
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size == 0)) {
+      close(fd);
+      return false;
+    }
+    size_ = st.st_size;
+#ifdef __APPLE__
+    mtime_ns_ = (uint64_t)st.st_mtimespec.tv_sec * 1000000000 +
+                st.st_mtimespec.tv_nsec;
+#else
+    mtime_ns_ = (uint64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    void* mapped = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      size_ = 0;
+      return false;
+    }
+    data_ = (const uint8_t*)mapped;
+    return true;
+  }
+  const uint8_t* data(void) const { return data_; }
+  size_t size(void) const { return size_; }
+  uint64_t mtime_ns(void) const { return mtime_ns_; }  ///< modification time
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  uint64_t mtime_ns_;
+};
+
+/// FNV-1a hash of the header of the first block in the log, or 0 if none
+uint32_t FirstBlockHash(const MappedFile& log) {
+  size_t offset = FindMotionLogBlock(log.data(), log.size(), 0);
+  if (offset >= log.size()) {
+    return 0;
+  }
+  size_t end = std::min(log.size(), offset + kMotionLogHeaderSize);
+  uint32_t hash = 2166136261u;
+  for (size_t i = offset; i < end; i++) {
+    hash = (hash ^ log.data()[i]) * 16777619u;
+  }
+  return hash;
+}  // end FirstBlockHash()
+
+/// Query given on the command line. Thresholds < 0 are not applied.
+struct Query {
+  uint64_t from_ms = 0;
+  uint64_t to_ms = UINT64_MAX;
+  int roll_above_cdeg = -1;
+  int pitch_above_cdeg = -1;
+  int accel_above_mg = -1;
+  bool print_samples = false;
+};
+
+/// Parses seconds since the epoch or YYYY-MM-DDTHH:MM:SS (UTC) into ms
+bool ParseTime(const char* text, uint64_t* ms) {
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  const char* rest = strptime(text, "%Y-%m-%dT%H:%M:%S", &tm);
+  if ((rest != NULL) && (*rest == '\0' || *rest == 'Z')) {
+    *ms = (uint64_t)timegm(&tm) * 1000;
+    return true;
+  }
+  char* end;
+  double seconds = strtod(text, &end);
+  if ((end == text) || (*end != '\0') || (seconds < 0)) {
+    return false;
+  }
+  *ms = (uint64_t)(seconds * 1000.0);
+  return true;
+}  // end ParseTime()
+
+void FormatTime(uint64_t ms, char* out, size_t size) {
+  time_t seconds = ms / 1000;
+  struct tm tm;
+  gmtime_r(&seconds, &tm);
+  size_t length = strftime(out, size, "%Y-%m-%dT%H:%M:%S", &tm);
+  snprintf(out + length, size - length, ".%03uZ", (unsigned)(ms % 1000));
+}  // end FormatTime()
+
+/// Decodes the whole log once to build its index entries
+std::vector<IndexEntry> BuildIndex(const MappedFile& log) {
+  std::vector<IndexEntry> entries;
+  PackedOrientationSample samples[kMotionLogBlockSamples];
+  size_t offset = FindMotionLogBlock(log.data(), log.size(), 0);
+  while (offset < log.size()) {
+    MotionLogBlockInfo info;
+    size_t count =
+        DecodeMotionLogBlock(log.data() + offset, log.size() - offset,
+                             samples, kMotionLogBlockSamples, &info);
+    if (0 == count) {
+      offset = FindMotionLogBlock(log.data(), log.size(), offset + 1);
+      continue;
+    }
+    IndexEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.offset = offset;
+    entry.start_ms = info.first_sk_time_ms;
+    entry.first_sequence = info.first_sequence;
+    entry.sample_count = count;
+    const PackedOrientationSample& first = samples[0];
+    entry.roll_min = entry.roll_max = first.roll_cdeg;
+    entry.pitch_min = entry.pitch_max = first.pitch_cdeg;
+    const int16_t first_accel[3] = {first.accel_x_mg, first.accel_y_mg,
+                                    first.accel_z_mg};
+    for (int axis = 0; axis < 3; axis++) {
+      entry.accel_min[axis] = entry.accel_max[axis] = first_accel[axis];
+    }
+    if (0 != MotionLogSampleTime(info, 0)) {
+      entry.duration_ms =
+          (uint32_t)(info.last_sk_time_ms - info.first_sk_time_ms);
+    }
+    for (size_t i = 1; i < count; i++) {
+      const PackedOrientationSample& s = samples[i];
+      if (0 == MotionLogSampleTime(info, 0)) {
+        entry.duration_ms += s.dt_ms;  // no wall-clock times to go on
+      }
+      entry.roll_min = std::min(entry.roll_min, s.roll_cdeg);
+      entry.roll_max = std::max(entry.roll_max, s.roll_cdeg);
+      entry.pitch_min = std::min(entry.pitch_min, s.pitch_cdeg);
+      entry.pitch_max = std::max(entry.pitch_max, s.pitch_cdeg);
+      const int16_t accel[3] = {s.accel_x_mg, s.accel_y_mg, s.accel_z_mg};
+      for (int axis = 0; axis < 3; axis++) {
+        entry.accel_min[axis] = std::min(entry.accel_min[axis], accel[axis]);
+        entry.accel_max[axis] = std::max(entry.accel_max[axis], accel[axis]);
+      }
+    }
+    entries.push_back(entry);
+    offset += info.block_size;
+  }
+  return entries;
+}  // end BuildIndex()
+
+/// Writes the index of log, returning false on failure
+bool WriteIndex(const std::string& index_name, const MappedFile& log,
+                const std::vector<IndexEntry>& entries) {
+  FILE* file = fopen(index_name.c_str(), "wb");
+  if (file == NULL) {
+    return false;
+  }
+  IndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kIndexMagic, 4);
+  header.version = kIndexVersion;
+  header.log_size = log.size();
+  header.log_mtime_ns = log.mtime_ns();
+  header.first_block_hash = FirstBlockHash(log);
+  header.entry_size = sizeof(IndexEntry);
+  header.entry_count = entries.size();
+  bool ok = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+            (entries.empty() ||
+             (fwrite(entries.data(), sizeof(IndexEntry), entries.size(),
+                     file) == entries.size()));
+  return (fclose(file) == 0) && ok;
+}  // end WriteIndex()
+
+/// True if the mapped index is complete and describes the log as it is now
+bool IsIndexCurrent(const MappedFile& index, const MappedFile& log) {
+  if (index.size() < sizeof(IndexHeader)) {
+    return false;
+  }
+  const IndexHeader* header = (const IndexHeader*)index.data();
+  return (0 == memcmp(header->magic, kIndexMagic, 4)) &&
+         (header->version == kIndexVersion) &&
+         (header->entry_size == sizeof(IndexEntry)) &&
+         (header->log_size == log.size()) &&
+         (header->log_mtime_ns == log.mtime_ns()) &&
+         (header->first_block_hash == FirstBlockHash(log)) &&
+         (index.size() ==
+          sizeof(IndexHeader) + (size_t)header->entry_count *
+                                    sizeof(IndexEntry));
+}  // end IsIndexCurrent()
+
+bool Matches(const IndexEntry& e, const Query& q) {
+  if ((e.start_ms + e.duration_ms < q.from_ms) || (e.start_ms > q.to_ms)) {
+    return false;
+  }
+  if ((q.roll_above_cdeg >= 0) && (e.roll_max <= q.roll_above_cdeg) &&
+      (e.roll_min >= -q.roll_above_cdeg)) {
+    return false;
+  }
+  if ((q.pitch_above_cdeg >= 0) && (e.pitch_max <= q.pitch_above_cdeg) &&
+      (e.pitch_min >= -q.pitch_above_cdeg)) {
+    return false;
+  }
+  if (q.accel_above_mg >= 0) {
+    bool exceeded = false;
+    for (int axis = 0; axis < 3; axis++) {
+      exceeded |= (e.accel_max[axis] > q.accel_above_mg) ||
+                  (e.accel_min[axis] < -q.accel_above_mg);
+    }
+    if (!exceeded) {
+      return false;
+    }
+  }
+  return true;
+}  // end Matches()
+
+void PrintBlock(const char* log_name, const IndexEntry& e) {
+  char start[32];
+  char end[32];
+  FormatTime(e.start_ms, start, sizeof(start));
+  FormatTime(e.start_ms + e.duration_ms, end, sizeof(end));
+  printf("%s,%llu,%s,%s,%u,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+         log_name, (unsigned long long)e.offset, start, end, e.sample_count,
+         e.roll_min / 100.0, e.roll_max / 100.0, e.pitch_min / 100.0,
+         e.pitch_max / 100.0, e.accel_min[0] / 1000.0,
+         e.accel_max[0] / 1000.0, e.accel_min[1] / 1000.0,
+         e.accel_max[1] / 1000.0, e.accel_min[2] / 1000.0,
+         e.accel_max[2] / 1000.0);
+}  // end PrintBlock()
+
+void PrintSamples(const MappedFile& log, const IndexEntry& e) {
+  PackedOrientationSample packed[kMotionLogBlockSamples];
+  MotionLogBlockInfo info;
+  size_t count = DecodeMotionLogBlock(log.data() + e.offset,
+                                      log.size() - e.offset, packed,
+                                      kMotionLogBlockSamples, &info);
+  bool is_timed = (0 != MotionLogSampleTime(info, 0));
+  uint64_t time_ms = e.start_ms;
+  for (size_t i = 0; i < count; i++) {
+    if (is_timed) {
+      time_ms = MotionLogSampleTime(info, i);
+    } else if (i > 0) {
+      time_ms += packed[i].dt_ms;
+    }
+    char when[32];
+    FormatTime(time_ms, when, sizeof(when));
+    const PackedOrientationSample& s = packed[i];
+    printf("%s,%u,%d,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f\n", when,
+           (unsigned)MotionLogSampleSequence(info, i),
+           s.flags & kSampleFlagValid,
+           s.yaw_cdeg / 100.0, s.pitch_cdeg / 100.0, s.roll_cdeg / 100.0,
+           s.accel_x_mg / 1000.0, s.accel_y_mg / 1000.0,
+           s.accel_z_mg / 1000.0);
+  }
+}  // end PrintSamples()
+
+/// Indexes log_name if needed, then prints what matches the query
+bool QueryLog(const char* log_name, const Query& query) {
+  MappedFile log;
+  if (!log.Open(log_name)) {
+    fprintf(stderr, "Unable to read %s\n", log_name);
+    return false;
+  }
+  std::string index_name = std::string(log_name) + ".idx";
+  MappedFile index;
+  if (!index.Open(index_name) || !IsIndexCurrent(index, log)) {
+    fprintf(stderr, "Indexing %s\n", log_name);
+    if (!WriteIndex(index_name, log, BuildIndex(log)) ||
+        !index.Open(index_name) || !IsIndexCurrent(index, log)) {
+      fprintf(stderr, "Unable to write %s\n", index_name.c_str());
+      return false;
+    }
+  }
+  const IndexHeader* header = (const IndexHeader*)index.data();
+  const IndexEntry* entries =
+      (const IndexEntry*)(index.data() + sizeof(IndexHeader));
+  for (uint32_t i = 0; i < header->entry_count; i++) {
+    if (!Matches(entries[i], query)) {
+      continue;
+    }
+    if (query.print_samples) {
+      PrintSamples(log, entries[i]);
+    } else {
+      PrintBlock(log_name, entries[i]);
+    }
+  }
+  return true;
+}  // end QueryLog()
+
+int Usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s [--from TIME] [--to TIME] [--roll-above DEG]\n"
+          "       [--pitch-above DEG] [--accel-above G] [--samples]\n"
+          "       log.bin [log.bin ...]\n",
+          program);
+  return 1;
+}  // end Usage()
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Query query;
+  std::vector<const char*> logs;
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    bool has_value = (i + 1 < argc);
+    if (option == "--samples") {
+      query.print_samples = true;
+    } else if ((option == "--from") && has_value) {
+      if (!ParseTime(argv[++i], &query.from_ms)) return Usage(argv[0]);
+    } else if ((option == "--to") && has_value) {
+      if (!ParseTime(argv[++i], &query.to_ms)) return Usage(argv[0]);
+    } else if ((option == "--roll-above") && has_value) {
+      query.roll_above_cdeg = (int)(atof(argv[++i]) * 100.0);
+    } else if ((option == "--pitch-above") && has_value) {
+      query.pitch_above_cdeg = (int)(atof(argv[++i]) * 100.0);
+    } else if ((option == "--accel-above") && has_value) {
+      query.accel_above_mg = (int)(atof(argv[++i]) * 1000.0);
+    } else if (option.compare(0, 2, "--") == 0) {
+      return Usage(argv[0]);
+    } else {
+      logs.push_back(argv[i]);
+    }
+  }
+  if (logs.empty()) {
+    return Usage(argv[0]);
+  }
+
+  if (query.print_samples) {
+    printf("time,sequence,valid,yaw_deg,pitch_deg,roll_deg,"
+           "accel_x_g,accel_y_g,accel_z_g\n");
+  } else {
+    printf("log,offset,start,end,samples,roll_min_deg,roll_max_deg,"
+           "pitch_min_deg,pitch_max_deg,accel_x_min_g,accel_x_max_g,"
+           "accel_y_min_g,accel_y_max_g,accel_z_min_g,accel_z_max_g\n");
+  }
+  int status = 0;
+  for (const char* log_name : logs) {
+    if (!QueryLog(log_name, query)) {
+      status = 1;
+    }
+  }
+  return status;
+}
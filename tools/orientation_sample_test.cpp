@@ -0,0 +1,195 @@
+/** @file orientation_sample_test.cpp
+ *  @brief Host round-trip tests and throughput benchmark of the packed
+ * orientation sample format.
+ *
+ * Build on a desktop machine with e.g.
+ *   g++ -O2 -I../src -o orientation_sample_test orientation_sample_test.cpp \
+ *       ../src/orientation_sample.cpp
+ *
+ * Encodes and decodes random samples within the range of each field and
+ * checks that every value comes back within half a step of its
+ * resolution. Then checks the edge cases: heading wrapping at 0 and
+ * 360 degrees, saturation of out-of-range values, the time step limits
+ * and the valid flag. Finally, times encoding and decoding. A desktop is
+ * much faster than the ESP32, so the times only show the relative cost.
+ * Exits with status 1 if any check fails.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include "orientation_sample.h"
+
+using namespace sensesp;
+
+namespace {
+
+const float kRadPerCentiDeg = (float)M_PI / 18000.0f;
+const float kMPerSSPerMilliG = 9.80665f / 1000.0f;
+const int kRandomSamples = 1000000;
+const int kBenchmarkPasses = 100;
+const size_t kBenchmarkSamples = 100000;
+
+int failures = 0;
+
+/// Reports a failure if value is further than tolerance from expected
+void Check(const char* what, float value, float expected, float tolerance) {
+  if (fabsf(value - expected) > tolerance) {
+    if (failures < 20) {
+      printf("FAIL %s: got %.7f, expected %.7f (tolerance %.7f)\n", what,
+             value, expected, tolerance);
+    }
+    failures++;
+  }
+}
+
+/// Returns a uniformly distributed random value in [low, high]
+float Uniform(float low, float high) {
+  return low + (high - low) * ((float)rand() / (float)RAND_MAX);
+}
+
+/// Returns a random sample with every field within its packed range
+OrientationSample RandomSample(void) {
+  const float kMaxAngle = 327.0f * 100.0f * kRadPerCentiDeg;
+  const float kMaxAccel = 32000.0f * kMPerSSPerMilliG;
+  OrientationSample sample;
+  sample.is_data_valid = rand() & 1;
+  sample.yaw = Uniform(0.0f, 2.0f * (float)M_PI - 0.001f);
+  sample.pitch = Uniform(-(float)M_PI / 2.0f, (float)M_PI / 2.0f);
+  sample.roll = Uniform(-(float)M_PI, (float)M_PI);
+  sample.rate_of_turn = Uniform(-kMaxAngle, kMaxAngle);
+  sample.rate_of_pitch = Uniform(-kMaxAngle, kMaxAngle);
+  sample.rate_of_roll = Uniform(-kMaxAngle, kMaxAngle);
+  sample.accel_x = Uniform(-kMaxAccel, kMaxAccel);
+  sample.accel_y = Uniform(-kMaxAccel, kMaxAccel);
+  sample.accel_z = Uniform(-kMaxAccel, kMaxAccel);
+  sample.dt = Uniform(0.0f, 0.255f);
+  return sample;
+}
+
+OrientationSample RoundTrip(const OrientationSample& sample) {
+  PackedOrientationSample packed;
+  OrientationSample decoded;
+  EncodeOrientationSample(sample, &packed);
+  DecodeOrientationSample(packed, &decoded);
+  return decoded;
+}
+
+/// Checks that values within range come back within half a step
+void TestRoundTrip(void) {
+  // half a step, plus float rounding of the larger values
+  const float kAngleTolerance = 0.5f * kRadPerCentiDeg + 2e-6f;
+  const float kAccelTolerance = 0.5f * kMPerSSPerMilliG + 2e-5f;
+  const float kDtTolerance = 0.0005f + 1e-6f;
+  for (int i = 0; i < kRandomSamples; i++) {
+    OrientationSample sample = RandomSample();
+    OrientationSample decoded = RoundTrip(sample);
+    if (decoded.is_data_valid != sample.is_data_valid) {
+      printf("FAIL valid flag\n");
+      failures++;
+    }
+    // yaw may round up to 360 degrees and wrap to 0
+    float yaw_error = remainderf(decoded.yaw - sample.yaw, 2.0f * (float)M_PI);
+    Check("yaw", yaw_error, 0.0f, kAngleTolerance);
+    Check("pitch", decoded.pitch, sample.pitch, kAngleTolerance);
+    Check("roll", decoded.roll, sample.roll, kAngleTolerance);
+    Check("rate_of_turn", decoded.rate_of_turn, sample.rate_of_turn,
+          kAngleTolerance);
+    Check("rate_of_pitch", decoded.rate_of_pitch, sample.rate_of_pitch,
+          kAngleTolerance);
+    Check("rate_of_roll", decoded.rate_of_roll, sample.rate_of_roll,
+          kAngleTolerance);
+    Check("accel_x", decoded.accel_x, sample.accel_x, kAccelTolerance);
+    Check("accel_y", decoded.accel_y, sample.accel_y, kAccelTolerance);
+    Check("accel_z", decoded.accel_z, sample.accel_z, kAccelTolerance);
+    Check("dt", decoded.dt, sample.dt, kDtTolerance);
+  }
+}  // end TestRoundTrip()
+
+/// Checks heading wrapping, saturation and the time step limits
+void TestEdgeCases(void) {
+  OrientationSample sample = {};
+  PackedOrientationSample packed;
+
+  sample.yaw = -10.0f * 100.0f * kRadPerCentiDeg;  // -10 degrees
+  EncodeOrientationSample(sample, &packed);
+  Check("yaw -10 deg", packed.yaw_cdeg, 35000, 0);
+  sample.yaw = 370.0f * 100.0f * kRadPerCentiDeg;
+  EncodeOrientationSample(sample, &packed);
+  Check("yaw 370 deg", packed.yaw_cdeg, 1000, 0);
+  sample.yaw = 2.0f * (float)M_PI;
+  EncodeOrientationSample(sample, &packed);
+  Check("yaw 360 deg", packed.yaw_cdeg, 0, 0);
+
+  sample.yaw = 0.0f;
+  sample.rate_of_turn = 10.0f;  // about 573 degree/s
+  sample.rate_of_roll = -10.0f;
+  sample.accel_z = 1000.0f;     // about 102 g
+  sample.accel_x = -1000.0f;
+  EncodeOrientationSample(sample, &packed);
+  Check("rate_of_turn saturated", packed.rate_of_turn_cdeg_s, 32767, 0);
+  Check("rate_of_roll saturated", packed.rate_of_roll_cdeg_s, -32768, 0);
+  Check("accel_z saturated", packed.accel_z_mg, 32767, 0);
+  Check("accel_x saturated", packed.accel_x_mg, -32768, 0);
+
+  sample.dt = 1.0f;
+  EncodeOrientationSample(sample, &packed);
+  Check("dt saturated", packed.dt_ms, 255, 0);
+  sample.dt = -0.01f;
+  EncodeOrientationSample(sample, &packed);
+  Check("dt negative", packed.dt_ms, 0, 0);
+
+  sample.is_data_valid = true;
+  EncodeOrientationSample(sample, &packed);
+  Check("valid flag set", packed.flags, kSampleFlagValid, 0);
+  sample.is_data_valid = false;
+  EncodeOrientationSample(sample, &packed);
+  Check("valid flag clear", packed.flags, 0, 0);
+}  // end TestEdgeCases()
+
+/// Times encoding and decoding, in ns per sample
+void Benchmark(void) {
+  std::vector<OrientationSample> samples(kBenchmarkSamples);
+  std::vector<PackedOrientationSample> packed(kBenchmarkSamples);
+  for (auto& sample : samples) {
+    sample = RandomSample();
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < kBenchmarkPasses; pass++) {
+    for (size_t i = 0; i < kBenchmarkSamples; i++) {
+      EncodeOrientationSample(samples[i], &packed[i]);
+    }
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < kBenchmarkPasses; pass++) {
+    for (size_t i = 0; i < kBenchmarkSamples; i++) {
+      DecodeOrientationSample(packed[i], &samples[i]);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  double count = (double)kBenchmarkPasses * kBenchmarkSamples;
+  double encode_ns =
+      std::chrono::duration<double>(middle - start).count() * 1e9 / count;
+  double decode_ns =
+      std::chrono::duration<double>(end - middle).count() * 1e9 / count;
+  volatile float sink = samples[kBenchmarkSamples / 2].yaw;
+  (void)sink;
+  printf("encode: %.1f ns per sample\n", encode_ns);
+  printf("decode: %.1f ns per sample\n", decode_ns);
+}  // end Benchmark()
+
+}  // namespace
+
+int main() {
+  srand(1);
+  TestRoundTrip();
+  TestEdgeCases();
+  printf("%d random samples round-tripped, %d failures\n", kRandomSamples,
+         failures);
+  Benchmark();
+  return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,316 @@
+/** @file wmm_grid.cpp
+ *  @brief Host tool that evaluates the World Magnetic Model on a
+ *  latitude/longitude grid, producing the variation grid read by
+ *  TrueHeading.
+ *
+ * Build on a desktop machine (Linux or macOS) with e.g.
+ *   g++ -O2 -I../src -o wmm_grid wmm_grid.cpp ../src/variation_grid.cpp
+ *
+ * Usage:
+ *   wmm_grid [--step DEG] [--year YEAR] WMM.COF variation.bin
+ *   wmm_grid [--year YEAR] --at LAT LON WMM.COF
+ *   wmm_grid --self-test
+ *
+ * WMM.COF is the coefficient file of the World Magnetic Model, from
+ * https://www.ncei.noaa.gov/products/world-magnetic-model . It isn't
+ * included here; download the current one. The grid holds the variation
+ * at YEAR (default: the model epoch) and its annual change, at sea
+ * level, every DEG degrees (default 5) from -90 to 90 latitude and -180
+ * to 180 longitude. Copy variation.bin to the data/ directory of the
+ * project and upload it with "pio run -t uploadfs".
+ *
+ * --at prints the variation at one position, to compare with NOAA's
+ * online calculator. --self-test checks the field synthesis against a
+ * tilted dipole, whose variation can be computed directly.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "variation_grid.h"
+
+using namespace sensesp;
+
+namespace {
+
+const int kMaxDegree = 12;
+const double kReferenceRadius = 6371.2;  // km, of the model
+const double kWgs84A = 6378.137;         // km, semi-major axis
+const double kWgs84F = 1 / 298.257223563;
+const double kDegToRad = M_PI / 180.0;
+
+/// Gauss coefficients of the model, in nT and nT/year, indexed [n][m]
+struct Model {
+  double epoch;
+  double g[kMaxDegree + 1][kMaxDegree + 1];
+  double h[kMaxDegree + 1][kMaxDegree + 1];
+  double g_dot[kMaxDegree + 1][kMaxDegree + 1];
+  double h_dot[kMaxDegree + 1][kMaxDegree + 1];
+};
+
+/**
+ * @brief Reads a WMM.COF file.
+ *
+ * The first line holds the epoch; each following line is
+ * "n m g h g_dot h_dot", until a line of 9s.
+ */
+bool ReadModel(const char* path, Model* model) {
+  FILE* file = fopen(path, "r");
+  if (NULL == file) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  memset(model, 0, sizeof(*model));
+  char line[256];
+  if (NULL == fgets(line, sizeof(line), file) ||
+      1 != sscanf(line, "%lf", &model->epoch)) {
+    fprintf(stderr, "%s: no epoch on first line\n", path);
+    fclose(file);
+    return false;
+  }
+  int count = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    int n, m;
+    double g, h, g_dot, h_dot;
+    if (6 != sscanf(line, "%d %d %lf %lf %lf %lf", &n, &m, &g, &h, &g_dot,
+                    &h_dot)) {
+      break;  // the closing line of 9s
+    }
+    if (n < 1 || n > kMaxDegree || m < 0 || m > n) {
+      continue;
+    }
+    model->g[n][m] = g;
+    model->h[n][m] = h;
+    model->g_dot[n][m] = g_dot;
+    model->h_dot[n][m] = h_dot;
+    count++;
+  }
+  fclose(file);
+  if (count == 0) {
+    fprintf(stderr, "%s: no coefficients\n", path);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Computes the variation (declination) at a position.
+ *
+ * Follows the WMM technical report: geodetic to geocentric coordinates,
+ * spherical harmonic synthesis with Schmidt semi-normalized associated
+ * Legendre functions, and rotation of the field back to geodetic axes.
+ *
+ * @param latitude Geodetic latitude in degrees. Within 0.01 degree of a
+ * pole, the variation is undefined and 0 is returned.
+ * @param longitude Longitude in degrees.
+ * @param year Decimal year.
+ * @return Variation in degrees, east positive.
+ */
+double Variation(const Model& model, double latitude, double longitude,
+                 double year) {
+  if (fabs(latitude) > 89.99) {
+    return 0.0;
+  }
+  double phi = latitude * kDegToRad;
+  double lambda = longitude * kDegToRad;
+  double e2 = kWgs84F * (2 - kWgs84F);
+  double rc = kWgs84A / sqrt(1 - e2 * sin(phi) * sin(phi));
+  double p = rc * cos(phi);
+  double z = rc * (1 - e2) * sin(phi);
+  double r = sqrt(p * p + z * z);
+  double phi_c = asin(z / r);  // geocentric latitude
+
+  double x = sin(phi_c);
+  double s = cos(phi_c);
+  double pnm[kMaxDegree + 1][kMaxDegree + 1] = {};
+  double dpnm[kMaxDegree + 1][kMaxDegree + 1] = {};  // d/d(phi_c)
+  pnm[0][0] = 1;
+  for (int n = 1; n <= kMaxDegree; n++) {
+    for (int m = 0; m <= n; m++) {
+      if (n == m) {
+        double k = (n == 1) ? 1.0 : sqrt((2.0 * n - 1) / (2.0 * n));
+        pnm[n][n] = k * s * pnm[n - 1][n - 1];
+        dpnm[n][n] = k * (s * dpnm[n - 1][n - 1] - x * pnm[n - 1][n - 1]);
+      } else {
+        double k1 = 2.0 * n - 1;
+        double k2 = (n >= 2) ? sqrt((n - 1.0) * (n - 1.0) - m * m) : 0.0;
+        double k3 = sqrt((double)n * n - m * m);
+        double p2 = (n >= 2) ? pnm[n - 2][m] : 0.0;
+        double dp2 = (n >= 2) ? dpnm[n - 2][m] : 0.0;
+        pnm[n][m] = (k1 * x * pnm[n - 1][m] - k2 * p2) / k3;
+        dpnm[n][m] =
+            (k1 * (s * pnm[n - 1][m] + x * dpnm[n - 1][m]) - k2 * dp2) / k3;
+      }
+    }
+  }
+
+  double dt = year - model.epoch;
+  double north = 0.0;
+  double east = 0.0;
+  double down = 0.0;
+  double ratio = kReferenceRadius / r;
+  double ratio_n = ratio * ratio;  // (a/r)^(n+2) for n = 0
+  for (int n = 1; n <= kMaxDegree; n++) {
+    ratio_n *= ratio;
+    for (int m = 0; m <= n; m++) {
+      double g = model.g[n][m] + dt * model.g_dot[n][m];
+      double h = model.h[n][m] + dt * model.h_dot[n][m];
+      double cos_ml = cos(m * lambda);
+      double sin_ml = sin(m * lambda);
+      double gh = g * cos_ml + h * sin_ml;
+      north -= ratio_n * gh * dpnm[n][m];
+      east += ratio_n * m * (g * sin_ml - h * cos_ml) * pnm[n][m];
+      down -= ratio_n * (n + 1) * gh * pnm[n][m];
+    }
+  }
+  east /= s;
+  // rotate from geocentric to geodetic axes; east is unaffected
+  double psi = phi_c - phi;
+  double geodetic_north = north * cos(psi) - down * sin(psi);
+  return atan2(east, geodetic_north) / kDegToRad;
+}
+
+/**
+ * @brief Compares Variation() for a degree-1 model with the variation
+ * of the equivalent dipole, computed from its moment vector.
+ */
+int SelfTest(void) {
+  Model model;
+  memset(&model, 0, sizeof(model));
+  model.epoch = 2000.0;
+  model.g[1][0] = -29404.8;
+  model.g[1][1] = -1450.9;
+  model.h[1][1] = 4652.5;
+  // Dipole moment, Earth-centred: x to 0E, y to 90E, z north. The
+  // potential of a dipole m is m.r/r^3, so m is (g11, h11, g10).
+  double mx = model.g[1][1], my = model.h[1][1], mz = model.g[1][0];
+  double worst = 0.0;
+  for (int lat = -80; lat <= 80; lat += 10) {
+    for (int lon = -180; lon < 180; lon += 15) {
+      // Geocentric position for the geodetic latitude, as Variation() does
+      double phi = lat * kDegToRad;
+      double e2 = kWgs84F * (2 - kWgs84F);
+      double rc = kWgs84A / sqrt(1 - e2 * sin(phi) * sin(phi));
+      double phi_c = atan2(rc * (1 - e2) * sin(phi), rc * cos(phi));
+      double lambda = lon * kDegToRad;
+      double ux = cos(phi_c) * cos(lambda), uy = cos(phi_c) * sin(lambda),
+             uz = sin(phi_c);
+      double m_dot_u = mx * ux + my * uy + mz * uz;
+      // B is proportional to 3(m.u)u - m
+      double bx = 3 * m_dot_u * ux - mx, by = 3 * m_dot_u * uy - my,
+             bz = 3 * m_dot_u * uz - mz;
+      double east = -sin(lambda) * bx + cos(lambda) * by;
+      double north = -sin(phi_c) * cos(lambda) * bx -
+                     sin(phi_c) * sin(lambda) * by + cos(phi_c) * bz;
+      double up = ux * bx + uy * by + uz * bz;
+      // rotate to geodetic axes
+      double psi = phi_c - phi;
+      double geodetic_north = north * cos(psi) + up * sin(psi);
+      double expected = atan2(east, geodetic_north) / kDegToRad;
+      double error = fabs(Variation(model, lat, lon, 2000.0) - expected);
+      if (error > 180.0) {
+        error = 360.0 - error;
+      }
+      if (error > worst) {
+        worst = error;
+      }
+    }
+  }
+  printf("self-test: largest difference from dipole %.6f degrees\n", worst);
+  return (worst < 1e-6) ? 0 : 1;
+}
+
+int WriteGrid(const Model& model, double year, int step, const char* path) {
+  VariationGridHeader header;
+  memcpy(header.magic, "MVG1", 4);
+  header.version = 1;
+  header.lat_count = 180 / step + 1;
+  header.lon_count = 360 / step + 1;
+  header.lat_min_deg = -90;
+  header.lon_min_deg = -180;
+  header.step_deg = step;
+  header.epoch = year;
+  std::vector<VariationGridPoint> points;
+  for (int row = 0; row < header.lat_count; row++) {
+    for (int col = 0; col < header.lon_count; col++) {
+      double lat = -90.0 + row * step;
+      double lon = -180.0 + col * step;
+      double now = Variation(model, lat, lon, year);
+      double change = Variation(model, lat, lon, year + 1.0) - now;
+      if (change > 180.0) {
+        change -= 360.0;
+      } else if (change < -180.0) {
+        change += 360.0;
+      }
+      VariationGridPoint point;
+      point.variation_cdeg = (int16_t)lround(now * 100.0);
+      point.annual_change_cdeg = (int16_t)lround(change * 100.0);
+      points.push_back(point);
+    }
+  }
+  FILE* file = fopen(path, "wb");
+  if (NULL == file) {
+    fprintf(stderr, "cannot create %s\n", path);
+    return 1;
+  }
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(points.data(), sizeof(VariationGridPoint), points.size(), file);
+  fclose(file);
+  printf("%s: %d x %d points, %.1f, %zu bytes\n", path, header.lat_count,
+         header.lon_count, year,
+         sizeof(header) + points.size() * sizeof(VariationGridPoint));
+  return 0;
+}
+
+void Usage(void) {
+  fprintf(stderr,
+          "usage: wmm_grid [--step DEG] [--year YEAR] WMM.COF variation.bin\n"
+          "       wmm_grid [--year YEAR] --at LAT LON WMM.COF\n"
+          "       wmm_grid --self-test\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int step = 5;
+  double year = 0.0;
+  bool is_at = false;
+  double at_lat = 0.0, at_lon = 0.0;
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], "--self-test")) {
+      return SelfTest();
+    } else if (0 == strcmp(argv[i], "--step") && i + 1 < argc) {
+      step = atoi(argv[++i]);
+    } else if (0 == strcmp(argv[i], "--year") && i + 1 < argc) {
+      year = atof(argv[++i]);
+    } else if (0 == strcmp(argv[i], "--at") && i + 2 < argc) {
+      is_at = true;
+      at_lat = atof(argv[++i]);
+      at_lon = atof(argv[++i]);
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (step < 1 || 180 % step != 0 || files.size() != (is_at ? 1u : 2u)) {
+    Usage();
+    return 1;
+  }
+  Model model;
+  if (!ReadModel(files[0], &model)) {
+    return 1;
+  }
+  if (year == 0.0) {
+    year = model.epoch;
+  }
+  if (is_at) {
+    printf("variation at %.4f %.4f in %.2f: %.2f degrees\n", at_lat, at_lon,
+           year, Variation(model, at_lat, at_lon, year));
+    return 0;
+  }
+  return WriteGrid(model, year, step, files[1]);
+}